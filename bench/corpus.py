@@ -0,0 +1,174 @@
+#!/usr/bin/env python
+# -*- coding: utf-8 -*-
+"""
+Reproducible synthetic corpora and query streams for benchmarks.
+
+Keys are generated lazily, so corpora can be much larger than
+``words100k``; the same ``seed`` always gives the same keys. Usage::
+
+    $ python bench/corpus.py urls 1000000 > urls.txt
+    $ python bench/corpus.py ngrams 1000000 --seed 2 > ngrams.txt
+
+Kinds of corpora:
+
+* ``urls`` - URL-like keys with skewed hosts and path segments;
+* ``ngrams`` - word n-grams of a Zipf-distributed vocabulary;
+* ``shared_prefix`` - keys under a skewed tree of shared prefixes
+  (e.g. tenants, languages and categories);
+* ``words`` - random UTF-8 words of Latin, Cyrillic and CJK letters;
+* ``ids`` - decimal numeric IDs.
+
+Keys of a corpus may repeat; DAWG constructors ignore duplicates.
+"""
+from __future__ import absolute_import, unicode_literals, division
+import argparse
+import bisect
+import io
+import itertools
+import random
+import string
+import sys
+
+
+try:
+    unichr
+except NameError:
+    unichr = chr
+
+LETTERS = string.ascii_lowercase
+CYRILLIC = 'абвгдеёжзийклмнопрстуфхцчшщъыьэюя'
+
+
+class Zipf(object):
+    """
+    Samples ranks ``0..n-1`` with probabilities proportional to
+    ``1 / (rank + 1) ** s``.
+    """
+    def __init__(self, n, s=1.0):
+        total = 0.0
+        self._cumulative = []
+        for rank in range(n):
+            total += 1.0 / (rank + 1) ** s
+            self._cumulative.append(total)
+        self._total = total
+
+    def sample(self, rnd):
+        index = bisect.bisect_left(self._cumulative, rnd.random() * self._total)
+        return min(index, len(self._cumulative) - 1)
+
+
+def _word(rnd, min_length=1, max_length=10, alphabet=LETTERS):
+    length = rnd.randint(min_length, max_length)
+    return ''.join(rnd.choice(alphabet) for _ in range(length))
+
+
+def urls(size, seed=1):
+    rnd = random.Random(seed)
+    hosts = ['%s.%s' % (_word(rnd, 3, 12), rnd.choice(['com', 'org', 'net', 'de', 'ru']))
+             for _ in range(max(10, size // 1000))]
+    segments = [_word(rnd, 2, 10) for _ in range(max(100, size // 100))]
+    host_zipf, segment_zipf = Zipf(len(hosts), 1.1), Zipf(len(segments), 0.9)
+
+    for _ in range(size):
+        path = '/'.join(segments[segment_zipf.sample(rnd)]
+                        for _ in range(rnd.randint(1, 4)))
+        url = 'https://%s/%s' % (hosts[host_zipf.sample(rnd)], path)
+        if rnd.random() < 0.25:
+            url += '?id=%d' % rnd.randint(0, 10 ** 6)
+        yield url
+
+
+def ngrams(size, seed=1, n=3):
+    rnd = random.Random(seed)
+    vocabulary = [_word(rnd, 1, 12) for _ in range(max(1000, int(size ** 0.5) * 10))]
+    zipf = Zipf(len(vocabulary), 1.0)
+
+    for _ in range(size):
+        yield ' '.join(vocabulary[zipf.sample(rnd)] for _ in range(rnd.randint(1, n)))
+
+
+def shared_prefix(size, seed=1, levels=(100, 30, 20), s=1.2):
+    # Each level picks a skewed child, so some prefixes have most keys.
+    rnd = random.Random(seed)
+    names = [[_word(rnd, 2, 8) for _ in range(count)] for count in levels]
+    zipfs = [Zipf(count, s) for count in levels]
+
+    for _ in range(size):
+        prefix = ':'.join(level_names[zipf.sample(rnd)]
+                          for level_names, zipf in zip(names, zipfs))
+        yield '%s:%s' % (prefix, _word(rnd, 3, 15))
+
+
+def words(size, seed=1):
+    rnd = random.Random(seed)
+    alphabets = [LETTERS] * 5 + [CYRILLIC] * 4 + [None]
+
+    for _ in range(size):
+        chars = []
+        for _ in range(rnd.randint(1, 15)):
+            alphabet = rnd.choice(alphabets)
+            if alphabet is None:
+                chars.append(unichr(rnd.randint(0x4E00, 0x9FFF)))
+            else:
+                chars.append(rnd.choice(alphabet))
+        yield ''.join(chars)
+
+
+def ids(size, seed=1):
+    rnd = random.Random(seed)
+    for _ in range(size):
+        yield '%d' % rnd.randint(0, 10 ** 10)
+
+
+CORPORA = {
+    'urls': urls,
+    'ngrams': ngrams,
+    'shared_prefix': shared_prefix,
+    'words': words,
+    'ids': ids,
+}
+
+
+def corpus(kind, size, seed=1):
+    """
+    Returns an iterator over ``size`` keys of a corpus ``kind``.
+    """
+    return CORPORA[kind](size, seed)
+
+
+def queries(keys, size, seed=1, s=1.0, miss_ratio=0.0):
+    """
+    Returns a list of ``size`` queries: keys drawn with Zipf-distributed
+    popularity (popular keys are spread over the key space) and, with
+    probability ``miss_ratio``, keys which are not in ``keys``.
+    """
+    rnd = random.Random(seed)
+    keys = list(keys)
+    popularity = list(range(len(keys)))
+    rnd.shuffle(popularity)
+    zipf = Zipf(len(keys), s)
+
+    res = []
+    for _ in range(size):
+        key = keys[popularity[zipf.sample(rnd)]]
+        if rnd.random() < miss_ratio:
+            key += '\x02'
+        res.append(key)
+    return res
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Writes keys of a synthetic corpus, one per line.")
+    parser.add_argument('kind', choices=sorted(CORPORA))
+    parser.add_argument('size', type=int)
+    parser.add_argument('--seed', type=int, default=1)
+    args = parser.parse_args()
+
+    out = io.open(sys.stdout.fileno(), 'w', encoding='utf8', closefd=False)
+    for key in itertools.islice(corpus(args.kind, args.size, args.seed), args.size):
+        out.write(key + '\n')
+    out.flush()
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,571 @@
+// Benchmarks of the dawgdic core without the Python wrapper.
+//
+// Usage: dawgdic_bench [options] [words-file ...]
+//
+//   --benchmark_filter=SUBSTR   runs cases whose names contain SUBSTR
+//   --benchmark_min_time=SEC    minimum time of a case (0.5 by default)
+//   --benchmark_format=json     prints results as JSON (console by default)
+//   --synthetic_size=N          number of keys of each synthetic corpus
+//                               (200000 by default, 0 disables them)
+//
+// Every words file (one key per line) is a corpus; synthetic corpora of
+// URLs, random UTF-8 words and numeric IDs are generated with fixed
+// seeds. Options and the JSON format follow Google Benchmark, so its
+// tools (e.g. compare.py) can compare results of two commits.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "dawgdic/completer.h"
+#include "dawgdic/container.h"
+#include "dawgdic/dawg-builder.h"
+#include "dawgdic/dictionary-builder.h"
+#include "dawgdic/ranked-completer.h"
+#include "dawgdic/ranked-guide-builder.h"
+
+namespace {
+
+using dawgdic::BaseType;
+using dawgdic::SizeType;
+using dawgdic::ValueType;
+
+typedef std::chrono::steady_clock Clock;
+
+double SecondsSince(Clock::time_point start) {
+  return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+// Keys and structures of a corpus which are shared by its cases.
+struct Corpus {
+  std::string name;
+  // Sorted unique keys; their values are 0 as in CompletionDAWG.
+  std::vector<std::string> keys;
+  // Keys in random order, and keys which are not in a dictionary.
+  std::vector<std::string> hits;
+  std::vector<std::string> misses;
+  // Prefixes (2/3 of bytes) of sampled keys for completion.
+  std::vector<std::string> prefixes;
+  // Random ranks of keys for ranked completion.
+  std::vector<ValueType> ranks;
+
+  dawgdic::Dawg dawg;
+  dawgdic::Dictionary dic;
+  dawgdic::Guide guide;
+  dawgdic::Dawg ranked_dawg;
+  dawgdic::Dictionary ranked_dic;
+  dawgdic::RankedGuide ranked_guide;
+  std::string image;
+  std::string container_path;
+};
+
+struct Result {
+  std::string name;
+  SizeType iterations;
+  double seconds_per_iteration;
+  double items_per_second;
+};
+
+// A case runs one iteration and returns the number of processed items.
+typedef SizeType (*CaseFunction)(Corpus *corpus);
+
+struct Case {
+  const char *name;
+  CaseFunction function;
+};
+
+// Random keys ---------------------------------------------------------------
+
+void AppendUtf8(unsigned code_point, std::string *s) {
+  if (code_point < 0x80) {
+    *s += static_cast<char>(code_point);
+  } else if (code_point < 0x800) {
+    *s += static_cast<char>(0xC0 | (code_point >> 6));
+    *s += static_cast<char>(0x80 | (code_point & 0x3F));
+  } else {
+    *s += static_cast<char>(0xE0 | (code_point >> 12));
+    *s += static_cast<char>(0x80 | ((code_point >> 6) & 0x3F));
+    *s += static_cast<char>(0x80 | (code_point & 0x3F));
+  }
+}
+
+std::string RandomWord(std::mt19937_64 *random, SizeType max_length) {
+  static const char kLetters[] = "abcdefghijklmnopqrstuvwxyz";
+  std::string word;
+  SizeType length = 1 + (*random)() % max_length;
+  for (SizeType i = 0; i < length; ++i) {
+    word += kLetters[(*random)() % 26];
+  }
+  return word;
+}
+
+// Hosts and path segments are skewed: a few of them are very common.
+std::vector<std::string> GenerateUrls(SizeType size) {
+  std::mt19937_64 random(1);
+  std::vector<std::string> hosts, words;
+  for (SizeType i = 0; i < 1000; ++i) {
+    hosts.push_back(RandomWord(&random, 12) + ".example." +
+                    (i % 3 == 0 ? "org" : "com"));
+  }
+  for (SizeType i = 0; i < 5000; ++i) {
+    words.push_back(RandomWord(&random, 10));
+  }
+  std::uniform_real_distribution<double> uniform(0.0, 1.0);
+
+  std::vector<std::string> keys;
+  for (SizeType i = 0; i < size; ++i) {
+    double r = uniform(random);
+    std::string key = "https://" + hosts[static_cast<SizeType>(
+        r * r * r * hosts.size())];
+    SizeType num_of_segments = 1 + random() % 4;
+    for (SizeType j = 0; j < num_of_segments; ++j) {
+      r = uniform(random);
+      key += "/" + words[static_cast<SizeType>(r * r * words.size())];
+    }
+    if (random() % 4 == 0) {
+      key += "?id=" + std::to_string(random() % 1000000);
+    }
+    keys.push_back(key);
+  }
+  return keys;
+}
+
+// Words of 1-15 letters of ASCII, Cyrillic and CJK alphabets.
+std::vector<std::string> GenerateUtf8(SizeType size) {
+  std::mt19937_64 random(2);
+  std::vector<std::string> keys;
+  for (SizeType i = 0; i < size; ++i) {
+    std::string key;
+    SizeType length = 1 + random() % 15;
+    for (SizeType j = 0; j < length; ++j) {
+      SizeType script = random() % 10;
+      if (script < 5) {
+        AppendUtf8('a' + random() % 26, &key);
+      } else if (script < 9) {
+        AppendUtf8(0x430 + random() % 32, &key);
+      } else {
+        AppendUtf8(0x4E00 + random() % 0x5200, &key);
+      }
+    }
+    keys.push_back(key);
+  }
+  return keys;
+}
+
+std::vector<std::string> GenerateIds(SizeType size) {
+  std::mt19937_64 random(3);
+  std::vector<std::string> keys;
+  for (SizeType i = 0; i < size; ++i) {
+    keys.push_back(std::to_string(random() % 10000000000ULL));
+  }
+  return keys;
+}
+
+bool ReadWords(const char *path, std::vector<std::string> *keys) {
+  std::ifstream file(path);
+  if (!file) {
+    return false;
+  }
+  std::string line;
+  while (std::getline(file, line)) {
+    if (!line.empty() && line[line.size() - 1] == '\r') {
+      line.resize(line.size() - 1);
+    }
+    if (!line.empty() && line.find('\0') == std::string::npos) {
+      keys->push_back(line);
+    }
+  }
+  return true;
+}
+
+// Corpus preparation --------------------------------------------------------
+
+bool BuildDawg(const std::vector<std::string> &keys,
+               const std::vector<ValueType> *values, dawgdic::Dawg *dawg) {
+  dawgdic::DawgBuilder builder;
+  for (SizeType i = 0; i < keys.size(); ++i) {
+    ValueType value = values ? (*values)[i] : 0;
+    if (!builder.Insert(keys[i].c_str(), keys[i].length(), value)) {
+      return false;
+    }
+  }
+  return builder.Finish(dawg);
+}
+
+bool PrepareCorpus(const std::string &name, std::vector<std::string> keys,
+                   Corpus *corpus) {
+  std::sort(keys.begin(), keys.end());
+  keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+  if (keys.empty()) {
+    return false;
+  }
+
+  corpus->name = name;
+  corpus->keys.swap(keys);
+  const std::vector<std::string> &sorted_keys = corpus->keys;
+
+  std::mt19937_64 random(4);
+  corpus->hits = sorted_keys;
+  std::shuffle(corpus->hits.begin(), corpus->hits.end(), random);
+  // Misses follow a key to its end and then fail.
+  for (SizeType i = 0; i < corpus->hits.size(); ++i) {
+    corpus->misses.push_back(corpus->hits[i] + '\x01');
+  }
+  for (SizeType i = 0; i < 1000 && i < corpus->hits.size(); ++i) {
+    const std::string &key = corpus->hits[i];
+    corpus->prefixes.push_back(key.substr(0, (key.length() * 2 + 2) / 3));
+  }
+  for (SizeType i = 0; i < sorted_keys.size(); ++i) {
+    corpus->ranks.push_back(static_cast<ValueType>(random() % 1000000));
+  }
+
+  if (!BuildDawg(sorted_keys, NULL, &corpus->dawg) ||
+      !dawgdic::DictionaryBuilder::Build(corpus->dawg, &corpus->dic,
+                                         &corpus->guide) ||
+      !BuildDawg(sorted_keys, &corpus->ranks, &corpus->ranked_dawg) ||
+      !dawgdic::DictionaryBuilder::Build(corpus->ranked_dawg,
+                                         &corpus->ranked_dic) ||
+      !dawgdic::RankedGuideBuilder::Build(corpus->ranked_dawg,
+                                          corpus->ranked_dic,
+                                          &corpus->ranked_guide)) {
+    return false;
+  }
+
+  std::ostringstream image;
+  corpus->dic.Write(&image);
+  corpus->guide.Write(&image);
+  corpus->image = image.str();
+
+  std::ostringstream dic_stream, guide_stream;
+  corpus->dic.Write(&dic_stream);
+  corpus->guide.Write(&guide_stream);
+  std::string dic_data = dic_stream.str(), guide_data = guide_stream.str();
+  dawgdic::ContainerWriter writer("CompletionDAWG");
+  writer.SetSection(dawgdic::CONTAINER_DICTIONARY, dic_data.data(),
+                    dic_data.size(), sizeof(dawgdic::DictionaryUnit));
+  writer.SetSection(dawgdic::CONTAINER_GUIDE, guide_data.data(),
+                    guide_data.size(), sizeof(dawgdic::GuideUnit));
+  const char *tmp_dir = std::getenv("TMPDIR");
+  corpus->container_path = std::string(tmp_dir ? tmp_dir : "/tmp") +
+      "/dawgdic_bench_" + name + ".dawg";
+  std::ofstream file(corpus->container_path.c_str(), std::ios::binary);
+  return writer.Write(&file) && file.flush();
+}
+
+// Cases ---------------------------------------------------------------------
+
+SizeType BM_DawgBuild(Corpus *corpus) {
+  dawgdic::Dawg dawg;
+  BuildDawg(corpus->keys, NULL, &dawg);
+  return corpus->keys.size();
+}
+
+SizeType BM_DictionaryBuild(Corpus *corpus) {
+  dawgdic::Dictionary dic;
+  dawgdic::Guide guide;
+  dawgdic::DictionaryBuilder::Build(corpus->dawg, &dic, &guide);
+  return corpus->keys.size();
+}
+
+SizeType BM_DictionaryBuildWithTails(Corpus *corpus) {
+  dawgdic::Dictionary dic;
+  dawgdic::Guide guide;
+  dawgdic::DictionaryBuilder::BuildWithTails(corpus->dawg, &dic, &guide);
+  return corpus->keys.size();
+}
+
+SizeType BM_RankedGuideBuild(Corpus *corpus) {
+  dawgdic::RankedGuide guide;
+  dawgdic::RankedGuideBuilder::Build(corpus->ranked_dawg, corpus->ranked_dic,
+                                     &guide);
+  return corpus->keys.size();
+}
+
+SizeType Find(const dawgdic::Dictionary &dic,
+              const std::vector<std::string> &keys) {
+  SizeType num_of_found = 0;
+  for (SizeType i = 0; i < keys.size(); ++i) {
+    ValueType value;
+    num_of_found += dic.Find(keys[i].c_str(), keys[i].length(), &value);
+  }
+  return num_of_found;
+}
+
+SizeType BM_LookupHit(Corpus *corpus) {
+  if (Find(corpus->dic, corpus->hits) != corpus->hits.size()) {
+    std::fprintf(stderr, "%s: a key is not found\n", corpus->name.c_str());
+    std::exit(1);
+  }
+  return corpus->hits.size();
+}
+
+SizeType BM_LookupMiss(Corpus *corpus) {
+  if (Find(corpus->dic, corpus->misses) != 0) {
+    std::fprintf(stderr, "%s: a missing key is found\n",
+                 corpus->name.c_str());
+    std::exit(1);
+  }
+  return corpus->misses.size();
+}
+
+// Items are completed keys.
+SizeType BM_PrefixEnumeration(Corpus *corpus) {
+  dawgdic::Completer completer(corpus->dic, corpus->guide);
+  SizeType num_of_keys = 0;
+  for (SizeType i = 0; i < corpus->prefixes.size(); ++i) {
+    const std::string &prefix = corpus->prefixes[i];
+    BaseType index = corpus->dic.root();
+    if (corpus->dic.Follow(prefix.c_str(), prefix.length(), &index)) {
+      completer.Start(index, prefix.c_str(), prefix.length());
+      while (completer.Next()) {
+        ++num_of_keys;
+      }
+    }
+  }
+  return num_of_keys;
+}
+
+// The top 10 keys of each prefix by rank; items are completed keys.
+SizeType BM_RankedCompletion(Corpus *corpus) {
+  dawgdic::RankedCompleter completer(corpus->ranked_dic,
+                                     corpus->ranked_guide);
+  SizeType num_of_keys = 0;
+  for (SizeType i = 0; i < corpus->prefixes.size(); ++i) {
+    const std::string &prefix = corpus->prefixes[i];
+    BaseType index = corpus->ranked_dic.root();
+    if (corpus->ranked_dic.Follow(prefix.c_str(), prefix.length(), &index)) {
+      completer.Start(index, prefix.c_str(), prefix.length());
+      for (SizeType j = 0; j < 10 && completer.Next(); ++j) {
+        ++num_of_keys;
+      }
+    }
+  }
+  return num_of_keys;
+}
+
+// Reads a dictionary and a guide from memory.
+SizeType BM_Load(Corpus *corpus) {
+  std::istringstream stream(corpus->image);
+  dawgdic::Dictionary dic;
+  dawgdic::Guide guide;
+  if (!dic.Read(&stream) || !guide.Read(&stream)) {
+    std::fprintf(stderr, "%s: can't read a dictionary\n",
+                 corpus->name.c_str());
+    std::exit(1);
+  }
+  return 1;
+}
+
+SizeType OpenContainer(Corpus *corpus, bool use_mmap) {
+  dawgdic::Container container;
+  dawgdic::Dictionary dic;
+  dawgdic::Guide guide;
+  ValueType value;
+  if (!container.Open(corpus->container_path.c_str(), use_mmap) ||
+      !container.Map(dawgdic::CONTAINER_DICTIONARY, &dic) ||
+      !container.Map(dawgdic::CONTAINER_GUIDE, &guide) ||
+      !dic.Find(corpus->keys[0].c_str(), corpus->keys[0].length(), &value)) {
+    std::fprintf(stderr, "%s: can't open a container\n",
+                 corpus->name.c_str());
+    std::exit(1);
+  }
+  return 1;
+}
+
+// Opens a container and finds a key; sections are mapped lazily.
+SizeType BM_Mmap(Corpus *corpus) {
+  return OpenContainer(corpus, true);
+}
+
+SizeType BM_ContainerRead(Corpus *corpus) {
+  return OpenContainer(corpus, false);
+}
+
+const Case kCases[] = {
+  { "BM_DawgBuild", BM_DawgBuild },
+  { "BM_DictionaryBuild", BM_DictionaryBuild },
+  { "BM_DictionaryBuildWithTails", BM_DictionaryBuildWithTails },
+  { "BM_RankedGuideBuild", BM_RankedGuideBuild },
+  { "BM_LookupHit", BM_LookupHit },
+  { "BM_LookupMiss", BM_LookupMiss },
+  { "BM_PrefixEnumeration", BM_PrefixEnumeration },
+  { "BM_RankedCompletion", BM_RankedCompletion },
+  { "BM_Load", BM_Load },
+  { "BM_Mmap", BM_Mmap },
+  { "BM_ContainerRead", BM_ContainerRead },
+};
+
+// Runs a case until it takes at least min_time seconds, doubling the
+// number of iterations of each run as Google Benchmark does.
+Result Run(const Case &c, Corpus *corpus, double min_time) {
+  c.function(corpus);
+
+  SizeType iterations = 1;
+  for ( ; ; iterations *= 2) {
+    SizeType num_of_items = 0;
+    Clock::time_point start = Clock::now();
+    for (SizeType i = 0; i < iterations; ++i) {
+      num_of_items += c.function(corpus);
+    }
+    double seconds = SecondsSince(start);
+    if (seconds >= min_time || iterations >= (1U << 30)) {
+      Result result;
+      result.name = std::string(c.name) + "/" + corpus->name;
+      result.iterations = iterations;
+      result.seconds_per_iteration = seconds / iterations;
+      result.items_per_second = num_of_items / seconds;
+      return result;
+    }
+  }
+}
+
+void PrintConsole(const Result &result) {
+  std::printf("%-40s %14.0f ns %10zu %12.4g items/s\n", result.name.c_str(),
+              result.seconds_per_iteration * 1e9,
+              static_cast<size_t>(result.iterations),
+              result.items_per_second);
+  std::fflush(stdout);
+}
+
+void PrintJson(const std::vector<Result> &results,
+               const std::vector<Corpus *> &corpora, const char *executable) {
+  char date[64];
+  std::time_t now = std::time(NULL);
+  std::strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%S%z",
+                std::localtime(&now));
+
+  std::printf("{\n  \"context\": {\n");
+  std::printf("    \"date\": \"%s\",\n", date);
+  std::printf("    \"executable\": \"%s\",\n", executable);
+#ifdef NDEBUG
+  std::printf("    \"library_build_type\": \"release\",\n");
+#else  // NDEBUG
+  std::printf("    \"library_build_type\": \"debug\",\n");
+#endif  // NDEBUG
+  std::printf("    \"corpora\": {");
+  for (SizeType i = 0; i < corpora.size(); ++i) {
+    std::printf("%s\n      \"%s\": {\"num_of_keys\": %zu, "
+                "\"num_of_units\": %zu, \"file_size\": %zu}",
+                i ? "," : "", corpora[i]->name.c_str(),
+                static_cast<size_t>(corpora[i]->keys.size()),
+                static_cast<size_t>(corpora[i]->dic.size()),
+                static_cast<size_t>(corpora[i]->image.size()));
+  }
+  std::printf("\n    }\n  },\n  \"benchmarks\": [");
+  for (SizeType i = 0; i < results.size(); ++i) {
+    const Result &result = results[i];
+    std::printf("%s\n    {\n", i ? "," : "");
+    std::printf("      \"name\": \"%s\",\n", result.name.c_str());
+    std::printf("      \"run_name\": \"%s\",\n", result.name.c_str());
+    std::printf("      \"run_type\": \"iteration\",\n");
+    std::printf("      \"iterations\": %zu,\n",
+                static_cast<size_t>(result.iterations));
+    std::printf("      \"real_time\": %.6g,\n",
+                result.seconds_per_iteration * 1e9);
+    std::printf("      \"cpu_time\": %.6g,\n",
+                result.seconds_per_iteration * 1e9);
+    std::printf("      \"time_unit\": \"ns\",\n");
+    std::printf("      \"items_per_second\": %.6g\n    }",
+                result.items_per_second);
+  }
+  std::printf("\n  ]\n}\n");
+}
+
+bool ParseOption(const char *arg, const char *name, const char **value) {
+  SizeType length = std::strlen(name);
+  if (std::strncmp(arg, name, length) != 0 || arg[length] != '=') {
+    return false;
+  }
+  *value = arg + length + 1;
+  return true;
+}
+
+std::string CorpusName(const std::string &path) {
+  std::string name = path.substr(path.find_last_of('/') + 1);
+  return name.substr(0, name.find('.'));
+}
+
+}  // namespace
+
+int main(int argc, char *argv[]) {
+  const char *filter = "";
+  double min_time = 0.5;
+  bool use_json = false;
+  SizeType synthetic_size = 200000;
+  std::vector<const char *> paths;
+
+  for (int i = 1; i < argc; ++i) {
+    const char *value;
+    if (ParseOption(argv[i], "--benchmark_filter", &value)) {
+      filter = value;
+    } else if (ParseOption(argv[i], "--benchmark_min_time", &value)) {
+      min_time = std::atof(value);
+    } else if (ParseOption(argv[i], "--benchmark_format", &value)) {
+      use_json = std::strcmp(value, "json") == 0;
+    } else if (ParseOption(argv[i], "--synthetic_size", &value)) {
+      synthetic_size = static_cast<SizeType>(std::atol(value));
+    } else if (argv[i][0] == '-') {
+      std::fprintf(stderr, "Unknown option: %s\n", argv[i]);
+      return 1;
+    } else {
+      paths.push_back(argv[i]);
+    }
+  }
+
+  std::vector<std::pair<std::string, std::vector<std::string> > > sources;
+  for (SizeType i = 0; i < paths.size(); ++i) {
+    std::vector<std::string> keys;
+    if (!ReadWords(paths[i], &keys)) {
+      std::fprintf(stderr, "Can't read %s\n", paths[i]);
+      return 1;
+    }
+    sources.push_back(std::make_pair(CorpusName(paths[i]), keys));
+  }
+  if (synthetic_size != 0) {
+    sources.push_back(std::make_pair("urls", GenerateUrls(synthetic_size)));
+    sources.push_back(std::make_pair("utf8", GenerateUtf8(synthetic_size)));
+    sources.push_back(std::make_pair("ids", GenerateIds(synthetic_size)));
+  }
+
+  std::vector<Corpus *> corpora;
+  std::vector<Result> results;
+  for (SizeType i = 0; i < sources.size(); ++i) {
+    Corpus *corpus = new Corpus;
+    if (!PrepareCorpus(sources[i].first, sources[i].second, corpus)) {
+      std::fprintf(stderr, "Can't prepare corpus %s\n",
+                   sources[i].first.c_str());
+      return 1;
+    }
+    std::vector<std::string>().swap(sources[i].second);
+    corpora.push_back(corpus);
+
+    for (SizeType j = 0; j < sizeof(kCases) / sizeof(kCases[0]); ++j) {
+      std::string name = std::string(kCases[j].name) + "/" + corpus->name;
+      if (name.find(filter) == std::string::npos) {
+        continue;
+      }
+      results.push_back(Run(kCases[j], corpus, min_time));
+      if (!use_json) {
+        PrintConsole(results.back());
+      }
+    }
+    std::remove(corpus->container_path.c_str());
+  }
+
+  if (use_json) {
+    PrintJson(results, corpora, argv[0]);
+  }
+  for (SizeType i = 0; i < corpora.size(); ++i) {
+    delete corpora[i];
+  }
+  return 0;
+}
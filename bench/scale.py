@@ -0,0 +1,196 @@
+#!/usr/bin/env python
+# -*- coding: utf-8 -*-
+"""
+Benchmarks of DAWG classes as dictionaries grow past CPU caches.
+
+For each size, corpus and class a DAWG is built and then queried with
+a Zipfian stream of keys, both in memory and memory-mapped from a
+container file. Throughput and p50/p99 latencies of lookups are
+reported with the size of the DAWG; sizes above the last-level cache
+(LLC) are marked. Usage::
+
+    $ python bench/scale.py --sizes 10000 100000 1000000 --corpora urls ids
+    $ python bench/scale.py --classes DAWG IntCompletionDAWG --json > scale.json
+
+Corpora come from ``bench/corpus.py``.
+"""
+from __future__ import absolute_import, unicode_literals, division, print_function
+import argparse
+import gc
+import json
+import os
+import struct
+import sys
+import tempfile
+
+try:
+    from time import perf_counter as timer
+except ImportError:
+    from timeit import default_timer as timer
+
+import dawg
+
+sys.path.insert(0, os.path.dirname(os.path.abspath(__file__)))
+import corpus
+
+
+def _keys_only(keys):
+    return keys
+
+def _int_items(keys):
+    return ((key, len(key)) for key in keys)
+
+def _bytes_items(keys):
+    return ((key, struct.pack(str('<H'), len(key))) for key in keys)
+
+def _record_items(keys):
+    return ((key, (len(key),)) for key in keys)
+
+
+# name: (factory, items, lookup, can be memory-mapped)
+CLASSES = {
+    'DAWG': (dawg.DAWG, _keys_only, lambda d, key: key in d, True),
+    'CompletionDAWG': (dawg.CompletionDAWG, _keys_only, lambda d, key: key in d, True),
+    'IntDAWG': (dawg.IntDAWG, _int_items, lambda d, key: d.get(key), True),
+    'IntCompletionDAWG': (dawg.IntCompletionDAWG, _int_items, lambda d, key: d.get(key), True),
+    'BytesDAWG': (dawg.BytesDAWG, _bytes_items, lambda d, key: d.get(key), True),
+    'RecordDAWG': (lambda *args: dawg.RecordDAWG(str('<H'), *args), _record_items,
+                   lambda d, key: d.get(key), True),
+    'SuccinctDAWG': (dawg.SuccinctDAWG, _keys_only, lambda d, key: key in d, False),
+}
+
+
+def llc_size():
+    """
+    Returns the size of the last-level cache in bytes or None.
+    """
+    base = '/sys/devices/system/cpu/cpu0/cache'
+    size = None
+    try:
+        for index in sorted(os.listdir(base)):
+            with open(os.path.join(base, index, 'size')) as f:
+                value = f.read().strip()
+            multiplier = {'K': 1024, 'M': 1024 ** 2}.get(value[-1:], 1)
+            size = int(value.rstrip('KM')) * multiplier
+    except (OSError, IOError, ValueError):
+        pass
+    return size
+
+
+def timer_overhead():
+    samples = []
+    for _ in range(10000):
+        start = timer()
+        samples.append(timer() - start)
+    samples.sort()
+    return samples[len(samples) // 2]
+
+
+def measure(d, lookup, queries, overhead):
+    """
+    Returns (ops/sec, p50 latency, p99 latency); latencies are in seconds.
+    """
+    start = timer()
+    for key in queries:
+        lookup(d, key)
+    ops = len(queries) / (timer() - start)
+
+    latencies = []
+    for key in queries:
+        start = timer()
+        lookup(d, key)
+        latencies.append(timer() - start - overhead)
+    latencies.sort()
+    return (ops, latencies[len(latencies) // 2], latencies[len(latencies) * 99 // 100])
+
+
+def run(args):
+    overhead = timer_overhead()
+    llc = llc_size()
+    results = []
+    if not args.json:
+        print("LLC size: %s; timer overhead: %.0fns" % (
+            '%.1fMB' % (llc / 1024 ** 2) if llc else 'unknown', overhead * 1e9))
+
+    for size in args.sizes:
+        for kind in args.corpora:
+            keys = sorted(set(corpus.corpus(kind, size, args.seed)))
+            queries = corpus.queries(keys, args.queries, args.seed, args.zipf_s, args.miss_ratio)
+
+            for name in args.classes:
+                factory, items, lookup, can_mmap = CLASSES[name]
+                gc.collect()
+                start = timer()
+                d = factory(items(keys))
+                build_time = timer() - start
+
+                fd, path = tempfile.mkstemp(suffix='.dawg')
+                os.close(fd)
+                try:
+                    if can_mmap:
+                        d.save(path, container=True)
+                    else:
+                        d.save(path)
+                    file_size = os.path.getsize(path)
+
+                    modes = [('memory', d)]
+                    if can_mmap and not args.no_mmap:
+                        modes.append(('mmap', type(d)().mmap(path) if name != 'RecordDAWG'
+                                      else dawg.RecordDAWG(str('<H')).mmap(path)))
+
+                    for mode, obj in modes:
+                        ops, p50, p99 = measure(obj, lookup, queries, overhead)
+                        result = {
+                            'class': name, 'corpus': kind, 'size': size,
+                            'num_of_keys': len(keys), 'mode': mode,
+                            'file_size': file_size,
+                            'above_llc': bool(llc and file_size > llc),
+                            'build_time': build_time,
+                            'ops_per_second': ops,
+                            'p50_ns': p50 * 1e9, 'p99_ns': p99 * 1e9,
+                        }
+                        results.append(result)
+                        if not args.json:
+                            print_result(result)
+                    del modes, obj
+                finally:
+                    os.remove(path)
+                del d
+
+    if args.json:
+        json.dump({'llc_size': llc, 'timer_overhead_ns': overhead * 1e9,
+                   'results': results}, sys.stdout, indent=2)
+        print()
+
+
+def print_result(result):
+    print("%-18s %-14s %10d %-6s %9.1fMB%s %8.2fs %10.3fM ops/sec %8.0fns p50 %8.0fns p99" % (
+        result['class'], result['corpus'], result['num_of_keys'], result['mode'],
+        result['file_size'] / 1024 ** 2, '*' if result['above_llc'] else ' ',
+        result['build_time'], result['ops_per_second'] / 1e6,
+        result['p50_ns'], result['p99_ns'],
+    ))
+    sys.stdout.flush()
+
+
+def main():
+    parser = argparse.ArgumentParser(
+        description="Benchmarks DAWG classes on growing synthetic corpora "
+                    "(* marks DAWGs larger than the last-level cache).")
+    parser.add_argument('--sizes', type=int, nargs='+', default=[10000, 100000, 1000000])
+    parser.add_argument('--corpora', nargs='+', choices=sorted(corpus.CORPORA),
+                        default=['urls', 'ngrams', 'shared_prefix', 'words', 'ids'])
+    parser.add_argument('--classes', nargs='+', choices=sorted(CLASSES), default=sorted(CLASSES))
+    parser.add_argument('--queries', type=int, default=100000,
+                        help="number of lookups of each benchmark")
+    parser.add_argument('--zipf-s', type=float, default=1.0,
+                        help="skew of popularity of queried keys")
+    parser.add_argument('--miss-ratio', type=float, default=0.1)
+    parser.add_argument('--seed', type=int, default=1)
+    parser.add_argument('--no-mmap', action='store_true', help="skip memory-mapped DAWGs")
+    parser.add_argument('--json', action='store_true', help="print results as JSON")
+    run(parser.parse_args())
+
+
+if __name__ == '__main__':
+    main()
@@ -27,6 +27,11 @@ class BitPool {
     return (pool_[pool_index] & bit_flag) ? true : false;
   }
 
+  // Size of allocated bytes of bits.
+  SizeType total_size() const {
+    return pool_.total_size();
+  }
+
   // Deletes all bits and frees memory.
   void Clear() {
     pool_.Clear();
@@ -38,6 +43,12 @@ class BitPool {
     pool_.Swap(&bit_pool->pool_);
   }
 
+  // Copies bits of another bit pool.
+  void Copy(const BitPool &bit_pool) {
+    pool_.Copy(bit_pool.pool_);
+    size_ = bit_pool.size_;
+  }
+
   // Allocates memory for a new bit and returns its ID.
   // Note: Allocated bits are filled with false.
   SizeType Allocate() {
@@ -0,0 +1,367 @@
+#ifndef DAWGDIC_BIT_VECTOR_H
+#define DAWGDIC_BIT_VECTOR_H
+
+#include <algorithm>
+#include <iostream>
+#include <utility>
+#include <vector>
+
+#include "base-types.h"
+
+namespace dawgdic {
+
+// Bit vector with rank and select support. Bits are appended and then
+// Build() makes rank and select indexes. A bit vector written by Write()
+// can also be mapped from memory.
+class BitVector {
+ public:
+  BitVector()
+    : units_(NULL), ranks_(NULL), selects_(NULL), size_(0),
+      num_of_ones_(0), units_buf_(), ranks_buf_(), selects_buf_() {}
+
+  bool operator[](SizeType index) const {
+    return ((units_[index / UNIT_BITS] >> (index % UNIT_BITS)) & 1) != 0;
+  }
+
+  // Number of bits.
+  SizeType size() const {
+    return size_;
+  }
+  SizeType num_of_ones() const {
+    return num_of_ones_;
+  }
+  SizeType num_of_zeros() const {
+    return size_ - num_of_ones_;
+  }
+  SizeType total_size() const {
+    if (ranks_ == NULL) {
+      return 0;
+    }
+    return sizeof(BaseType) * (NumOfUnits(size_) + NumOfRanks(size_) +
+                               NumOfSelects(num_of_zeros()));
+  }
+  // Number of bytes allocated for a bit vector; mapped data is not counted.
+  SizeType heap_size() const {
+    return sizeof(BaseType) * (units_buf_.capacity() +
+                               ranks_buf_.capacity() +
+                               selects_buf_.capacity());
+  }
+  SizeType file_size() const {
+    return sizeof(BaseType) * 2 + total_size();
+  }
+
+  // Number of 1s in [0, index).
+  SizeType Rank1(SizeType index) const {
+    SizeType block = index / BLOCK_BITS;
+    SizeType rank = ranks_[block];
+    SizeType unit = block * UNITS_PER_BLOCK;
+    for ( ; unit < index / UNIT_BITS; ++unit) {
+      rank += PopCount(units_[unit]);
+    }
+    if (index % UNIT_BITS != 0) {
+      BaseType mask = (static_cast<BaseType>(1) << (index % UNIT_BITS)) - 1;
+      rank += PopCount(units_[unit] & mask);
+    }
+    return rank;
+  }
+  // Number of 0s in [0, index).
+  SizeType Rank0(SizeType index) const {
+    return index - Rank1(index);
+  }
+
+  // Position of the (rank + 1)-th 0; rank must be less than num_of_zeros().
+  SizeType Select0(SizeType rank) const {
+    SizeType sample = rank / SELECT_INTERVAL;
+    SizeType low = selects_[sample];
+    SizeType high = selects_[sample + 1] + 1;
+    while (low + 1 < high) {
+      SizeType middle = (low + high) / 2;
+      if (num_of_zeros_before(middle) <= rank) {
+        low = middle;
+      } else {
+        high = middle;
+      }
+    }
+
+    rank -= num_of_zeros_before(low);
+    SizeType unit = low * UNITS_PER_BLOCK;
+    for ( ; ; ++unit) {
+      SizeType num_of_zeros = UNIT_BITS - PopCount(units_[unit]);
+      if (rank < num_of_zeros) {
+        break;
+      }
+      rank -= num_of_zeros;
+    }
+    return unit * UNIT_BITS + SelectInUnit(~units_[unit], rank);
+  }
+
+  // Position of the first 0 at or after index; there must be such a 0.
+  SizeType NextZero(SizeType index) const {
+    SizeType unit = index / UNIT_BITS;
+    BaseType zeros = ~units_[unit] >> (index % UNIT_BITS);
+    if (zeros != 0) {
+      return index + SelectInUnit(zeros, 0);
+    }
+    do {
+      zeros = ~units_[++unit];
+    } while (zeros == 0);
+    return unit * UNIT_BITS + SelectInUnit(zeros, 0);
+  }
+
+  // Appends a bit.
+  void Append(bool bit) {
+    if (size_ % UNIT_BITS == 0) {
+      units_buf_.push_back(0);
+      units_ = &units_buf_[0];
+    }
+    if (bit) {
+      units_buf_.back() |= static_cast<BaseType>(1) << (size_ % UNIT_BITS);
+    }
+    ++size_;
+  }
+
+  // Builds rank and select indexes.
+  void Build() {
+    BuildIndexes(units_, size_, &ranks_buf_, &selects_buf_);
+    ranks_ = &ranks_buf_[0];
+    selects_ = &selects_buf_[0];
+    num_of_ones_ = ranks_buf_.back();
+  }
+
+  // Reads a bit vector from an input stream.
+  bool Read(std::istream *input) {
+    BaseType header[2];
+    if (!input->read(reinterpret_cast<char *>(header), sizeof(header)) ||
+        header[1] > header[0]) {
+      return false;
+    }
+    BitVector bit_vector;
+    bit_vector.size_ = header[0];
+    bit_vector.num_of_ones_ = header[1];
+
+    bit_vector.units_buf_.resize(NumOfUnits(bit_vector.size_));
+    bit_vector.ranks_buf_.resize(NumOfRanks(bit_vector.size_));
+    bit_vector.selects_buf_.resize(NumOfSelects(bit_vector.num_of_zeros()));
+    if (!ReadUnits(input, &bit_vector.units_buf_) ||
+        !ReadUnits(input, &bit_vector.ranks_buf_) ||
+        !ReadUnits(input, &bit_vector.selects_buf_)) {
+      return false;
+    }
+    bit_vector.units_ = Data(bit_vector.units_buf_);
+    bit_vector.ranks_ = Data(bit_vector.ranks_buf_);
+    bit_vector.selects_ = Data(bit_vector.selects_buf_);
+    if (!bit_vector.IsValid()) {
+      return false;
+    }
+    Swap(&bit_vector);
+    return true;
+  }
+
+  // Maps a bit vector written by Write(); *address is moved to the end
+  // of the bit vector. Indexes are checked, so all data is read once.
+  bool Map(const BaseType **address, const BaseType *end) {
+    const BaseType *header = *address;
+    if (end - header < 2 || header[1] > header[0]) {
+      return false;
+    }
+    BitVector bit_vector;
+    bit_vector.size_ = header[0];
+    bit_vector.num_of_ones_ = header[1];
+
+    SizeType num_of_units = NumOfUnits(bit_vector.size_);
+    SizeType num_of_ranks = NumOfRanks(bit_vector.size_);
+    SizeType num_of_selects = NumOfSelects(bit_vector.num_of_zeros());
+    if (static_cast<SizeType>(end - header) - 2 <
+        num_of_units + num_of_ranks + num_of_selects) {
+      return false;
+    }
+    bit_vector.units_ = header + 2;
+    bit_vector.ranks_ = bit_vector.units_ + num_of_units;
+    bit_vector.selects_ = bit_vector.ranks_ + num_of_ranks;
+    if (!bit_vector.IsValid()) {
+      return false;
+    }
+    Swap(&bit_vector);
+    *address = selects_ + num_of_selects;
+    return true;
+  }
+
+  // Writes a bit vector to an output stream.
+  bool Write(std::ostream *output) const {
+    BaseType header[2] = {
+      static_cast<BaseType>(size_), static_cast<BaseType>(num_of_ones_)
+    };
+    return output->write(reinterpret_cast<const char *>(header),
+                         sizeof(header)) &&
+        WriteUnits(output, units_, NumOfUnits(size_)) &&
+        WriteUnits(output, ranks_, NumOfRanks(size_)) &&
+        WriteUnits(output, selects_, NumOfSelects(num_of_zeros()));
+  }
+
+  // Initializes a bit vector.
+  void Clear() {
+    units_ = NULL;
+    ranks_ = NULL;
+    selects_ = NULL;
+    size_ = 0;
+    num_of_ones_ = 0;
+    std::vector<BaseType>(0).swap(units_buf_);
+    std::vector<BaseType>(0).swap(ranks_buf_);
+    std::vector<BaseType>(0).swap(selects_buf_);
+  }
+
+  // Swaps bit vectors.
+  void Swap(BitVector *bit_vector) {
+    std::swap(units_, bit_vector->units_);
+    std::swap(ranks_, bit_vector->ranks_);
+    std::swap(selects_, bit_vector->selects_);
+    std::swap(size_, bit_vector->size_);
+    std::swap(num_of_ones_, bit_vector->num_of_ones_);
+    units_buf_.swap(bit_vector->units_buf_);
+    ranks_buf_.swap(bit_vector->ranks_buf_);
+    selects_buf_.swap(bit_vector->selects_buf_);
+  }
+
+  static SizeType PopCount(BaseType unit) {
+    unit = unit - ((unit >> 1) & 0x55555555U);
+    unit = (unit & 0x33333333U) + ((unit >> 2) & 0x33333333U);
+    unit = (unit + (unit >> 4)) & 0x0F0F0F0FU;
+    return static_cast<SizeType>((unit * 0x01010101U) >> 24);
+  }
+
+ private:
+  enum {
+    UNIT_BITS = 32,
+    UNITS_PER_BLOCK = 8,
+    BLOCK_BITS = UNIT_BITS * UNITS_PER_BLOCK,
+    SELECT_INTERVAL = 512
+  };
+
+  // Units, ranks and selects point to buffers or to mapped memory.
+  const BaseType *units_;
+  // Number of 1s before each block.
+  const BaseType *ranks_;
+  // Blocks of sampled 0s.
+  const BaseType *selects_;
+  SizeType size_;
+  SizeType num_of_ones_;
+  std::vector<BaseType> units_buf_;
+  std::vector<BaseType> ranks_buf_;
+  std::vector<BaseType> selects_buf_;
+
+  // Disallows copies.
+  BitVector(const BitVector &);
+  BitVector &operator=(const BitVector &);
+
+  SizeType num_of_zeros_before(SizeType block) const {
+    return block * BLOCK_BITS - ranks_[block];
+  }
+
+  static SizeType NumOfUnits(SizeType size) {
+    return (size + UNIT_BITS - 1) / UNIT_BITS;
+  }
+  static SizeType NumOfRanks(SizeType size) {
+    return size / BLOCK_BITS + 2;
+  }
+  static SizeType NumOfSelects(SizeType num_of_zeros) {
+    return (num_of_zeros + SELECT_INTERVAL - 1) / SELECT_INTERVAL + 1;
+  }
+
+  static const BaseType *Data(const std::vector<BaseType> &units) {
+    return units.empty() ? NULL : &units[0];
+  }
+
+  // Makes rank and select indexes of size bits.
+  static void BuildIndexes(const BaseType *units, SizeType size,
+                           std::vector<BaseType> *ranks,
+                           std::vector<BaseType> *selects) {
+    SizeType num_of_units = NumOfUnits(size);
+    SizeType num_of_blocks = size / BLOCK_BITS + 1;
+    std::vector<BaseType>(num_of_blocks + 1, 0).swap(*ranks);
+    std::vector<BaseType>(0).swap(*selects);
+
+    SizeType num_of_ones = 0;
+    for (SizeType block = 0; block < num_of_blocks; ++block) {
+      (*ranks)[block] = static_cast<BaseType>(num_of_ones);
+      SizeType end = (block + 1) * UNITS_PER_BLOCK;
+      for (SizeType unit = block * UNITS_PER_BLOCK;
+           unit < end && unit < num_of_units; ++unit) {
+        num_of_ones += PopCount(units[unit]);
+      }
+    }
+    (*ranks)[num_of_blocks] = static_cast<BaseType>(num_of_ones);
+
+    // A sample is a block with the (i * SELECT_INTERVAL)-th 0.
+    SizeType num_of_samples = NumOfSelects(size - num_of_ones) - 1;
+    SizeType block = 0;
+    for (SizeType i = 0; i < num_of_samples; ++i) {
+      while (block + 1 < num_of_blocks &&
+             (block + 1) * BLOCK_BITS - (*ranks)[block + 1] <=
+             i * SELECT_INTERVAL) {
+        ++block;
+      }
+      selects->push_back(static_cast<BaseType>(block));
+    }
+    selects->push_back(static_cast<BaseType>(num_of_blocks - 1));
+  }
+
+  // Position of the (rank + 1)-th 1 in a unit.
+  static SizeType SelectInUnit(BaseType unit, SizeType rank) {
+    SizeType position = 0;
+    for ( ; ; position += 8, unit >>= 8) {
+      SizeType count = PopCount(unit & 0xFF);
+      if (rank < count) {
+        break;
+      }
+      rank -= count;
+    }
+    for ( ; rank != 0; --rank) {
+      unit &= unit - 1;
+    }
+    return position + CountTrailingZeros(unit);
+  }
+
+  static SizeType CountTrailingZeros(BaseType unit) {
+#if defined(__GNUC__)
+    return static_cast<SizeType>(__builtin_ctz(unit));
+#else  // defined(__GNUC__)
+    SizeType count = 0;
+    for ( ; (unit & 1) == 0; unit >>= 1) {
+      ++count;
+    }
+    return count;
+#endif  // defined(__GNUC__)
+  }
+
+  // Checks indexes which were read or mapped. Bits after the last one
+  // must be 0s, as they are counted by indexes.
+  bool IsValid() const {
+    if (size_ % UNIT_BITS != 0 &&
+        (units_[size_ / UNIT_BITS] >> (size_ % UNIT_BITS)) != 0) {
+      return false;
+    }
+    std::vector<BaseType> ranks;
+    std::vector<BaseType> selects;
+    BuildIndexes(units_, size_, &ranks, &selects);
+    return ranks.back() == num_of_ones_ &&
+        std::equal(ranks.begin(), ranks.end(), ranks_) &&
+        std::equal(selects.begin(), selects.end(), selects_);
+  }
+
+  static bool ReadUnits(std::istream *input, std::vector<BaseType> *units) {
+    return units->empty() ||
+        input->read(reinterpret_cast<char *>(&(*units)[0]),
+                    sizeof(BaseType) * units->size());
+  }
+
+  static bool WriteUnits(std::ostream *output, const BaseType *units,
+                         SizeType num_of_units) {
+    return num_of_units == 0 ||
+        output->write(reinterpret_cast<const char *>(units),
+                      sizeof(BaseType) * num_of_units);
+  }
+};
+
+}  // namespace dawgdic
+
+#endif  // DAWGDIC_BIT_VECTOR_H
@@ -0,0 +1,741 @@
+#ifndef DAWGDIC_BLOCK_CODEC_H
+#define DAWGDIC_BLOCK_CODEC_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <exception>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "base-types.h"
+
+namespace dawgdic {
+
+// Header of compressed data.
+struct BlockCodecHeader {
+  BaseType version;
+  // Elements of this size (units) are split into byte columns before
+  // compression, so that labels, flags and offsets of units are coded
+  // separately.
+  BaseType element_size;
+  BaseType block_size;
+  BaseType num_of_blocks;
+  unsigned long long raw_size;
+};
+
+// Compresses data in independently decodable blocks with a built-in codec.
+// Compressed data consists of a header, a table of block sizes and blocks.
+// Each block is split into byte columns and each column is stored as is,
+// Huffman-coded or LZ77-compressed and then Huffman-coded, whichever is
+// the smallest.
+class BlockCodec {
+ public:
+  enum {
+    VERSION = 1,
+    BLOCK_SIZE = 1 << 18
+  };
+
+  // Compresses data. Size of data need not be a multiple of element_size.
+  static void Compress(const char *data, SizeType size,
+                       SizeType element_size, std::vector<char> *output) {
+    if (element_size == 0 || BLOCK_SIZE % element_size != 0) {
+      element_size = 1;
+    }
+
+    BlockCodecHeader header;
+    std::memset(&header, 0, sizeof(header));
+    header.version = VERSION;
+    header.element_size = static_cast<BaseType>(element_size);
+    header.block_size = BLOCK_SIZE;
+    header.num_of_blocks = static_cast<BaseType>(
+        (size + BLOCK_SIZE - 1) / BLOCK_SIZE);
+    header.raw_size = size;
+
+    output->clear();
+    Append(&header, sizeof(header), output);
+    SizeType table_offset = output->size();
+    output->resize(table_offset + sizeof(BaseType) * header.num_of_blocks);
+
+    Encoder encoder;
+    std::vector<char> columns(BLOCK_SIZE);
+    for (BaseType i = 0; i < header.num_of_blocks; ++i) {
+      SizeType begin = static_cast<SizeType>(i) * BLOCK_SIZE;
+      SizeType block_size = size - begin;
+      if (block_size > BLOCK_SIZE) {
+        block_size = BLOCK_SIZE;
+      }
+      Transpose(data + begin, block_size, element_size, &columns[0]);
+
+      SizeType block_begin = output->size();
+      SizeType num_of_elements = block_size / element_size;
+      for (SizeType j = 0; j <= element_size; ++j) {
+        SizeType column_size = (j < element_size) ? num_of_elements :
+            (block_size - num_of_elements * element_size);
+        encoder.EncodeColumn(&columns[0] + j * num_of_elements,
+                             column_size, output);
+      }
+      BaseType entry = static_cast<BaseType>(output->size() - block_begin);
+      std::memcpy(&(*output)[table_offset + sizeof(BaseType) * i],
+                  &entry, sizeof(BaseType));
+    }
+  }
+
+  // Decompresses data into output. Blocks are decoded in parallel by
+  // num_of_threads threads (0 means the number of CPUs).
+  static bool Decompress(const char *data, SizeType size,
+                         std::vector<char> *output,
+                         SizeType num_of_threads = 0) {
+    BlockCodecHeader header;
+    if (size < sizeof(header)) {
+      return false;
+    }
+    std::memcpy(&header, data, sizeof(header));
+    if (header.version != VERSION || header.element_size == 0 ||
+        header.block_size == 0 || header.block_size > BLOCK_SIZE ||
+        header.block_size % header.element_size != 0 ||
+        header.raw_size > static_cast<SizeType>(-1) ||
+        (header.raw_size + header.block_size - 1) / header.block_size !=
+        header.num_of_blocks) {
+      return false;
+    }
+
+    SizeType table_size = sizeof(BaseType) * header.num_of_blocks;
+    if (size - sizeof(header) < table_size) {
+      return false;
+    }
+
+    Job job;
+    job.header = &header;
+    job.offsets.resize(header.num_of_blocks + 1);
+    job.offsets[0] = sizeof(header) + table_size;
+    for (BaseType i = 0; i < header.num_of_blocks; ++i) {
+      BaseType block_size;
+      std::memcpy(&block_size, data + sizeof(header) + sizeof(BaseType) * i,
+                  sizeof(BaseType));
+      if (block_size < MinBlockSize(header.element_size) ||
+          block_size > size - job.offsets[i]) {
+        return false;
+      }
+      job.offsets[i + 1] = job.offsets[i] + block_size;
+    }
+    if (job.offsets[header.num_of_blocks] != size) {
+      return false;
+    }
+    // The output is allocated before blocks are decoded, so its size
+    // must be within what the blocks can produce.
+    if (header.raw_size > static_cast<unsigned long long>(
+        size - job.offsets[0]) * MAX_EXPANSION) {
+      return false;
+    }
+
+    // Blocks are decoded straight into the final buffer.
+    std::vector<char> output_buf(static_cast<SizeType>(header.raw_size));
+    job.data = data;
+    job.output = output_buf.empty() ? NULL : &output_buf[0];
+    job.next_block = 0;
+    job.is_valid = true;
+
+    if (num_of_threads == 0) {
+      num_of_threads = std::thread::hardware_concurrency();
+    }
+    if (num_of_threads > header.num_of_blocks) {
+      num_of_threads = header.num_of_blocks;
+    }
+
+    std::vector<std::thread> threads;
+    for (SizeType i = 1; i < num_of_threads; ++i) {
+      try {
+        threads.push_back(std::thread(DecodeBlocks, &job));
+      } catch (const std::exception &) {
+        // The current thread decodes the remaining blocks.
+        break;
+      }
+    }
+    DecodeBlocks(&job);
+    for (SizeType i = 0; i < threads.size(); ++i) {
+      threads[i].join();
+    }
+
+    if (!job.is_valid) {
+      return false;
+    }
+    output->swap(output_buf);
+    return true;
+  }
+
+ private:
+  // Methods of column coding.
+  enum {
+    RAW_COLUMN = 0,
+    HUFFMAN_COLUMN = 1,
+    LZ_HUFFMAN_COLUMN = 2
+  };
+
+  enum {
+    NUM_OF_SYMBOLS = 256,
+    // Code lengths are packed into 4 bits.
+    CODE_LENGTHS_SIZE = NUM_OF_SYMBOLS / 2,
+    MAX_CODE_LENGTH = 12,
+    MIN_MATCH = 4,
+    MAX_OFFSET = (1 << 16) - 1,
+    // A byte of a Huffman code gives at most 8 bytes and a byte of an
+    // LZ77 length at most 255 bytes.
+    MAX_EXPANSION = 8 * 255,
+    HASH_BITS = 15,
+    HASH_TABLE_SIZE = 1 << HASH_BITS,
+    MAX_CHAIN_LENGTH = 32
+  };
+
+  static const BaseType EMPTY = 0xFFFFFFFFU;
+
+  // Shared state of decoding threads.
+  struct Job {
+    const BlockCodecHeader *header;
+    const char *data;
+    char *output;
+    std::vector<SizeType> offsets;
+    std::atomic<SizeType> next_block;
+    std::atomic<bool> is_valid;
+  };
+
+  // Buffers for compression.
+  class Encoder {
+   public:
+    Encoder() : table_(HASH_TABLE_SIZE), chain_(BLOCK_SIZE), lz_(),
+                huffman_(), lz_huffman_() {}
+
+    // Appends the smallest encoding of a column.
+    void EncodeColumn(const char *data, SizeType size,
+                      std::vector<char> *output) {
+      huffman_.clear();
+      lz_huffman_.clear();
+      if (size != 0) {
+        EncodeHuffman(data, size, &huffman_);
+        CompressLz(data, size, &lz_);
+        if (lz_.size() < size) {
+          BaseType lz_size = static_cast<BaseType>(lz_.size());
+          Append(&lz_size, sizeof(BaseType), &lz_huffman_);
+          EncodeHuffman(&lz_[0], lz_.size(), &lz_huffman_);
+        }
+      }
+
+      UCharType method = RAW_COLUMN;
+      const char *payload = data;
+      SizeType payload_size = size;
+      if (!huffman_.empty() && huffman_.size() < payload_size) {
+        method = HUFFMAN_COLUMN;
+        payload = &huffman_[0];
+        payload_size = huffman_.size();
+      }
+      if (!lz_huffman_.empty() && lz_huffman_.size() < payload_size) {
+        method = LZ_HUFFMAN_COLUMN;
+        payload = &lz_huffman_[0];
+        payload_size = lz_huffman_.size();
+      }
+
+      output->push_back(static_cast<char>(method));
+      BaseType base_size = static_cast<BaseType>(payload_size);
+      Append(&base_size, sizeof(BaseType), output);
+      Append(payload, payload_size, output);
+    }
+
+   private:
+    std::vector<BaseType> table_;
+    std::vector<BaseType> chain_;
+    std::vector<char> lz_;
+    std::vector<char> huffman_;
+    std::vector<char> lz_huffman_;
+
+    // Disallows copies.
+    Encoder(const Encoder &);
+    Encoder &operator=(const Encoder &);
+
+    // Greedy LZ77 compression with hash chains. A sequence is a token
+    // with lengths, literals, a 16-bit offset and an extra match length;
+    // the last sequence has no match.
+    void CompressLz(const char *data, SizeType size,
+                    std::vector<char> *output) {
+      output->clear();
+      std::fill(table_.begin(), table_.end(),
+                static_cast<BaseType>(EMPTY));
+
+      SizeType anchor = 0;
+      SizeType i = 0;
+      while (i + MIN_MATCH <= size) {
+        SizeType best_length = 0;
+        SizeType best_offset = 0;
+        BaseType candidate = table_[Hash(data + i)];
+        for (SizeType depth = 0; depth < MAX_CHAIN_LENGTH &&
+             candidate != EMPTY && i - candidate <= MAX_OFFSET; ++depth) {
+          SizeType length = 0;
+          while (i + length < size &&
+                 data[candidate + length] == data[i + length]) {
+            ++length;
+          }
+          if (length > best_length) {
+            best_length = length;
+            best_offset = i - candidate;
+          }
+          candidate = chain_[candidate];
+        }
+
+        SizeType end = (best_length >= MIN_MATCH) ?
+            (i + best_length) : (i + 1);
+        for ( ; i < end; ++i) {
+          if (i + MIN_MATCH <= size) {
+            SizeType hash = Hash(data + i);
+            chain_[i] = table_[hash];
+            table_[hash] = static_cast<BaseType>(i);
+          }
+        }
+        if (best_length >= MIN_MATCH) {
+          AppendSequence(data + anchor, end - best_length - anchor,
+                         best_offset, best_length, output);
+          anchor = end;
+        }
+      }
+      AppendSequence(data + anchor, size - anchor, 0, 0, output);
+    }
+
+    static SizeType Hash(const char *p) {
+      BaseType value;
+      std::memcpy(&value, p, sizeof(value));
+      return (value * 2654435761U) >> (32 - HASH_BITS);
+    }
+
+    static void AppendLength(SizeType length, std::vector<char> *output) {
+      for ( ; length >= 255; length -= 255) {
+        output->push_back(static_cast<char>(255));
+      }
+      output->push_back(static_cast<char>(length));
+    }
+
+    static void AppendSequence(const char *literals,
+                               SizeType num_of_literals, SizeType offset,
+                               SizeType match_length,
+                               std::vector<char> *output) {
+      SizeType token_literals = std::min<SizeType>(num_of_literals, 15);
+      SizeType token_match = 0;
+      if (match_length != 0) {
+        token_match = std::min<SizeType>(match_length - MIN_MATCH, 15);
+      }
+      output->push_back(static_cast<char>((token_literals << 4) |
+                                          token_match));
+      if (token_literals == 15) {
+        AppendLength(num_of_literals - 15, output);
+      }
+      Append(literals, num_of_literals, output);
+
+      if (match_length != 0) {
+        output->push_back(static_cast<char>(offset & 0xFF));
+        output->push_back(static_cast<char>(offset >> 8));
+        if (token_match == 15) {
+          AppendLength(match_length - MIN_MATCH - 15, output);
+        }
+      }
+    }
+
+    // Appends packed code lengths and a bit stream.
+    static void EncodeHuffman(const char *data, SizeType size,
+                              std::vector<char> *output) {
+      const UCharType *symbols = reinterpret_cast<const UCharType *>(data);
+      SizeType freqs[NUM_OF_SYMBOLS] = { 0 };
+      for (SizeType i = 0; i < size; ++i) {
+        ++freqs[symbols[i]];
+      }
+
+      UCharType lengths[NUM_OF_SYMBOLS];
+      BuildCodeLengths(freqs, lengths);
+      for (SizeType i = 0; i < NUM_OF_SYMBOLS; i += 2) {
+        output->push_back(static_cast<char>(lengths[i] |
+                                            (lengths[i + 1] << 4)));
+      }
+
+      BaseType codes[NUM_OF_SYMBOLS];
+      BuildCodes(lengths, codes);
+
+      unsigned long long bits = 0;
+      SizeType num_of_bits = 0;
+      for (SizeType i = 0; i < size; ++i) {
+        bits |= static_cast<unsigned long long>(codes[symbols[i]]) <<
+            num_of_bits;
+        num_of_bits += lengths[symbols[i]];
+        while (num_of_bits >= 8) {
+          output->push_back(static_cast<char>(bits & 0xFF));
+          bits >>= 8;
+          num_of_bits -= 8;
+        }
+      }
+      if (num_of_bits != 0) {
+        output->push_back(static_cast<char>(bits & 0xFF));
+      }
+    }
+
+    // Builds Huffman code lengths limited to MAX_CODE_LENGTH; frequencies
+    // are flattened until codes fit the limit.
+    static void BuildCodeLengths(const SizeType *freqs, UCharType *lengths) {
+      std::vector<SizeType> weights(freqs, freqs + NUM_OF_SYMBOLS);
+      for ( ; ; ) {
+        std::vector<std::pair<SizeType, SizeType> > nodes;
+        for (SizeType i = 0; i < NUM_OF_SYMBOLS; ++i) {
+          lengths[i] = 0;
+          if (weights[i] != 0) {
+            nodes.push_back(std::make_pair(weights[i], i));
+          }
+        }
+        if (nodes.size() == 1) {
+          lengths[nodes[0].second] = 1;
+          return;
+        }
+
+        // Parents of nodes; leaves are numbered by symbols.
+        std::vector<SizeType> parents(NUM_OF_SYMBOLS * 2, 0);
+        SizeType next_node = NUM_OF_SYMBOLS;
+        std::make_heap(nodes.begin(), nodes.end(), Greater());
+        while (nodes.size() > 1) {
+          std::pop_heap(nodes.begin(), nodes.end(), Greater());
+          std::pair<SizeType, SizeType> left = nodes.back();
+          nodes.pop_back();
+          std::pop_heap(nodes.begin(), nodes.end(), Greater());
+          std::pair<SizeType, SizeType> right = nodes.back();
+          nodes.pop_back();
+
+          parents[left.second] = next_node;
+          parents[right.second] = next_node;
+          nodes.push_back(std::make_pair(left.first + right.first,
+                                         next_node++));
+          std::push_heap(nodes.begin(), nodes.end(), Greater());
+        }
+
+        SizeType root = next_node - 1;
+        bool fits = true;
+        for (SizeType i = 0; i < NUM_OF_SYMBOLS; ++i) {
+          if (weights[i] == 0) {
+            continue;
+          }
+          SizeType length = 0;
+          for (SizeType node = i; node != root; node = parents[node]) {
+            ++length;
+          }
+          if (length > MAX_CODE_LENGTH) {
+            fits = false;
+            break;
+          }
+          lengths[i] = static_cast<UCharType>(length);
+        }
+        if (fits) {
+          return;
+        }
+        for (SizeType i = 0; i < NUM_OF_SYMBOLS; ++i) {
+          if (weights[i] != 0) {
+            weights[i] = (weights[i] + 1) / 2;
+          }
+        }
+      }
+    }
+
+    struct Greater {
+      bool operator()(const std::pair<SizeType, SizeType> &lhs,
+                      const std::pair<SizeType, SizeType> &rhs) const {
+        return lhs > rhs;
+      }
+    };
+  };
+
+  // Disallows instantiation.
+  BlockCodec();
+
+  static void Append(const void *data, SizeType size,
+                     std::vector<char> *output) {
+    const char *p = static_cast<const char *>(data);
+    output->insert(output->end(), p, p + size);
+  }
+
+  // Splits elements into byte columns; a trailing partial element is
+  // copied as is.
+  static void Transpose(const char *data, SizeType size,
+                        SizeType element_size, char *columns) {
+    SizeType num_of_elements = size / element_size;
+    for (SizeType i = 0; i < num_of_elements; ++i) {
+      for (SizeType j = 0; j < element_size; ++j) {
+        columns[j * num_of_elements + i] = data[i * element_size + j];
+      }
+    }
+    SizeType rest = num_of_elements * element_size;
+    std::memcpy(columns + rest, data + rest, size - rest);
+  }
+
+  static void Untranspose(const char *columns, SizeType size,
+                          SizeType element_size, char *data) {
+    SizeType num_of_elements = size / element_size;
+    for (SizeType j = 0; j < element_size; ++j) {
+      const char *column = columns + j * num_of_elements;
+      for (SizeType i = 0; i < num_of_elements; ++i) {
+        data[i * element_size + j] = column[i];
+      }
+    }
+    SizeType rest = num_of_elements * element_size;
+    std::memcpy(data + rest, columns + rest, size - rest);
+  }
+
+  // Assigns canonical codes; codes are bit-reversed because bit streams
+  // are written from the lowest bit.
+  static void BuildCodes(const UCharType *lengths, BaseType *codes) {
+    SizeType counts[MAX_CODE_LENGTH + 1] = { 0 };
+    for (SizeType i = 0; i < NUM_OF_SYMBOLS; ++i) {
+      ++counts[lengths[i]];
+    }
+    counts[0] = 0;
+
+    BaseType next_codes[MAX_CODE_LENGTH + 1] = { 0 };
+    BaseType code = 0;
+    for (SizeType length = 1; length <= MAX_CODE_LENGTH; ++length) {
+      code = (code + static_cast<BaseType>(counts[length - 1])) << 1;
+      next_codes[length] = code;
+    }
+
+    for (SizeType i = 0; i < NUM_OF_SYMBOLS; ++i) {
+      codes[i] = 0;
+      if (lengths[i] == 0) {
+        continue;
+      }
+      BaseType value = next_codes[lengths[i]]++;
+      for (SizeType j = 0; j < lengths[i]; ++j) {
+        codes[i] = (codes[i] << 1) | ((value >> j) & 1);
+      }
+    }
+  }
+
+  // Decodes a Huffman-coded column.
+  static bool DecodeHuffman(const char *data, SizeType size,
+                            char *output, SizeType output_size) {
+    if (size < CODE_LENGTHS_SIZE) {
+      return false;
+    }
+    UCharType lengths[NUM_OF_SYMBOLS];
+    SizeType kraft_sum = 0;
+    for (SizeType i = 0; i < NUM_OF_SYMBOLS; ++i) {
+      UCharType packed = static_cast<UCharType>(data[i / 2]);
+      lengths[i] = (i % 2 == 0) ? (packed & 0x0F) : (packed >> 4);
+      if (lengths[i] > MAX_CODE_LENGTH) {
+        return false;
+      }
+      if (lengths[i] != 0) {
+        kraft_sum += static_cast<SizeType>(1) <<
+            (MAX_CODE_LENGTH - lengths[i]);
+      }
+    }
+    if (kraft_sum > (static_cast<SizeType>(1) << MAX_CODE_LENGTH)) {
+      return false;
+    }
+
+    BaseType codes[NUM_OF_SYMBOLS];
+    BuildCodes(lengths, codes);
+
+    // Each entry is a symbol and a code length (0 for invalid codes).
+    std::vector<unsigned short> table(1 << MAX_CODE_LENGTH, 0);
+    for (SizeType i = 0; i < NUM_OF_SYMBOLS; ++i) {
+      if (lengths[i] == 0) {
+        continue;
+      }
+      for (SizeType j = codes[i]; j < table.size(); j += 1 << lengths[i]) {
+        table[j] = static_cast<unsigned short>((i << 8) | lengths[i]);
+      }
+    }
+
+    const UCharType *p =
+        reinterpret_cast<const UCharType *>(data) + CODE_LENGTHS_SIZE;
+    const UCharType *end = reinterpret_cast<const UCharType *>(data) + size;
+    unsigned long long bits = 0;
+    SizeType num_of_bits = 0;
+    SizeType num_of_extra_bits = 0;
+    for (SizeType i = 0; i < output_size; ++i) {
+      while (num_of_bits < MAX_CODE_LENGTH) {
+        if (p != end) {
+          bits |= static_cast<unsigned long long>(*p++) << num_of_bits;
+        } else {
+          num_of_extra_bits += 8;
+        }
+        num_of_bits += 8;
+      }
+      unsigned short entry = table[bits & ((1 << MAX_CODE_LENGTH) - 1)];
+      SizeType length = entry & 0xFF;
+      if (length == 0) {
+        return false;
+      }
+      output[i] = static_cast<char>(entry >> 8);
+      bits >>= length;
+      num_of_bits -= length;
+    }
+    // Codes must not run past the end of data.
+    return num_of_bits >= num_of_extra_bits && p == end;
+  }
+
+  static bool ReadLength(const UCharType **p, const UCharType *end,
+                         SizeType *length) {
+    UCharType byte;
+    do {
+      if (*p == end) {
+        return false;
+      }
+      byte = *(*p)++;
+      *length += byte;
+    } while (byte == 255);
+    return true;
+  }
+
+  static bool DecompressLz(const char *data, SizeType size,
+                           char *output, SizeType output_size) {
+    const UCharType *p = reinterpret_cast<const UCharType *>(data);
+    const UCharType *end = p + size;
+    SizeType position = 0;
+    while (p != end) {
+      UCharType token = *p++;
+      SizeType num_of_literals = token >> 4;
+      if (num_of_literals == 15 && !ReadLength(&p, end, &num_of_literals)) {
+        return false;
+      }
+      if (num_of_literals > static_cast<SizeType>(end - p) ||
+          num_of_literals > output_size - position) {
+        return false;
+      }
+      std::memcpy(output + position, p, num_of_literals);
+      p += num_of_literals;
+      position += num_of_literals;
+      if (p == end) {
+        break;
+      }
+
+      if (end - p < 2) {
+        return false;
+      }
+      SizeType offset = p[0] | (p[1] << 8);
+      p += 2;
+      SizeType match_length = token & 0x0F;
+      if (match_length == 15 && !ReadLength(&p, end, &match_length)) {
+        return false;
+      }
+      match_length += MIN_MATCH;
+      if (offset == 0 || offset > position ||
+          match_length > output_size - position) {
+        return false;
+      }
+      // Matches may overlap.
+      for (SizeType i = 0; i < match_length; ++i, ++position) {
+        output[position] = output[position - offset];
+      }
+    }
+    return position == output_size;
+  }
+
+  // A block has element_size + 1 columns, each of which starts with a
+  // method and a size.
+  static SizeType MinBlockSize(SizeType element_size) {
+    return (element_size + 1) * (1 + sizeof(BaseType));
+  }
+
+  // Decodes a column; p is moved to the next column.
+  static bool DecodeColumn(const char **p, const char *end, char *output,
+                           SizeType output_size,
+                           std::vector<char> *lz_buf) {
+    if (static_cast<SizeType>(end - *p) < 1 + sizeof(BaseType)) {
+      return false;
+    }
+    UCharType method = static_cast<UCharType>(**p);
+    BaseType size;
+    std::memcpy(&size, *p + 1, sizeof(BaseType));
+    const char *data = *p + 1 + sizeof(BaseType);
+    if (size > static_cast<SizeType>(end - data)) {
+      return false;
+    }
+    *p = data + size;
+
+    if (method == RAW_COLUMN) {
+      if (size != output_size) {
+        return false;
+      }
+      std::memcpy(output, data, size);
+      return true;
+    } else if (method == HUFFMAN_COLUMN) {
+      return DecodeHuffman(data, size, output, output_size);
+    } else if (method == LZ_HUFFMAN_COLUMN) {
+      BaseType lz_size;
+      if (size < sizeof(BaseType)) {
+        return false;
+      }
+      std::memcpy(&lz_size, data, sizeof(BaseType));
+      if (lz_size == 0 || lz_size > output_size) {
+        return false;
+      }
+      lz_buf->resize(lz_size);
+      return DecodeHuffman(data + sizeof(BaseType), size - sizeof(BaseType),
+                           &(*lz_buf)[0], lz_size) &&
+          DecompressLz(&(*lz_buf)[0], lz_size, output, output_size);
+    }
+    return false;
+  }
+
+  static bool DecodeBlock(const BlockCodecHeader &header, const char *data,
+                          SizeType size, char *output, SizeType output_size,
+                          std::vector<char> *columns,
+                          std::vector<char> *lz_buf) {
+    SizeType element_size = header.element_size;
+    // Columns of bytes are decoded in place.
+    char *column_output = output;
+    if (element_size != 1) {
+      columns->resize(output_size);
+      column_output = &(*columns)[0];
+    }
+
+    const char *p = data;
+    SizeType num_of_elements = output_size / element_size;
+    for (SizeType j = 0; j <= element_size; ++j) {
+      SizeType column_size = (j < element_size) ? num_of_elements :
+          (output_size - num_of_elements * element_size);
+      if (!DecodeColumn(&p, data + size, column_output + j * num_of_elements,
+                        column_size, lz_buf)) {
+        return false;
+      }
+    }
+    if (p != data + size) {
+      return false;
+    }
+
+    if (element_size != 1) {
+      Untranspose(column_output, output_size, element_size, output);
+    }
+    return true;
+  }
+
+  // Decodes blocks until there are no more blocks.
+  static void DecodeBlocks(Job *job) {
+    const BlockCodecHeader &header = *job->header;
+    std::vector<char> columns;
+    std::vector<char> lz_buf;
+    for ( ; ; ) {
+      SizeType i = job->next_block++;
+      if (i >= header.num_of_blocks || !job->is_valid) {
+        break;
+      }
+
+      SizeType begin = i * header.block_size;
+      SizeType block_size = static_cast<SizeType>(header.raw_size) - begin;
+      if (block_size > header.block_size) {
+        block_size = header.block_size;
+      }
+      if (!DecodeBlock(header, job->data + job->offsets[i],
+                       job->offsets[i + 1] - job->offsets[i],
+                       job->output + begin, block_size,
+                       &columns, &lz_buf)) {
+        job->is_valid = false;
+        break;
+      }
+    }
+  }
+};
+
+}  // namespace dawgdic
+
+#endif  // DAWGDIC_BLOCK_CODEC_H
@@ -4,6 +4,7 @@
 #include "dictionary.h"
 #include "guide.h"
 
+#include <cstring>
 #include <vector>
 
 namespace dawgdic {
@@ -11,9 +12,11 @@ namespace dawgdic {
 class Completer {
  public:
   Completer()
-    : dic_(NULL), guide_(NULL), key_(), index_stack_(), last_index_(0) {}
+    : dic_(NULL), guide_(NULL), key_(), index_stack_(), last_index_(0),
+      tail_length_(0) {}
   Completer(const Dictionary &dic, const Guide &guide)
-    : dic_(&dic), guide_(&guide), key_(), index_stack_(), last_index_(0) {}
+    : dic_(&dic), guide_(&guide), key_(), index_stack_(), last_index_(0),
+      tail_length_(0) {}
 
   void set_dic(const Dictionary &dic) {
     dic_ = &dic;
@@ -40,6 +43,11 @@ class Completer {
     return dic_->value(last_index_);
   }
 
+  // Size of buffers for a key and a stack of indices in bytes.
+  SizeType total_size() const {
+    return key_.capacity() + sizeof(BaseType) * index_stack_.capacity();
+  }
+
   // Starts completing keys from given index and prefix.
   void Start(BaseType index, const char *prefix = "") {
     SizeType length = 0;
@@ -60,6 +68,7 @@ class Completer {
       index_stack_.push_back(index);
       last_index_ = dic_->root();
     }
+    tail_length_ = 0;
   }
 
   // Gets the next key.
@@ -70,14 +79,21 @@ class Completer {
     BaseType index = index_stack_.back();
 
     if (last_index_ != dic_->root()) {
-      UCharType child_label = guide_->child(index);
+      // Removes labels of a tail.
+      if (tail_length_ != 0) {
+        key_.resize(key_.size() - tail_length_);
+        key_.back() = '\0';
+        tail_length_ = 0;
+      }
+
+      UCharType child_label = child(index);
       if (child_label != '\0') {
         // Follows a transition to the first child.
         if (!Follow(child_label, &index))
           return false;
       } else {
         for ( ; ; ) {
-          UCharType sibling_label = guide_->sibling(index);
+          UCharType sibling_label = sibling(index);
 
           // Moves to the previous node.
           if (key_.size() > 1) {
@@ -111,6 +127,7 @@ class Completer {
   std::vector<UCharType> key_;
   std::vector<BaseType> index_stack_;
   BaseType last_index_;
+  SizeType tail_length_;
 
   // Disallows copies.
   Completer(const Completer &);
@@ -128,10 +145,36 @@ class Completer {
     return true;
   }
 
+  // Gets labels from a guide; positions in tails have no guide units.
+  UCharType child(BaseType index) const {
+    return (index < guide_->size()) ? guide_->child(index) : '\0';
+  }
+  UCharType sibling(BaseType index) const {
+    return (index < guide_->size()) ? guide_->sibling(index) : '\0';
+  }
+
+  // Appends the rest of a tail to a key.
+  bool FollowTail(BaseType index) {
+    BaseType tail_index;
+    if (!dic_->FindTail(index, &tail_index)) {
+      return false;
+    }
+
+    const CharType *chars = dic_->tail_chars(tail_index);
+    tail_length_ = std::strlen(chars);
+    key_.insert(key_.end() - 1, chars, chars + tail_length_);
+
+    last_index_ = tail_index + static_cast<BaseType>(tail_length_);
+    return true;
+  }
+
   // Finds a terminal.
   bool FindTerminal(BaseType index) {
     while (!dic_->has_value(index)) {
-      UCharType label = guide_->child(index);
+      UCharType label = child(index);
+      if (label == '\0') {
+        return FollowTail(index);
+      }
       if (!dic_->Follow(label, &index)) {
         return false;
       }
@@ -0,0 +1,609 @@
+#ifndef DAWGDIC_CONTAINER_H
+#define DAWGDIC_CONTAINER_H
+
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif  // _WIN32
+
+#include "base-types.h"
+#include "block-codec.h"
+#include "crc32c.h"
+#include "dictionary.h"
+#include "guide.h"
+#include "payload-table.h"
+#include "ranked-guide.h"
+#include "succinct-dawg.h"
+
+namespace dawgdic {
+
+// 64-bit unsigned integer for file offsets.
+typedef unsigned long long ContainerOffsetType;
+
+enum ContainerSectionId {
+  CONTAINER_DICTIONARY = 0,
+  CONTAINER_GUIDE = 1,
+  CONTAINER_RANKED_GUIDE = 2,
+  CONTAINER_VALUES = 3,
+  CONTAINER_METADATA = 4,
+  CONTAINER_SUCCINCT_DAWG = 5,
+  // Number of entries in a section table (some of them are reserved).
+  CONTAINER_MAX_SECTIONS = 8
+};
+
+// Entry of a section table.
+struct ContainerSection {
+  enum {
+    HAS_CHECKSUM = 1,
+    // Data is compressed with BlockCodec.
+    COMPRESSED = 2,
+    KNOWN_FLAGS = HAS_CHECKSUM | COMPRESSED
+  };
+
+  ContainerOffsetType offset;
+  ContainerOffsetType size;
+  BaseType checksum;
+  BaseType flags;
+};
+
+// Header of a container file. All sections start at offsets aligned to
+// page_size (a multiple of a memory page) so that every section can be
+// mapped independently.
+struct ContainerHeader {
+  enum {
+    VERSION = 1,
+    BYTE_ORDER_MARK = 0x01020304,
+    SECTION_ALIGNMENT = 4096,
+    MAGIC_SIZE = 8,
+    CLASS_TAG_SIZE = 32
+  };
+
+  char magic[MAGIC_SIZE];
+  BaseType version;
+  BaseType byte_order;
+  BaseType unit_size;
+  BaseType page_size;
+  BaseType num_of_sections;
+  BaseType checksum;
+  char class_tag[CLASS_TAG_SIZE];
+  ContainerSection sections[CONTAINER_MAX_SECTIONS];
+
+  static const char *Magic() {
+    return "DAWGDIC";
+  }
+
+  // Checks if data starts with a container header.
+  static bool HasMagic(const void *data, SizeType size) {
+    return size >= MAGIC_SIZE &&
+        std::memcmp(data, Magic(), MAGIC_SIZE) == 0;
+  }
+};
+
+// Writes sections into a container. Checksums of compressed sections are
+// calculated for compressed data.
+class ContainerWriter {
+ public:
+  explicit ContainerWriter(const char *class_tag, bool use_checksums = true,
+                           bool use_compression = false)
+    : class_tag_(class_tag), use_checksums_(use_checksums),
+      use_compression_(use_compression),
+      sections_(CONTAINER_MAX_SECTIONS),
+      has_section_(CONTAINER_MAX_SECTIONS),
+      is_compressed_(CONTAINER_MAX_SECTIONS) {}
+
+  // Sets data of a section; data is copied (and compressed if compression
+  // is enabled). Data of units is compressed better if element_size is
+  // the size of a unit.
+  void SetSection(SizeType id, const char *data, SizeType size,
+                  SizeType element_size = 1) {
+    if (use_compression_) {
+      BlockCodec::Compress(data, size, element_size, &sections_[id]);
+      is_compressed_[id] = true;
+    } else {
+      sections_[id].assign(data, data + size);
+      is_compressed_[id] = false;
+    }
+    has_section_[id] = true;
+  }
+
+  // Writes a container to an output stream.
+  bool Write(std::ostream *output) const {
+    ContainerHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, ContainerHeader::Magic(),
+                ContainerHeader::MAGIC_SIZE);
+    header.version = ContainerHeader::VERSION;
+    header.byte_order = ContainerHeader::BYTE_ORDER_MARK;
+    header.unit_size = sizeof(DictionaryUnit);
+    header.page_size = ContainerHeader::SECTION_ALIGNMENT;
+    header.num_of_sections = CONTAINER_MAX_SECTIONS;
+    std::strncpy(header.class_tag, class_tag_.c_str(),
+                 ContainerHeader::CLASS_TAG_SIZE - 1);
+
+    ContainerOffsetType offset = AlignOffset(sizeof(header));
+    for (SizeType id = 0; id < CONTAINER_MAX_SECTIONS; ++id) {
+      if (!has_section_[id]) {
+        continue;
+      }
+      ContainerSection &section = header.sections[id];
+      section.offset = offset;
+      section.size = sections_[id].size();
+      if (use_checksums_) {
+        section.checksum = Crc32c::Calculate(Data(id), section.size);
+        section.flags |= ContainerSection::HAS_CHECKSUM;
+      }
+      if (is_compressed_[id]) {
+        section.flags |= ContainerSection::COMPRESSED;
+      }
+      offset = AlignOffset(offset + section.size);
+    }
+    header.checksum = Crc32c::Calculate(&header, sizeof(header));
+
+    if (!output->write(reinterpret_cast<const char *>(&header),
+                       sizeof(header))) {
+      return false;
+    }
+
+    ContainerOffsetType position = sizeof(header);
+    for (SizeType id = 0; id < CONTAINER_MAX_SECTIONS; ++id) {
+      if (!has_section_[id]) {
+        continue;
+      }
+      const ContainerSection &section = header.sections[id];
+      if (!WritePadding(output, section.offset - position) ||
+          !output->write(Data(id), sections_[id].size())) {
+        return false;
+      }
+      position = section.offset + section.size;
+    }
+    return WritePadding(output, AlignOffset(position) - position);
+  }
+
+ private:
+  std::string class_tag_;
+  bool use_checksums_;
+  bool use_compression_;
+  std::vector<std::vector<char> > sections_;
+  std::vector<bool> has_section_;
+  std::vector<bool> is_compressed_;
+
+  // Disallows copies.
+  ContainerWriter(const ContainerWriter &);
+  ContainerWriter &operator=(const ContainerWriter &);
+
+  const char *Data(SizeType id) const {
+    return sections_[id].empty() ? "" : &sections_[id][0];
+  }
+
+  static ContainerOffsetType AlignOffset(ContainerOffsetType offset) {
+    const ContainerOffsetType mask = ContainerHeader::SECTION_ALIGNMENT - 1;
+    return (offset + mask) & ~mask;
+  }
+
+  static bool WritePadding(std::ostream *output, ContainerOffsetType size) {
+    static const char zeros[ContainerHeader::SECTION_ALIGNMENT] = { '\0' };
+    return size == 0 || output->write(zeros, static_cast<SizeType>(size));
+  }
+};
+
+// Reads sections from a container. Sections of a file are mapped on
+// first access and their checksums are verified only on request.
+// Compressed sections are decompressed on first access.
+class Container {
+ public:
+  Container()
+    : header_(), file_size_(0), fd_(-1), buf_(),
+      stored_addresses_(CONTAINER_MAX_SECTIONS,
+                        static_cast<const char *>(NULL)),
+      addresses_(CONTAINER_MAX_SECTIONS, static_cast<const char *>(NULL)),
+      mappings_(CONTAINER_MAX_SECTIONS, static_cast<void *>(NULL)),
+      mapping_sizes_(CONTAINER_MAX_SECTIONS, 0),
+      decoded_(CONTAINER_MAX_SECTIONS),
+      verified_(CONTAINER_MAX_SECTIONS, false) {
+    std::memset(&header_, 0, sizeof(header_));
+  }
+  ~Container() {
+    Close();
+  }
+
+  // Opens a container file. If use_mmap is false the whole file is read
+  // into memory; otherwise sections are memory-mapped on first access.
+  bool Open(const char *path, bool use_mmap = true) {
+    Close();
+#ifndef _WIN32
+    if (use_mmap) {
+      fd_ = ::open(path, O_RDONLY);
+      if (fd_ == -1) {
+        return false;
+      }
+      struct stat st;
+      if (::fstat(fd_, &st) != 0 || !ReadHeader(st.st_size)) {
+        Close();
+        return false;
+      }
+      return true;
+    }
+#endif  // _WIN32
+
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+      return false;
+    }
+    file.seekg(0, std::ios::end);
+    std::vector<char> buf(static_cast<SizeType>(file.tellg()));
+    file.seekg(0, std::ios::beg);
+    if (!buf.empty() && !file.read(&buf[0], buf.size())) {
+      return false;
+    }
+    return Swap(&buf);
+  }
+
+  // Reads a container from memory; data is copied.
+  bool Load(const char *data, SizeType size) {
+    Close();
+    std::vector<char> buf(data, data + size);
+    return Swap(&buf);
+  }
+
+  // Unmaps sections and frees memory.
+  void Close() {
+    for (SizeType id = 0; id < CONTAINER_MAX_SECTIONS; ++id) {
+#ifndef _WIN32
+      if (mappings_[id] != NULL) {
+        ::munmap(mappings_[id], mapping_sizes_[id]);
+      }
+#endif  // _WIN32
+      stored_addresses_[id] = NULL;
+      addresses_[id] = NULL;
+      mappings_[id] = NULL;
+      mapping_sizes_[id] = 0;
+      std::vector<char>(0).swap(decoded_[id]);
+      verified_[id] = false;
+    }
+#ifndef _WIN32
+    if (fd_ != -1) {
+      ::close(fd_);
+    }
+#endif  // _WIN32
+    fd_ = -1;
+    std::vector<char>(0).swap(buf_);
+    std::memset(&header_, 0, sizeof(header_));
+    file_size_ = 0;
+  }
+
+  const char *class_tag() const {
+    return header_.class_tag;
+  }
+  BaseType version() const {
+    return header_.version;
+  }
+  ContainerOffsetType file_size() const {
+    return file_size_;
+  }
+
+  bool has_section(SizeType id) const {
+    return id < CONTAINER_MAX_SECTIONS && header_.sections[id].offset != 0;
+  }
+  bool has_checksum(SizeType id) const {
+    return has_section(id) && (header_.sections[id].flags &
+                               ContainerSection::HAS_CHECKSUM) != 0;
+  }
+  bool is_compressed(SizeType id) const {
+    return has_section(id) && (header_.sections[id].flags &
+                               ContainerSection::COMPRESSED) != 0;
+  }
+  // Gets a size of section data; compressed sections are decompressed.
+  SizeType section_size(SizeType id) {
+    if (!has_section(id)) {
+      return 0;
+    } else if (is_compressed(id)) {
+      return (section(id) != NULL) ? decoded_[id].size() : 0;
+    }
+    return static_cast<SizeType>(header_.sections[id].size);
+  }
+  // Checks if a section is mapped from a file (not read into memory).
+  bool is_mapped(SizeType id) const {
+    return id < CONTAINER_MAX_SECTIONS && mappings_[id] != NULL;
+  }
+
+  // Number of bytes of a container in memory: a file read into memory
+  // and decompressed sections. Mappings are not counted.
+  SizeType heap_size() const {
+    SizeType size = buf_.capacity();
+    for (SizeType id = 0; id < CONTAINER_MAX_SECTIONS; ++id) {
+      size += decoded_[id].capacity();
+    }
+    return size;
+  }
+  // Number of bytes of a section in memory: its data in a file read into
+  // memory and its decompressed data.
+  SizeType heap_size(SizeType id) const {
+    if (!has_section(id)) {
+      return 0;
+    }
+    SizeType size = decoded_[id].capacity();
+    if (!buf_.empty()) {
+      size += static_cast<SizeType>(header_.sections[id].size);
+    }
+    return size;
+  }
+  // Size of a mapping of a section; it starts at a system page.
+  SizeType mapped_size(SizeType id) const {
+    return (id < CONTAINER_MAX_SECTIONS) ? mapping_sizes_[id] : 0;
+  }
+  // Number of bytes of a mapping of a section which are resident in
+  // physical memory now.
+  SizeType resident_size(SizeType id) const {
+    SizeType size = 0;
+#ifndef _WIN32
+    if (!is_mapped(id)) {
+      return 0;
+    }
+    SizeType page_size = static_cast<SizeType>(::sysconf(_SC_PAGESIZE));
+    SizeType num_of_pages = (mapping_sizes_[id] + page_size - 1) / page_size;
+#ifdef __linux__
+    std::vector<unsigned char> pages(num_of_pages);
+#else  // __linux__
+    std::vector<char> pages(num_of_pages);
+#endif  // __linux__
+    if (::mincore(mappings_[id], mapping_sizes_[id], &pages[0]) != 0) {
+      return 0;
+    }
+    for (SizeType i = 0; i < num_of_pages; ++i) {
+      if (pages[i] & 1) {
+        size += page_size;
+      }
+    }
+    if (size > mapping_sizes_[id]) {
+      size = mapping_sizes_[id];
+    }
+#endif  // _WIN32
+    return size;
+  }
+
+  // Gets data of a section or NULL if there is no such section (or it
+  // can't be decompressed).
+  const char *section(SizeType id) {
+    if (!has_section(id)) {
+      return NULL;
+    } else if (addresses_[id] != NULL) {
+      return addresses_[id];
+    }
+    const char *data = stored_section(id);
+    if (data == NULL || !is_compressed(id)) {
+      addresses_[id] = data;
+    } else if (BlockCodec::Decompress(
+        data, static_cast<SizeType>(header_.sections[id].size),
+        &decoded_[id])) {
+      addresses_[id] = decoded_[id].empty() ? "" : &decoded_[id][0];
+    }
+    return addresses_[id];
+  }
+
+  // Verifies a checksum of a section; sections without checksums are
+  // always valid. The result is cached.
+  bool VerifySection(SizeType id) {
+    if (!has_section(id)) {
+      return false;
+    }
+    if (verified_[id] || !has_checksum(id)) {
+      return true;
+    }
+    const char *data = stored_section(id);
+    if (data == NULL) {
+      return false;
+    }
+    verified_[id] = Crc32c::Calculate(
+        data, static_cast<SizeType>(header_.sections[id].size)) ==
+        header_.sections[id].checksum;
+    return verified_[id];
+  }
+
+  // Verifies checksums of all sections.
+  bool VerifyAll() {
+    for (SizeType id = 0; id < CONTAINER_MAX_SECTIONS; ++id) {
+      if (has_section(id) && !VerifySection(id)) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  // Maps sections into objects.
+  bool Map(SizeType id, Dictionary *dic) {
+    const char *data = section(id);
+    SizeType size = section_size(id);
+    if (data != NULL && size >= sizeof(BaseType) &&
+        (*reinterpret_cast<const BaseType *>(data) &
+         Dictionary::HAS_TAIL_FLAG)) {
+      // Units are mapped and tails are copied.
+      return dic->MapImage(data, size);
+    }
+    // A dictionary must have at least a root unit.
+    return MapUnits<DictionaryUnit>(id, dic, 1);
+  }
+  bool Map(SizeType id, Guide *guide) {
+    return MapUnits<GuideUnit>(id, guide, 0);
+  }
+  bool Map(SizeType id, RankedGuide *guide) {
+    return MapUnits<RankedGuideUnit>(id, guide, 0);
+  }
+  bool Map(SizeType id, PayloadTable *table) {
+    const char *data = section(id);
+    SizeType size = section_size(id);
+    if (data == NULL || size < sizeof(BaseType)) {
+      return false;
+    }
+    const BaseType *values = reinterpret_cast<const BaseType *>(data);
+    SizeType num_of_offsets = static_cast<SizeType>(values[0]) + 1;
+    if (num_of_offsets > (size / sizeof(BaseType)) - 1) {
+      return false;
+    }
+    const BaseType *offsets = values + 1;
+    for (SizeType i = 1; i < num_of_offsets; ++i) {
+      if (offsets[i] < offsets[i - 1]) {
+        return false;
+      }
+    }
+    if (size != sizeof(BaseType) * (num_of_offsets + 1) +
+                offsets[num_of_offsets - 1]) {
+      return false;
+    }
+    table->Map(data);
+    return true;
+  }
+  bool Map(SizeType id, SuccinctDawg *dawg) {
+    const char *data = section(id);
+    return data != NULL && dawg->Map(data, section_size(id));
+  }
+
+ private:
+  ContainerHeader header_;
+  ContainerOffsetType file_size_;
+  int fd_;
+  std::vector<char> buf_;
+  std::vector<const char *> stored_addresses_;
+  std::vector<const char *> addresses_;
+  std::vector<void *> mappings_;
+  std::vector<SizeType> mapping_sizes_;
+  std::vector<std::vector<char> > decoded_;
+  std::vector<bool> verified_;
+
+  // Disallows copies.
+  Container(const Container &);
+  Container &operator=(const Container &);
+
+  // Takes an in-memory container.
+  bool Swap(std::vector<char> *buf) {
+    buf_.swap(*buf);
+    if (buf_.size() < sizeof(header_)) {
+      Close();
+      return false;
+    }
+    std::memcpy(&header_, &buf_[0], sizeof(header_));
+    if (!CheckHeader(buf_.size())) {
+      Close();
+      return false;
+    }
+    for (SizeType id = 0; id < CONTAINER_MAX_SECTIONS; ++id) {
+      if (has_section(id)) {
+        stored_addresses_[id] = &buf_[0] + header_.sections[id].offset;
+      }
+    }
+    return true;
+  }
+
+  // Reads a header of a memory-mapped container.
+  bool ReadHeader(ContainerOffsetType file_size) {
+#ifndef _WIN32
+    if (file_size < sizeof(header_) ||
+        ::pread(fd_, &header_, sizeof(header_), 0) !=
+        static_cast<ssize_t>(sizeof(header_))) {
+      return false;
+    }
+#endif  // _WIN32
+    return CheckHeader(file_size);
+  }
+
+  // Checks a header.
+  bool CheckHeader(ContainerOffsetType file_size) {
+    if (!ContainerHeader::HasMagic(header_.magic, sizeof(header_.magic)) ||
+        header_.version > ContainerHeader::VERSION ||
+        header_.byte_order != ContainerHeader::BYTE_ORDER_MARK ||
+        header_.unit_size != sizeof(DictionaryUnit) ||
+        header_.page_size == 0 ||
+        (header_.page_size & (header_.page_size - 1)) != 0 ||
+        header_.num_of_sections != CONTAINER_MAX_SECTIONS ||
+        header_.class_tag[ContainerHeader::CLASS_TAG_SIZE - 1] != '\0') {
+      return false;
+    }
+
+    BaseType checksum = header_.checksum;
+    header_.checksum = 0;
+    bool is_valid = Crc32c::Calculate(&header_, sizeof(header_)) == checksum;
+    header_.checksum = checksum;
+    if (!is_valid) {
+      return false;
+    }
+
+    for (SizeType id = 0; id < CONTAINER_MAX_SECTIONS; ++id) {
+      const ContainerSection &section = header_.sections[id];
+      if (section.offset == 0) {
+        continue;
+      }
+      if ((section.flags & ~ContainerSection::KNOWN_FLAGS) != 0 ||
+          section.offset % header_.page_size != 0 ||
+          section.offset > file_size ||
+          section.size > file_size - section.offset) {
+        return false;
+      }
+    }
+    file_size_ = file_size;
+    return true;
+  }
+
+  // Gets data of a section as it is stored in a file.
+  const char *stored_section(SizeType id) {
+    if (stored_addresses_[id] == NULL) {
+      MapSection(id);
+    }
+    return stored_addresses_[id];
+  }
+
+  // Maps a section of a file into memory.
+  void MapSection(SizeType id) {
+#ifndef _WIN32
+    if (fd_ == -1) {
+      return;
+    }
+    const ContainerSection &section = header_.sections[id];
+
+    // The system page may be larger than the page of a container.
+    ContainerOffsetType page_size = ::sysconf(_SC_PAGESIZE);
+    ContainerOffsetType begin = section.offset & ~(page_size - 1);
+    SizeType delta = static_cast<SizeType>(section.offset - begin);
+    SizeType size = delta + static_cast<SizeType>(section.size);
+    if (size == 0) {
+      size = 1;
+    }
+
+    void *mapping = ::mmap(NULL, size, PROT_READ, MAP_SHARED, fd_,
+                           static_cast<off_t>(begin));
+    if (mapping == MAP_FAILED) {
+      return;
+    }
+    mappings_[id] = mapping;
+    mapping_sizes_[id] = size;
+    stored_addresses_[id] = static_cast<const char *>(mapping) + delta;
+#endif  // _WIN32
+  }
+
+  template <typename UNIT_TYPE, typename OBJECT_TYPE>
+  bool MapUnits(SizeType id, OBJECT_TYPE *object,
+                SizeType min_num_of_units) {
+    const char *data = section(id);
+    SizeType size = section_size(id);
+    if (data == NULL || size < sizeof(BaseType)) {
+      return false;
+    }
+    SizeType num_of_units = *reinterpret_cast<const BaseType *>(data);
+    if (num_of_units < min_num_of_units ||
+        size != sizeof(BaseType) + sizeof(UNIT_TYPE) * num_of_units) {
+      return false;
+    }
+    object->Map(data);
+    return true;
+  }
+};
+
+}  // namespace dawgdic
+
+#endif  // DAWGDIC_CONTAINER_H
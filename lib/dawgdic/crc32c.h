@@ -0,0 +1,73 @@
+#ifndef DAWGDIC_CRC32C_H
+#define DAWGDIC_CRC32C_H
+
+#include "base-types.h"
+
+namespace dawgdic {
+
+// CRC-32C (Castagnoli), slicing-by-8 software implementation.
+class Crc32c {
+ public:
+  // Calculates a checksum of a given data.
+  static BaseType Calculate(const void *data, SizeType size,
+                            BaseType crc = 0) {
+    const BaseType (*table)[256] = Table();
+    const UCharType *p = static_cast<const UCharType *>(data);
+
+    crc = ~crc;
+    for ( ; size != 0 && (reinterpret_cast<SizeType>(p) & 7) != 0; --size) {
+      crc = table[0][(crc ^ *p++) & 0xFF] ^ (crc >> 8);
+    }
+    for ( ; size >= 8; size -= 8, p += 8) {
+      BaseType lo = crc ^ (p[0] | (p[1] << 8) | (p[2] << 16) |
+                           (static_cast<BaseType>(p[3]) << 24));
+      BaseType hi = p[4] | (p[5] << 8) | (p[6] << 16) |
+                    (static_cast<BaseType>(p[7]) << 24);
+      crc = table[7][lo & 0xFF] ^ table[6][(lo >> 8) & 0xFF] ^
+            table[5][(lo >> 16) & 0xFF] ^ table[4][lo >> 24] ^
+            table[3][hi & 0xFF] ^ table[2][(hi >> 8) & 0xFF] ^
+            table[1][(hi >> 16) & 0xFF] ^ table[0][hi >> 24];
+    }
+    for ( ; size != 0; --size) {
+      crc = table[0][(crc ^ *p++) & 0xFF] ^ (crc >> 8);
+    }
+    return ~crc;
+  }
+
+ private:
+  // Reflected polynomial.
+  static const BaseType POLYNOMIAL = 0x82F63B78U;
+
+  // Disallows instantiation.
+  Crc32c();
+
+  // Lookup tables for slicing-by-8.
+  struct Tables {
+    BaseType table[8][256];
+
+    Tables() {
+      for (BaseType i = 0; i < 256; ++i) {
+        BaseType crc = i;
+        for (int j = 0; j < 8; ++j) {
+          crc = (crc >> 1) ^ ((crc & 1) ? POLYNOMIAL : 0);
+        }
+        table[0][i] = crc;
+      }
+      for (BaseType i = 0; i < 256; ++i) {
+        for (int k = 1; k < 8; ++k) {
+          table[k][i] = (table[k - 1][i] >> 8) ^
+                        table[0][table[k - 1][i] & 0xFF];
+        }
+      }
+    }
+  };
+
+  static const BaseType (*Table())[256] {
+    static const Tables tables;
+    return tables.table;
+  }
+};
+
+}  // namespace dawgdic
+
+#endif  // DAWGDIC_CRC32C_H
@@ -2,7 +2,6 @@
 #define DAWGDIC_DAWG_BUILDER_H
 
 #include <algorithm>
-#include <stack>
 #include <vector>
 
 #include "dawg.h"
@@ -13,12 +12,19 @@ namespace dawgdic {
 // DAWG builder.
 class DawgBuilder {
  public:
+  // The hash table is expanded when it is 3/4 full; an initial size of
+  // about 4/3 of the expected number of states avoids expansions. The
+  // size is rounded up to a power of 2. If merges_states is false,
+  // equivalent states are not merged and the builder builds a trie.
   explicit DawgBuilder(SizeType initial_hash_table_size =
-                       DEFAULT_INITIAL_HASH_TABLE_SIZE)
-    : initial_hash_table_size_(initial_hash_table_size),
-      base_pool_(), label_pool_(), flag_pool_(), unit_pool_(),
+                       DEFAULT_INITIAL_HASH_TABLE_SIZE,
+                       bool merges_states = true)
+    : initial_hash_table_size_(HashTableSize(initial_hash_table_size)),
+      merges_states_(merges_states), base_pool_(), label_pool_(),
+      flag_pool_(), unit_pool_(),
       hash_table_(), unfixed_units_(), unused_units_(), num_of_states_(1),
-      num_of_merged_transitions_(0), num_of_merging_states_(0) {}
+      num_of_merged_transitions_(0), num_of_merging_states_(0),
+      num_of_expansions_(0), peak_total_size_(0) {}
 
   // Number of units.
   SizeType size() const {
@@ -45,6 +51,31 @@ class DawgBuilder {
   SizeType num_of_merging_states() const {
     return num_of_merging_states_;
   }
+  // Size of pools, the hash table and stacks in bytes.
+  SizeType total_size() const {
+    return base_pool_.total_size() + label_pool_.total_size() +
+        flag_pool_.total_size() + unit_pool_.total_size() +
+        sizeof(unsigned long long) * hash_table_.capacity() +
+        sizeof(BaseType) * (unfixed_units_.capacity() +
+                            unused_units_.capacity());
+  }
+
+  // Statistics of the last build. They are kept after Finish() until
+  // the next key is inserted.
+
+  // Number of hash table expansions.
+  SizeType num_of_expansions() const {
+    return num_of_expansions_;
+  }
+  // Size of the hash table; it is doubled on each expansion.
+  SizeType hash_table_size() const {
+    return initial_hash_table_size_ << num_of_expansions_;
+  }
+  // The largest total_size() during a build, including the old table
+  // which is kept while the hash table is expanded.
+  SizeType peak_total_size() const {
+    return peak_total_size_;
+  }
 
   // Initializes a builder.
   void Clear() {
@@ -53,13 +84,9 @@ class DawgBuilder {
     flag_pool_.Clear();
     unit_pool_.Clear();
 
-    std::vector<BaseType>(0).swap(hash_table_);
-    while (!unfixed_units_.empty()) {
-      unfixed_units_.pop();
-    }
-    while (!unused_units_.empty()) {
-      unused_units_.pop();
-    }
+    std::vector<unsigned long long>(0).swap(hash_table_);
+    std::vector<BaseType>(0).swap(unfixed_units_);
+    std::vector<BaseType>(0).swap(unused_units_);
 
     num_of_states_ = 1;
     num_of_merged_transitions_ = 0;
@@ -101,6 +128,7 @@ class DawgBuilder {
     FixUnits(0);
     base_pool_[0].set_base(unit_pool_[0].base());
     label_pool_[0] = unit_pool_[0].label();
+    UpdatePeakTotalSize(0);
 
     dawg->set_num_of_states(num_of_states_);
     dawg->set_num_of_merged_transitions(num_of_merged_transitions_);
@@ -115,22 +143,94 @@ class DawgBuilder {
     return true;
   }
 
+  // Builds a dawg of keys inserted so far. Unlike Finish(), this doesn't
+  // change the builder, so more keys can be inserted after a snapshot;
+  // the dawg is the same as the one which Finish() would build. Pools
+  // are copied, so this takes time linear in the size of the dawg.
+  bool Snapshot(Dawg *dawg) const {
+    if (hash_table_.empty()) {
+      DawgBuilder builder;
+      return builder.Finish(dawg);
+    }
+
+    ObjectPool<BaseUnit> base_pool;
+    ObjectPool<UCharType> label_pool;
+    BitPool<> flag_pool;
+    base_pool.Copy(base_pool_);
+    label_pool.Copy(label_pool_);
+    flag_pool.Copy(flag_pool_);
+    SizeType num_of_states = num_of_states_;
+    SizeType num_of_merged_transitions = num_of_merged_transitions_;
+    SizeType num_of_merging_states = num_of_merging_states_;
+
+    // Fixes units of the last key like FixUnits(0) but into the copies.
+    // New states are not added to the hash table because they can't be
+    // equivalent to each other (they are on the same path).
+    BaseType matched_index = 0;
+    for (SizeType i = unfixed_units_.size() - 1; i > 0; --i) {
+      DawgUnit unit = unit_pool_[unfixed_units_[i]];
+      if (i + 1 < unfixed_units_.size()) {
+        unit.set_child(matched_index);
+      }
+
+      BaseType hash_id;
+      matched_index = merges_states_ ?
+          FindUnit(unit, HashUnit(unit), &hash_id) : 0;
+      if (matched_index != 0) {
+        num_of_merged_transitions += CountSiblings(unit);
+        if (flag_pool.get(matched_index) == false) {
+          ++num_of_merging_states;
+          flag_pool.set(matched_index, true);
+        }
+      } else {
+        matched_index = AppendTransitions(unit, &base_pool, &label_pool,
+                                          &flag_pool);
+        ++num_of_states;
+      }
+    }
+
+    DawgUnit root = unit_pool_[0];
+    if (unfixed_units_.size() > 1) {
+      root.set_child(matched_index);
+    }
+    base_pool[0].set_base(root.base());
+    label_pool[0] = root.label();
+
+    SizeType num_of_transitions = base_pool.size() - 1;
+    dawg->set_num_of_states(num_of_states);
+    dawg->set_num_of_merged_transitions(num_of_merged_transitions);
+    dawg->set_num_of_merged_states(num_of_transitions +
+        num_of_merged_transitions + 1 - num_of_states);
+    dawg->set_num_of_merging_states(num_of_merging_states);
+
+    dawg->SwapBasePool(&base_pool);
+    dawg->SwapLabelPool(&label_pool);
+    dawg->SwapFlagPool(&flag_pool);
+    return true;
+  }
+
  private:
   enum {
     DEFAULT_INITIAL_HASH_TABLE_SIZE = 1 << 8
   };
 
   const SizeType initial_hash_table_size_;
+  const bool merges_states_;
   ObjectPool<BaseUnit> base_pool_;
   ObjectPool<UCharType> label_pool_;
   BitPool<> flag_pool_;
   ObjectPool<DawgUnit> unit_pool_;
-  std::vector<BaseType> hash_table_;
-  std::stack<BaseType> unfixed_units_;
-  std::stack<BaseType> unused_units_;
+  // An entry of the hash table has a hash value of a state in its upper
+  // 32 bits and the index of its first transition in its lower 32 bits.
+  std::vector<unsigned long long> hash_table_;
+  // Stacks of units.
+  std::vector<BaseType> unfixed_units_;
+  std::vector<BaseType> unused_units_;
   SizeType num_of_states_;
   SizeType num_of_merged_transitions_;
   SizeType num_of_merging_states_;
+  SizeType num_of_expansions_;
+  SizeType peak_total_size_;
 
   // Disallows copies.
   DawgBuilder(const DawgBuilder &);
@@ -143,6 +243,12 @@ class DawgBuilder {
       Init();
     }
 
+    // Indexes of units must fit into their sibling fields.
+    if (unit_pool_.size() - unused_units_.size() + length + 1 >
+        static_cast<SizeType>(DawgUnit::MAX_SIBLING)) {
+      return false;
+    }
+
     BaseType index = 0;
     SizeType key_pos = 0;
 
@@ -181,7 +287,7 @@ class DawgBuilder {
       unit_pool_[child_index].set_sibling(unit_pool_[index].child());
       unit_pool_[child_index].set_label(key_label);
       unit_pool_[index].set_child(child_index);
-      unfixed_units_.push(child_index);
+      unfixed_units_.push_back(child_index);
 
       index = child_index;
     }
@@ -191,33 +297,35 @@ class DawgBuilder {
 
   // Initializes an object.
   void Init() {
+    num_of_expansions_ = 0;
+    peak_total_size_ = 0;
     hash_table_.resize(initial_hash_table_size_, 0);
     AllocateUnit();
     AllocateTransition();
     unit_pool_[0].set_label(0xFF);
-    unfixed_units_.push(0);
+    unfixed_units_.push_back(0);
   }
 
   // Fixes units corresponding to the last inserted key.
   // Also, some of units are merged into equivalent transitions.
   void FixUnits(BaseType index) {
-    while (unfixed_units_.top() != index) {
-      BaseType unfixed_index = unfixed_units_.top();
-      unfixed_units_.pop();
-
-      if (num_of_states_ >= hash_table_.size() - (hash_table_.size() >> 2)) {
-        ExpandHashTable();
-      }
-
-      BaseType num_of_siblings = 0;
-      for (BaseType i = unfixed_index; i != 0; i = unit_pool_[i].sibling()) {
-        ++num_of_siblings;
+    while (unfixed_units_.back() != index) {
+      BaseType unfixed_index = unfixed_units_.back();
+      unfixed_units_.pop_back();
+
+      const DawgUnit &unit = unit_pool_[unfixed_index];
+      BaseType hash_value = 0;
+      BaseType hash_id = 0;
+      BaseType matched_index = 0;
+      if (merges_states_) {
+        if (num_of_states_ >= hash_table_.size() - (hash_table_.size() >> 2)) {
+          ExpandHashTable();
+        }
+        hash_value = HashUnit(unit);
+        matched_index = FindUnit(unit, hash_value, &hash_id);
       }
-
-      BaseType hash_id;
-      BaseType matched_index = FindUnit(unfixed_index, &hash_id);
       if (matched_index != 0) {
-        num_of_merged_transitions_ += num_of_siblings;
+        num_of_merged_transitions_ += CountSiblings(unit);
 
         // Records a merging state.
         if (flag_pool_.get(matched_index) == false) {
@@ -225,18 +333,11 @@ class DawgBuilder {
           flag_pool_.set(matched_index, true);
         }
       } else {
-        // Fixes units into pairs of base values and labels.
-        BaseType transition_index = 0;
-        for (BaseType i = 0; i < num_of_siblings; ++i) {
-          transition_index = AllocateTransition();
+        matched_index = AppendTransitions(unit, &base_pool_, &label_pool_,
+                                          &flag_pool_);
+        if (merges_states_) {
+          hash_table_[hash_id] = MakeEntry(hash_value, matched_index);
         }
-        for (BaseType i = unfixed_index; i != 0; i = unit_pool_[i].sibling()) {
-          base_pool_[transition_index].set_base(unit_pool_[i].base());
-          label_pool_[transition_index] = unit_pool_[i].label();
-          --transition_index;
-        }
-        matched_index = transition_index + 1;
-        hash_table_[hash_id] = matched_index;
         ++num_of_states_;
       }
 
@@ -247,54 +348,54 @@ class DawgBuilder {
         FreeUnit(current);
       }
 
-      unit_pool_[unfixed_units_.top()].set_child(matched_index);
+      unit_pool_[unfixed_units_.back()].set_child(matched_index);
     }
-    unfixed_units_.pop();
+    unfixed_units_.pop_back();
   }
 
-  // Expands a hash table.
+  // Expands a hash table. Entries keep hash values of states, so
+  // transitions are not hashed again.
   void ExpandHashTable() {
-    SizeType hash_table_size = hash_table_.size() << 1;
-    std::vector<BaseType>(0).swap(hash_table_);
-    hash_table_.resize(hash_table_size, 0);
-
-    // Builds a new hash table.
-    BaseType count = 0;
-    for (SizeType i = 1; i < base_pool_.size(); ++i) {
-      BaseType index = static_cast<BaseType>(i);
-      if (label_pool_[index] == '\0' || base_pool_[index].is_state()) {
-        BaseType hash_id;
-        FindTransition(index, &hash_id);
-        hash_table_[hash_id] = index;
-        ++count;
+    std::vector<unsigned long long> entries(hash_table_.size() << 1, 0);
+    entries.swap(hash_table_);
+    ++num_of_expansions_;
+    UpdatePeakTotalSize(sizeof(unsigned long long) * entries.capacity());
+
+    SizeType mask = hash_table_.size() - 1;
+    for (SizeType i = 0; i < entries.size(); ++i) {
+      if (entries[i] != 0) {
+        SizeType hash_id = (entries[i] >> 32) & mask;
+        while (hash_table_[hash_id] != 0) {
+          hash_id = (hash_id + 1) & mask;
+        }
+        hash_table_[hash_id] = entries[i];
       }
     }
   }
 
-  // Finds a transition from a hash table.
-  BaseType FindTransition(BaseType index, BaseType *hash_id) const {
-    *hash_id = HashTransition(index) % hash_table_.size();
-    for ( ; ; *hash_id = (*hash_id + 1) % hash_table_.size()) {
-      BaseType transition_id = hash_table_[*hash_id];
-      if (transition_id == 0) {
-        break;
-      }
-
-      // There must not be the same base value.
+  // Records the current size of a builder and extra memory in use.
+  void UpdatePeakTotalSize(SizeType extra_size) {
+    SizeType total_size = this->total_size() + extra_size;
+    if (total_size > peak_total_size_) {
+      peak_total_size_ = total_size;
     }
-    return 0;
   }
 
   // Finds a unit from a hash table.
-  BaseType FindUnit(BaseType unit_index, BaseType *hash_id) const {
-    *hash_id = HashUnit(unit_index) % hash_table_.size();
-    for ( ; ; *hash_id = (*hash_id + 1) % hash_table_.size()) {
-      BaseType transition_id = hash_table_[*hash_id];
-      if (transition_id == 0) {
+  BaseType FindUnit(const DawgUnit &unit, BaseType hash_value,
+                    BaseType *hash_id) const {
+    SizeType mask = hash_table_.size() - 1;
+    for (*hash_id = static_cast<BaseType>(hash_value & mask); ;
+         *hash_id = static_cast<BaseType>((*hash_id + 1) & mask)) {
+      unsigned long long entry = hash_table_[*hash_id];
+      if (entry == 0) {
         break;
       }
 
-      if (AreEqual(unit_index, transition_id)) {
+      // Transitions are compared only if hash values are the same.
+      BaseType transition_id = static_cast<BaseType>(entry);
+      if ((entry >> 32) == hash_value &&
+          AreEqual(unit, transition_id)) {
         return transition_id;
       }
     }
@@ -302,10 +403,9 @@ class DawgBuilder {
   }
 
   // Compares a unit and a transition.
-  bool AreEqual(BaseType unit_index, BaseType transition_index) const {
+  bool AreEqual(const DawgUnit &unit, BaseType transition_index) const {
     // Compares the numbers of transitions.
-    for (BaseType i = unit_pool_[unit_index].sibling(); i != 0;
-         i = unit_pool_[i].sibling()) {
+    for (BaseType i = unit.sibling(); i != 0; i = unit_pool_[i].sibling()) {
       if (base_pool_[transition_index].has_sibling() == false) {
         return false;
       }
@@ -316,7 +416,12 @@ class DawgBuilder {
     }
 
     // Compares out-transitions.
-    for (BaseType i = unit_index; i;
+    if (unit.base() != base_pool_[transition_index].base() ||
+        unit.label() != label_pool_[transition_index]) {
+      return false;
+    }
+    --transition_index;
+    for (BaseType i = unit.sibling(); i != 0;
          i = unit_pool_[i].sibling(), --transition_index) {
       if (unit_pool_[i].base() != base_pool_[transition_index].base() ||
           unit_pool_[i].label() != label_pool_[transition_index]) {
@@ -326,42 +431,83 @@ class DawgBuilder {
     return true;
   }
 
-  // Calculates a hash value from a transition.
-  BaseType HashTransition(BaseType index) const {
-    BaseType hash_value = 0;
-    for ( ; index != 0; ++index) {
-      BaseType base = base_pool_[index].base();
-      UCharType label = label_pool_[index];
-      hash_value ^= Hash((label << 24) ^ base);
+  // Calculates a hash value of a state from its sibling units. Every
+  // transition is mixed into the hash in order, so states which differ
+  // only in the order or the upper bits of their transitions get
+  // different hash values.
+  BaseType HashUnit(const DawgUnit &unit) const {
+    unsigned long long hash_value = Mix(0, unit);
+    for (BaseType i = unit.sibling(); i != 0; i = unit_pool_[i].sibling()) {
+      hash_value = Mix(hash_value, unit_pool_[i]);
+    }
+    return static_cast<BaseType>(Hash(hash_value));
+  }
 
-      if (base_pool_[index].has_sibling() == false) {
-        break;
-      }
+  // Mixes a transition of a unit into a hash value.
+  static unsigned long long Mix(unsigned long long hash_value,
+                                const DawgUnit &unit) {
+    unsigned long long transition =
+        (static_cast<unsigned long long>(unit.label()) << 32) | unit.base();
+    hash_value = (hash_value ^ transition) * 0x9E3779B97F4A7C15ULL;
+    return hash_value ^ (hash_value >> 29);
+  }
+
+  static unsigned long long MakeEntry(BaseType hash_value,
+                                      BaseType transition_id) {
+    return (static_cast<unsigned long long>(hash_value) << 32) |
+        transition_id;
+  }
+
+  // 64-bit finalizer of MurmurHash3.
+  static unsigned long long Hash(unsigned long long key) {
+    key ^= key >> 33;
+    key *= 0xFF51AFD7ED558CCDULL;
+    key ^= key >> 33;
+    key *= 0xC4CEB9FE1A85EC53ULL;
+    key ^= key >> 33;
+    return key;
+  }
+
+  // Rounds up the size of a hash table to a power of 2.
+  static SizeType HashTableSize(SizeType size) {
+    SizeType hash_table_size = DEFAULT_INITIAL_HASH_TABLE_SIZE;
+    while (hash_table_size < size) {
+      hash_table_size <<= 1;
     }
-    return hash_value;
+    return hash_table_size;
   }
 
-  // Calculates a hash value from a unit.
-  BaseType HashUnit(BaseType index) const {
-    BaseType hash_value = 0;
-    for ( ; index != 0; index = unit_pool_[index].sibling()) {
-      BaseType base = unit_pool_[index].base();
-      UCharType label = unit_pool_[index].label();
-      hash_value ^= Hash((label << 24) ^ base);
+  // Counts a unit and its siblings.
+  BaseType CountSiblings(const DawgUnit &unit) const {
+    BaseType num_of_siblings = 1;
+    for (BaseType i = unit.sibling(); i != 0; i = unit_pool_[i].sibling()) {
+      ++num_of_siblings;
     }
-    return hash_value;
-  }
-
-  // 32-bit mix function.
-  // http://www.concentric.net/~Ttwang/tech/inthash.htm
-  static BaseType Hash(BaseType key) {
-    key = ~key + (key << 15);  // key = (key << 15) - key - 1;
-    key = key ^ (key >> 12);
-    key = key + (key << 2);
-    key = key ^ (key >> 4);
-    key = key * 2057;  // key = (key + (key << 3)) + (key << 11);
-    key = key ^ (key >> 16);
-    return key;
+    return num_of_siblings;
+  }
+
+  // Fixes a unit and its siblings into pairs of base values and labels
+  // at the end of pools and returns the index of the first transition.
+  BaseType AppendTransitions(const DawgUnit &unit,
+                             ObjectPool<BaseUnit> *base_pool,
+                             ObjectPool<UCharType> *label_pool,
+                             BitPool<> *flag_pool) const {
+    BaseType num_of_siblings = CountSiblings(unit);
+    BaseType transition_index = 0;
+    for (BaseType i = 0; i < num_of_siblings; ++i) {
+      flag_pool->Allocate();
+      base_pool->Allocate();
+      transition_index = static_cast<BaseType>(label_pool->Allocate());
+    }
+
+    (*base_pool)[transition_index].set_base(unit.base());
+    (*label_pool)[transition_index] = unit.label();
+    for (BaseType i = unit.sibling(); i != 0; i = unit_pool_[i].sibling()) {
+      --transition_index;
+      (*base_pool)[transition_index].set_base(unit_pool_[i].base());
+      (*label_pool)[transition_index] = unit_pool_[i].label();
+    }
+    return transition_index;
   }
 
   // Gets a transition from object pools.
@@ -377,8 +523,8 @@ class DawgBuilder {
     if (unused_units_.empty()) {
       index = static_cast<BaseType>(unit_pool_.Allocate());
     } else {
-      index = unused_units_.top();
-      unused_units_.pop();
+      index = unused_units_.back();
+      unused_units_.pop_back();
     }
     unit_pool_[index].Clear();
     return index;
@@ -386,7 +532,7 @@ class DawgBuilder {
 
   // Returns a unit to an object pool.
   void FreeUnit(BaseType index) {
-    unused_units_.push(index);
+    unused_units_.push_back(index);
   }
 };
 
@@ -5,31 +5,43 @@
 
 namespace dawgdic {
 
-// Unit for building a dawg.
+// Unit for building a dawg. A unit is packed into 8 bytes: a child or
+// a value, and a sibling with a label and flags in its lower bits.
 class DawgUnit {
  public:
-  DawgUnit()
-    : child_(0), sibling_(0), label_('\0'),
-      is_state_(false), has_sibling_(false) {}
+  // Upper limit of sibling indexes.
+  enum {
+    MAX_SIBLING = (1 << 22) - 1
+  };
+
+  DawgUnit() : child_(0), sibling_(0) {}
 
   // Writes values.
   void set_child(BaseType child) {
     child_ = child;
   }
   void set_sibling(BaseType sibling) {
-    sibling_ = sibling;
+    sibling_ = (sibling_ & FLAGS_MASK) | (sibling << SIBLING_SHIFT);
   }
   void set_value(ValueType value) {
     child_ = value;
   }
   void set_label(UCharType label) {
-    label_ = label;
+    sibling_ = (sibling_ & ~LABEL_MASK) | label;
   }
   void set_is_state(bool is_state) {
-    is_state_ = is_state;
+    if (is_state) {
+      sibling_ |= IS_STATE_BIT;
+    } else {
+      sibling_ &= ~IS_STATE_BIT;
+    }
   }
   void set_has_sibling(bool has_sibling) {
-    has_sibling_ = has_sibling;
+    if (has_sibling) {
+      sibling_ |= HAS_SIBLING_BIT;
+    } else {
+      sibling_ &= ~HAS_SIBLING_BIT;
+    }
   }
 
   // Reads values.
@@ -37,44 +49,50 @@ class DawgUnit {
     return child_;
   }
   BaseType sibling() const {
-    return sibling_;
+    return sibling_ >> SIBLING_SHIFT;
   }
   ValueType value() const {
     return static_cast<ValueType>(child_);
   }
   UCharType label() const {
-    return label_;
+    return static_cast<UCharType>(sibling_ & LABEL_MASK);
   }
   bool is_state() const {
-    return is_state_;
+    return (sibling_ & IS_STATE_BIT) ? true : false;
   }
   bool has_sibling() const {
-    return has_sibling_;
+    return (sibling_ & HAS_SIBLING_BIT) ? true : false;
   }
 
   // Calculates a base value of a unit.
   BaseType base() const {
-    if (label_ == '\0') {
-      return (child_ << 1) | (has_sibling_ ? 1 : 0);
+    BaseType has_sibling = (sibling_ >> HAS_SIBLING_SHIFT) & 1;
+    if (label() == '\0') {
+      return (child_ << 1) | has_sibling;
     }
-    return (child_ << 2) | (is_state_ ? 2 : 0) | (has_sibling_ ? 1 : 0);
+    return (child_ << 2) | ((sibling_ >> IS_STATE_SHIFT & 1) << 1) |
+        has_sibling;
   }
 
   // Initializes a unit.
   void Clear() {
     child_ = 0;
     sibling_ = 0;
-    label_ = '\0';
-    is_state_ = false;
-    has_sibling_ = false;
   }
 
  private:
+  enum {
+    LABEL_MASK = 0xFF,
+    IS_STATE_SHIFT = 8,
+    IS_STATE_BIT = 1 << IS_STATE_SHIFT,
+    HAS_SIBLING_SHIFT = 9,
+    HAS_SIBLING_BIT = 1 << HAS_SIBLING_SHIFT,
+    FLAGS_MASK = (1 << 10) - 1,
+    SIBLING_SHIFT = 10
+  };
+
   BaseType child_;
   BaseType sibling_;
-  UCharType label_;
-  bool is_state_;
-  bool has_sibling_;
 
   // Copyable.
 };
@@ -43,6 +43,11 @@ class Dawg {
   SizeType num_of_merging_states() const {
     return num_of_merging_states_;
   }
+  // Size of allocated pools in bytes.
+  SizeType total_size() const {
+    return base_pool_.total_size() + label_pool_.total_size() +
+        flag_pool_.total_size();
+  }
 
   // Reads values.
   BaseType child(BaseType index) const {
@@ -1,11 +1,13 @@
 #ifndef DAWGDIC_DICTIONARY_BUILDER_H
 #define DAWGDIC_DICTIONARY_BUILDER_H
 
+#include <algorithm>
+#include <utility>
 #include <vector>
 
 #include "dawg.h"
 #include "dictionary.h"
-#include "dictionary-extra-unit.h"
+#include "guide.h"
 #include "link-table.h"
 
 namespace dawgdic {
@@ -18,33 +20,82 @@ class DictionaryBuilder {
     // Number of blocks kept unfixed.
     NUM_OF_UNFIXED_BLOCKS = 16,
     // Number of units kept unfixed.
-    UNFIXED_SIZE = BLOCK_SIZE * NUM_OF_UNFIXED_BLOCKS
+    UNFIXED_SIZE = BLOCK_SIZE * NUM_OF_UNFIXED_BLOCKS,
+    // Minimum number of labels in a tail.
+    MIN_TAIL_LENGTH = 4
   };
 
-  // Builds a dictionary from a list-form dawg.
+  // Builds a dictionary from a list-form dawg. If peak_size is not NULL
+  // it gets the number of bytes used by buffers of the builder, which
+  // are allocated in addition to the dawg.
   static bool Build(const Dawg &dawg, Dictionary *dic,
-                    BaseType *num_of_unused_units = NULL) {
-    DictionaryBuilder builder(dawg, dic);
-    if (!builder.BuildDictionary()) {
-      return false;
-    }
-    if (num_of_unused_units != NULL) {
-      *num_of_unused_units = builder.num_of_unused_units_;
-    }
-    return true;
+                    BaseType *num_of_unused_units = NULL,
+                    SizeType *peak_size = NULL) {
+    DictionaryBuilder builder(dawg, dic, NULL, false);
+    return builder.BuildDictionary(num_of_unused_units, peak_size);
+  }
+
+  // Builds a dictionary and a guide for completing keys at a time; the
+  // guide is the same as the one built by GuideBuilder.
+  static bool Build(const Dawg &dawg, Dictionary *dic, Guide *guide,
+                    BaseType *num_of_unused_units = NULL,
+                    SizeType *peak_size = NULL) {
+    DictionaryBuilder builder(dawg, dic, guide, false);
+    return builder.BuildDictionary(num_of_unused_units, peak_size);
+  }
+
+  // Builds a dictionary in which unbranched paths to the ends of keys
+  // are collapsed into tails.
+  static bool BuildWithTails(const Dawg &dawg, Dictionary *dic,
+                             BaseType *num_of_unused_units = NULL,
+                             SizeType *peak_size = NULL) {
+    DictionaryBuilder builder(dawg, dic, NULL, true);
+    return builder.BuildDictionary(num_of_unused_units, peak_size);
+  }
+  static bool BuildWithTails(const Dawg &dawg, Dictionary *dic, Guide *guide,
+                             BaseType *num_of_unused_units = NULL,
+                             SizeType *peak_size = NULL) {
+    DictionaryBuilder builder(dawg, dic, guide, true);
+    return builder.BuildDictionary(num_of_unused_units, peak_size);
   }
 
  private:
+  typedef unsigned long long BitmapUnit;
+
   const Dawg &dawg_;
   Dictionary *dic_;
+  // Guide units are built only if guide_ is not NULL.
+  Guide *guide_;
+  std::vector<GuideUnit> guide_units_;
 
   std::vector<DictionaryUnit> units_;
-  std::vector<DictionaryExtraUnit *> extras_;
+  // Bitmaps of fixed units and of indices used as offsets.
+  std::vector<BitmapUnit> fixed_bitmap_;
+  std::vector<BitmapUnit> used_bitmap_;
+  // Bitmap of labels for which a block has no unused unit with an
+  // unused offset; such blocks are skipped without scanning units.
+  // Fixing units and using offsets never makes a label available
+  // again, so bits are never cleared.
+  std::vector<BitmapUnit> full_bitmap_;
   std::vector<UCharType> labels_;
+  // Pairs of the next sibling to build and an offset of its parent.
+  std::vector<std::pair<BaseType, BaseType> > node_stack_;
   LinkTable link_table_;
   BaseType unfixed_index_;
   BaseType num_of_unused_units_;
 
+  // Tails are built only if use_tails_ is true.
+  bool use_tails_;
+  std::vector<bool> links_;
+  std::vector<std::pair<BaseType, BaseType> > link_offsets_;
+  std::vector<UCharType> tail_chars_;
+  LinkTable tail_table_;
+
+  // Number of bits in a word of a bitmap.
+  static const BaseType BITMAP_UNIT_BITS = 64;
+  static const BaseType BITMAP_UNITS_PER_BLOCK =
+      BLOCK_SIZE / BITMAP_UNIT_BITS;
+
   // Masks for offsets.
   static const BaseType UPPER_MASK = ~(DictionaryUnit::OFFSET_MAX - 1);
   static const BaseType LOWER_MASK = 0xFF;
@@ -53,14 +104,14 @@ class DictionaryBuilder {
   DictionaryBuilder(const DictionaryBuilder &);
   DictionaryBuilder &operator=(const DictionaryBuilder &);
 
-  DictionaryBuilder(const Dawg &dawg, Dictionary *dic)
-    : dawg_(dawg), dic_(dic), units_(), extras_(), labels_(),
-      link_table_(), unfixed_index_(), num_of_unused_units_(0) {}
-  ~DictionaryBuilder() {
-    for (SizeType i = 0; i < extras_.size(); ++i) {
-      delete [] extras_[i];
-    }
-  }
+  DictionaryBuilder(const Dawg &dawg, Dictionary *dic, Guide *guide,
+                    bool use_tails)
+    : dawg_(dawg), dic_(dic), guide_(guide), guide_units_(), units_(),
+      fixed_bitmap_(), used_bitmap_(),
+      full_bitmap_(), labels_(), node_stack_(),
+      link_table_(), unfixed_index_(), num_of_unused_units_(0),
+      use_tails_(use_tails), links_(), link_offsets_(), tail_chars_(),
+      tail_table_() {}
 
   // Accesses units.
   DictionaryUnit &units(BaseType index) {
@@ -69,11 +120,17 @@ class DictionaryBuilder {
   const DictionaryUnit &units(BaseType index) const {
     return units_[index];
   }
-  DictionaryExtraUnit &extras(BaseType index) {
-    return extras_[index / BLOCK_SIZE][index % BLOCK_SIZE];
+
+  // Checks if a unit is fixed or not.
+  bool is_fixed(BaseType index) const {
+    return TestBit(fixed_bitmap_, index);
+  }
+  // Checks if an index is used as an offset or not.
+  bool is_used(BaseType index) const {
+    return TestBit(used_bitmap_, index);
   }
-  const DictionaryExtraUnit &extras(BaseType index) const {
-    return extras_[index / BLOCK_SIZE][index % BLOCK_SIZE];
+  void set_is_used(BaseType index) {
+    SetBit(&used_bitmap_, index);
   }
 
   // Number of units.
@@ -82,16 +139,35 @@ class DictionaryBuilder {
   }
   // Number of blocks.
   BaseType num_of_blocks() const {
-    return static_cast<BaseType>(extras_.size());
+    return num_of_units() / BLOCK_SIZE;
+  }
+
+  // Size of buffers in bytes. Buffers only grow during a build, so
+  // their size before results are swapped out is the peak size.
+  SizeType total_size() const {
+    return sizeof(GuideUnit) * guide_units_.capacity() +
+        sizeof(DictionaryUnit) * units_.capacity() +
+        sizeof(BitmapUnit) * (fixed_bitmap_.capacity() +
+                              used_bitmap_.capacity() +
+                              full_bitmap_.capacity()) +
+        labels_.capacity() +
+        sizeof(std::pair<BaseType, BaseType>) * (node_stack_.capacity() +
+                                                 link_offsets_.capacity()) +
+        link_table_.total_size() + links_.capacity() / 8 +
+        tail_chars_.capacity() + tail_table_.total_size();
   }
 
   // Builds a dictionary from a list-form dawg.
-  bool BuildDictionary() {
+  bool BuildDictionary(BaseType *num_of_unused_units, SizeType *peak_size) {
     link_table_.Init(dawg_.num_of_merging_states() +
         (dawg_.num_of_merging_states() >> 1));
+    if (use_tails_) {
+      tail_table_.Init(dawg_.num_of_merging_states() +
+          (dawg_.num_of_merging_states() >> 1));
+    }
 
     ReserveUnit(0);
-    extras(0).set_is_used();
+    set_is_used(0);
     units(0).set_offset(1);
     units(0).set_label('\0');
 
@@ -103,18 +179,76 @@ class DictionaryBuilder {
 
     FixAllBlocks();
 
+    if (peak_size != NULL) {
+      *peak_size = total_size();
+    }
     dic_->SwapUnitsBuf(&units_);
+    if (!link_offsets_.empty()) {
+      BuildTail();
+    }
+    if (guide_ != NULL && dawg_.size() > 1) {
+      guide_->SwapUnitsBuf(&guide_units_);
+    }
+    if (num_of_unused_units != NULL) {
+      *num_of_unused_units = num_of_unused_units_;
+    }
     return true;
   }
 
-  // Builds a dictionary from a dawg.
+  // Builds a double-array in depth-first order. An explicit stack is
+  // used instead of recursion because keys may be very long.
   bool BuildDictionary(BaseType dawg_index, BaseType dic_index) {
-    if (dawg_.is_leaf(dawg_index)) {
+    node_stack_.clear();
+    BaseType dawg_child_index;
+    BaseType offset;
+    if (!BuildNode(dawg_index, dic_index, &dawg_child_index, &offset)) {
+      return false;
+    }
+    for ( ; ; ) {
+      // Resumes building siblings after descendants of a node.
+      if (dawg_child_index == 0) {
+        if (node_stack_.empty()) {
+          return true;
+        }
+        dawg_child_index = node_stack_.back().first;
+        offset = node_stack_.back().second;
+        node_stack_.pop_back();
+      }
+
+      BaseType dawg_sibling_index = dawg_.sibling(dawg_child_index);
+      BaseType dic_child_index = offset ^ dawg_.label(dawg_child_index);
+      BaseType dawg_grandchild_index;
+      BaseType child_offset;
+      if (!BuildNode(dawg_child_index, dic_child_index,
+                     &dawg_grandchild_index, &child_offset)) {
+        return false;
+      }
+      if (dawg_grandchild_index != 0) {
+        if (dawg_sibling_index != 0) {
+          node_stack_.push_back(std::make_pair(dawg_sibling_index, offset));
+        }
+        dawg_child_index = dawg_grandchild_index;
+        offset = child_offset;
+      } else {
+        dawg_child_index = dawg_sibling_index;
+      }
+    }
+  }
+
+  // Arranges child nodes of a node. If the child nodes have to be built,
+  // the first child and the offset are returned, or 0 otherwise.
+  bool BuildNode(BaseType dawg_index, BaseType dic_index,
+                 BaseType *dawg_first_child_index, BaseType *first_offset) {
+    *dawg_first_child_index = 0;
+    if (dawg_.is_leaf(dawg_index) || is_link(dic_index)) {
       return true;
     }
 
     // Uses an existing offset if available.
     BaseType dawg_child_index = dawg_.child(dawg_index);
+    if (guide_ != NULL) {
+      SetGuideChild(dawg_child_index, dic_index);
+    }
     if (dawg_.is_merging(dawg_child_index)) {
       BaseType offset = link_table_.Find(dawg_child_index);
       if (offset != 0) {
@@ -135,19 +269,12 @@ class DictionaryBuilder {
       return false;
     }
 
-    if (dawg_.is_merging(dawg_child_index))
-      link_table_.Insert(dawg_child_index, offset); {
+    if (dawg_.is_merging(dawg_child_index)) {
+      link_table_.Insert(dawg_child_index, offset);
     }
 
-    // Builds a double-array in depth-first order.
-    do {
-      BaseType dic_child_index = offset ^ dawg_.label(dawg_child_index);
-      if (!BuildDictionary(dawg_child_index, dic_child_index)) {
-        return false;
-      }
-      dawg_child_index = dawg_.sibling(dawg_child_index);
-    } while (dawg_child_index != 0);
-
+    *dawg_first_child_index = dawg_child_index;
+    *first_offset = offset;
     return true;
   }
 
@@ -177,40 +304,178 @@ class DictionaryBuilder {
         units(dic_child_index).set_value(dawg_.value(dawg_child_index));
       } else {
         units(dic_child_index).set_label(labels_[i]);
+        if (guide_ != NULL && i + 1 < labels_.size()) {
+          guide_units_[dic_child_index].set_sibling(labels_[i + 1]);
+        }
       }
 
       dawg_child_index = dawg_.sibling(dawg_child_index);
     }
-    extras(offset).set_is_used();
+    set_is_used(offset);
+
+    if (use_tails_) {
+      dawg_child_index = dawg_.child(dawg_index);
+      for (SizeType i = 0; i < labels_.size(); ++i) {
+        if (!dawg_.is_leaf(dawg_child_index)) {
+          ArrangeTail(dawg_child_index, offset ^ labels_[i]);
+        }
+        dawg_child_index = dawg_.sibling(dawg_child_index);
+      }
+    }
 
     return offset;
   }
 
+  // Sets the label of the first non-terminal child to a guide unit.
+  void SetGuideChild(BaseType dawg_child_index, BaseType dic_index) {
+    if (dawg_.label(dawg_child_index) == '\0') {
+      dawg_child_index = dawg_.sibling(dawg_child_index);
+      if (dawg_child_index == 0) {
+        return;
+      }
+    }
+    guide_units_[dic_index].set_child(dawg_.label(dawg_child_index));
+  }
+
+  // Checks if a unit leads to a tail or not.
+  bool is_link(BaseType index) const {
+    return use_tails_ && links_[index];
+  }
+
+  // Makes a unit lead to a tail if a dawg has an unbranched path to
+  // the end of a key from it.
+  void ArrangeTail(BaseType dawg_index, BaseType dic_index) {
+    BaseType tail_offset;
+    if (!FindTail(dawg_index, &tail_offset)) {
+      return;
+    }
+
+    // A unit which leads to a tail uses an offset which is not used by
+    // other units, so that no transition from it can be followed.
+    for (BaseType label = 0; label < BLOCK_SIZE; ++label) {
+      BaseType offset = dic_index ^ label;
+      if (!is_used(offset)) {
+        set_is_used(offset);
+        units(dic_index).set_offset(label);
+        links_[dic_index] = true;
+        link_offsets_.push_back(std::make_pair(dic_index, tail_offset));
+        return;
+      }
+    }
+  }
+
+  // Finds or appends a tail which starts from the destination of a given
+  // transition.
+  bool FindTail(BaseType dawg_index, BaseType *tail_offset) {
+    BaseType dawg_child_index = dawg_.child(dawg_index);
+    if (dawg_.is_merging(dawg_child_index)) {
+      BaseType offset = tail_table_.Find(dawg_child_index);
+      if (offset != 0) {
+        *tail_offset = offset - 1;
+        return true;
+      }
+    }
+
+    // Reads labels of an unbranched path.
+    SizeType length = 0;
+    BaseType index = dawg_child_index;
+    while (dawg_.sibling(index) == 0 && !dawg_.is_leaf(index)) {
+      ++length;
+      index = dawg_.child(index);
+    }
+    if (dawg_.sibling(index) != 0 || length < MIN_TAIL_LENGTH) {
+      return false;
+    }
+
+    *tail_offset = static_cast<BaseType>(tail_chars_.size());
+    index = dawg_child_index;
+    for (SizeType i = 0; i < length; ++i) {
+      // Tails of merging states in the path are shared.
+      if (dawg_.is_merging(index) && length - i >= MIN_TAIL_LENGTH) {
+        tail_table_.Insert(index,
+            static_cast<BaseType>(tail_chars_.size()) + 1);
+      }
+      tail_chars_.push_back(dawg_.label(index));
+      index = dawg_.child(index);
+    }
+    tail_chars_.push_back('\0');
+
+    ValueType value = dawg_.value(index);
+    const UCharType *bytes = reinterpret_cast<const UCharType *>(&value);
+    tail_chars_.insert(tail_chars_.end(), bytes, bytes + sizeof(ValueType));
+    return true;
+  }
+
+  // Builds tails of a dictionary.
+  void BuildTail() {
+    std::sort(link_offsets_.begin(), link_offsets_.end());
+    std::vector<BaseType> offsets(link_offsets_.size());
+    for (SizeType i = 0; i < link_offsets_.size(); ++i) {
+      offsets[i] = link_offsets_[i].second;
+    }
+    links_.resize(dic_->size());
+
+    DictionaryTail tail;
+    tail.Build(links_, offsets, &tail_chars_);
+    dic_->SwapTail(&tail);
+  }
+
   // Finds a good offset.
-  BaseType FindGoodOffset(BaseType index) const {
+  BaseType FindGoodOffset(BaseType index) {
     if (unfixed_index_ >= num_of_units()) {
       return num_of_units() | (index & 0xFF);
     }
 
-    // Scans unused units to find a good offset.
-    BaseType unfixed_index = unfixed_index_;
-    do {
-      BaseType offset = unfixed_index ^ labels_[0];
-      if (IsGoodOffset(index, offset)) {
+    // Scans unfixed blocks in the order of unused units.
+    for (BaseType block_id = unfixed_index_ / BLOCK_SIZE;
+         block_id < num_of_blocks(); ++block_id) {
+      BaseType offset;
+      if (FindGoodOffset(index, block_id, &offset)) {
         return offset;
       }
-      unfixed_index = extras(unfixed_index).next();
-    } while (unfixed_index != unfixed_index_);
+    }
 
     return num_of_units() | (index & 0xFF);
   }
 
-  // Checks if a given offset is valid or not.
-  bool IsGoodOffset(BaseType index, BaseType offset) const {
-    if (extras(offset).is_used()) {
+  // Finds a good offset in a given block. Unused units are visited in
+  // ascending order by scanning the bitmap of fixed units.
+  bool FindGoodOffset(BaseType index, BaseType block_id, BaseType *offset) {
+    BaseType full_index = block_id * BLOCK_SIZE + labels_[0];
+    if (TestBit(full_bitmap_, full_index)) {
       return false;
     }
 
+    bool has_unused_offset = false;
+    BaseType begin = block_id * BITMAP_UNITS_PER_BLOCK;
+    BaseType end = begin + BITMAP_UNITS_PER_BLOCK;
+    for (BaseType i = begin; i != end; ++i) {
+      BitmapUnit unfixed_units = ~fixed_bitmap_[i];
+      while (unfixed_units != 0) {
+        BaseType unfixed_index = i * BITMAP_UNIT_BITS +
+            CountTrailingZeros(unfixed_units);
+        unfixed_units &= unfixed_units - 1;
+
+        BaseType candidate = unfixed_index ^ labels_[0];
+        if (is_used(candidate)) {
+          continue;
+        }
+        has_unused_offset = true;
+        if (IsGoodOffset(index, candidate)) {
+          *offset = candidate;
+          return true;
+        }
+      }
+    }
+
+    if (!has_unused_offset) {
+      SetBit(&full_bitmap_, full_index);
+    }
+    return false;
+  }
+
+  // Checks if a given unused offset is valid or not.
+  bool IsGoodOffset(BaseType index, BaseType offset) const {
     BaseType relative_offset = index ^ offset;
     if ((relative_offset & LOWER_MASK) && (relative_offset & UPPER_MASK)) {
       return false;
@@ -218,7 +483,7 @@ class DictionaryBuilder {
 
     // Finds a collision.
     for (SizeType i = 1; i < labels_.size(); ++i) {
-      if (extras(offset ^ labels_[i]).is_fixed()) {
+      if (is_fixed(offset ^ labels_[i])) {
         return false;
       }
     }
@@ -226,22 +491,57 @@ class DictionaryBuilder {
     return true;
   }
 
+  static bool TestBit(const std::vector<BitmapUnit> &bitmap,
+                      BaseType index) {
+    return ((bitmap[index / BITMAP_UNIT_BITS] >>
+             (index % BITMAP_UNIT_BITS)) & 1) != 0;
+  }
+
+  static void SetBit(std::vector<BitmapUnit> *bitmap, BaseType index) {
+    (*bitmap)[index / BITMAP_UNIT_BITS] |=
+        static_cast<BitmapUnit>(1) << (index % BITMAP_UNIT_BITS);
+  }
+
+  static BaseType CountTrailingZeros(BitmapUnit unit) {
+#if defined(__GNUC__)
+    return static_cast<BaseType>(__builtin_ctzll(unit));
+#else  // defined(__GNUC__)
+    BaseType count = 0;
+    for ( ; (unit & 1) == 0; unit >>= 1) {
+      ++count;
+    }
+    return count;
+#endif  // defined(__GNUC__)
+  }
+
   // Reserves an unused unit.
   void ReserveUnit(BaseType index) {
     if (index >= num_of_units()) {
       ExpandDictionary();
     }
 
-    // Removes an unused unit from a circular linked list.
+    SetBit(&fixed_bitmap_, index);
+
+    // Unused units are visited in ascending order of indices, so
+    // unfixed_index_ is the first unused unit.
     if (index == unfixed_index_) {
-      unfixed_index_ = extras(index).next();
-      if (unfixed_index_ == index) {
-        unfixed_index_ = num_of_units();
+      unfixed_index_ = FindUnfixedUnit(index);
+    }
+  }
+
+  // Finds the first unused unit after a given index or returns
+  // num_of_units() if there is no such unit.
+  BaseType FindUnfixedUnit(BaseType index) const {
+    BaseType i = index / BITMAP_UNIT_BITS;
+    BitmapUnit unit = ~fixed_bitmap_[i] &
+        (~static_cast<BitmapUnit>(0) << (index % BITMAP_UNIT_BITS));
+    while (unit == 0) {
+      if (++i == fixed_bitmap_.size()) {
+        return num_of_units();
       }
+      unit = ~fixed_bitmap_[i];
     }
-    extras(extras(index).prev()).set_next(extras(index).next());
-    extras(extras(index).next()).set_prev(extras(index).prev());
-    extras(index).set_is_fixed();
+    return i * BITMAP_UNIT_BITS + CountTrailingZeros(unit);
   }
 
   // Expands a dictionary.
@@ -258,34 +558,15 @@ class DictionaryBuilder {
     }
 
     units_.resize(dest_num_of_units);
-    extras_.resize(dest_num_of_blocks, 0);
-
-    // Allocates memory to a new block.
-    if (dest_num_of_blocks > NUM_OF_UNFIXED_BLOCKS) {
-      BaseType block_id = src_num_of_blocks - NUM_OF_UNFIXED_BLOCKS;
-      std::swap(extras_[block_id], extras_.back());
-      for (BaseType i = src_num_of_units; i < dest_num_of_units; ++i) {
-        extras(i).clear();
-      }
-    } else {
-      extras_.back() = new DictionaryExtraUnit[BLOCK_SIZE];
+    fixed_bitmap_.resize(dest_num_of_blocks * BITMAP_UNITS_PER_BLOCK, 0);
+    used_bitmap_.resize(dest_num_of_blocks * BITMAP_UNITS_PER_BLOCK, 0);
+    full_bitmap_.resize(dest_num_of_blocks * BITMAP_UNITS_PER_BLOCK, 0);
+    if (use_tails_) {
+      links_.resize(dest_num_of_units, false);
     }
-
-    // Creates a circular linked list for a new block.
-    for (BaseType i = src_num_of_units + 1; i < dest_num_of_units; ++i) {
-      extras(i - 1).set_next(i);
-      extras(i).set_prev(i - 1);
+    if (guide_ != NULL) {
+      guide_units_.resize(dest_num_of_units);
     }
-
-    extras(src_num_of_units).set_prev(dest_num_of_units - 1);
-    extras(dest_num_of_units - 1).set_next(src_num_of_units);
-
-    // Merges 2 circular linked lists.
-    extras(src_num_of_units).set_prev(extras(unfixed_index_).prev());
-    extras(dest_num_of_units - 1).set_next(unfixed_index_);
-
-    extras(extras(unfixed_index_).prev()).set_next(src_num_of_units);
-    extras(unfixed_index_).set_prev(dest_num_of_units - 1);
   }
 
   // Fixes all blocks to avoid invalid transitions.
@@ -308,19 +589,27 @@ class DictionaryBuilder {
 
     // Finds an unused offset.
     BaseType unused_offset_for_label = 0;
+    bool has_unused_offset = false;
     for (BaseType offset = begin; offset != end; ++offset) {
-      if (!extras(offset).is_used()) {
+      if (!is_used(offset)) {
         unused_offset_for_label = offset;
+        has_unused_offset = true;
         break;
       }
     }
 
     // Labels of unused units are modified.
     for (BaseType index = begin; index != end; ++index) {
-      if (!extras(index).is_fixed()) {
+      if (!is_fixed(index)) {
         ReserveUnit(index);
-        units(index).set_label(
-            static_cast<UCharType>(index ^ unused_offset_for_label));
+        if (has_unused_offset) {
+          units(index).set_label(
+              static_cast<UCharType>(index ^ unused_offset_for_label));
+        } else {
+          // Every offset may be used if units lead to tails; leaves can't
+          // be reached by transitions.
+          units(index).set_value(0);
+        }
         ++num_of_unused_units_;
       }
     }
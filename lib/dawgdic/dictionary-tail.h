@@ -0,0 +1,159 @@
+#ifndef DAWGDIC_DICTIONARY_TAIL_H
+#define DAWGDIC_DICTIONARY_TAIL_H
+
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+#include "base-types.h"
+#include "bit-vector.h"
+#include "packed-array.h"
+
+namespace dawgdic {
+
+// Tails of a dictionary. A tail is a string of labels of an unbranched
+// path which ends with a key; it is stored in a pool as the labels,
+// '\0' and a value of the key. Units which lead to tails are marked
+// in links_ and offsets of their tails are stored in the order of units.
+class DictionaryTail {
+ public:
+  DictionaryTail() : links_(), offsets_(), chars_() {}
+
+  bool empty() const {
+    return chars_.empty();
+  }
+  // Size of a pool.
+  SizeType size() const {
+    return chars_.size();
+  }
+  SizeType num_of_links() const {
+    return offsets_.size();
+  }
+  SizeType total_size() const {
+    return links_.total_size() + offsets_.total_size() + chars_.size();
+  }
+  SizeType file_size() const {
+    return links_.file_size() + offsets_.file_size() +
+        sizeof(BaseType) + chars_.size();
+  }
+
+  // Checks if a unit leads to a tail or not.
+  bool is_link(BaseType index) const {
+    return links_[index];
+  }
+  // Gets an offset of a tail from a link.
+  BaseType offset(BaseType index) const {
+    return offsets_[links_.Rank1(index)];
+  }
+  // Gets labels from a given offset.
+  const CharType *chars(BaseType offset) const {
+    return reinterpret_cast<const CharType *>(&chars_[offset]);
+  }
+  // Gets a value which follows '\0' at a given offset.
+  ValueType value(BaseType offset) const {
+    ValueType value;
+    std::memcpy(&value, &chars_[offset + 1], sizeof(ValueType));
+    return value;
+  }
+
+  // Reads tails from an input stream.
+  bool Read(std::istream *input, SizeType num_of_units) {
+    DictionaryTail tail;
+    if (!tail.links_.Read(input) || !tail.offsets_.Read(input) ||
+        tail.links_.size() != num_of_units ||
+        tail.links_.num_of_ones() != tail.offsets_.size()) {
+      return false;
+    }
+
+    BaseType pool_size;
+    if (!input->read(reinterpret_cast<char *>(&pool_size),
+                     sizeof(BaseType))) {
+      return false;
+    }
+    tail.chars_.resize(pool_size);
+    if (pool_size != 0 &&
+        !input->read(reinterpret_cast<char *>(&tail.chars_[0]), pool_size)) {
+      return false;
+    }
+
+    if (!tail.IsValid()) {
+      return false;
+    }
+    Swap(&tail);
+    return true;
+  }
+
+  // Writes tails to an output stream.
+  bool Write(std::ostream *output) const {
+    if (!links_.Write(output) || !offsets_.Write(output)) {
+      return false;
+    }
+    BaseType pool_size = static_cast<BaseType>(chars_.size());
+    if (!output->write(reinterpret_cast<const char *>(&pool_size),
+                       sizeof(BaseType))) {
+      return false;
+    }
+    return chars_.empty() ||
+        output->write(reinterpret_cast<const char *>(&chars_[0]),
+                      chars_.size());
+  }
+
+  // Initializes tails.
+  void Clear() {
+    links_.Clear();
+    offsets_.Clear();
+    std::vector<UCharType>(0).swap(chars_);
+  }
+
+  // Swaps tails.
+  void Swap(DictionaryTail *tail) {
+    links_.Swap(&tail->links_);
+    offsets_.Swap(&tail->offsets_);
+    chars_.swap(tail->chars_);
+  }
+
+ public:
+  // Following member function is called from DictionaryBuilder.
+
+  // Builds tails from flags of units, offsets of links in the order
+  // of units and a pool.
+  void Build(const std::vector<bool> &links,
+             const std::vector<BaseType> &offsets,
+             std::vector<UCharType> *chars) {
+    links_.Clear();
+    for (SizeType i = 0; i < links.size(); ++i) {
+      links_.Append(links[i]);
+    }
+    links_.Build();
+    offsets_.Build(offsets);
+    chars_.swap(*chars);
+  }
+
+ private:
+  BitVector links_;
+  PackedArray offsets_;
+  std::vector<UCharType> chars_;
+
+  // Disallows copies.
+  DictionaryTail(const DictionaryTail &);
+  DictionaryTail &operator=(const DictionaryTail &);
+
+  // Checks that every tail ends with '\0' and a value inside a pool.
+  bool IsValid() const {
+    if (!chars_.empty() &&
+        (chars_.size() < sizeof(ValueType) + 1 ||
+         chars_[chars_.size() - sizeof(ValueType) - 1] != '\0')) {
+      return false;
+    }
+    for (SizeType i = 0; i < offsets_.size(); ++i) {
+      if (offsets_[i] + sizeof(ValueType) + 1 > chars_.size()) {
+        return false;
+      }
+    }
+    return true;
+  }
+};
+
+}  // namespace dawgdic
+
+#endif  // DAWGDIC_DICTIONARY_TAIL_H
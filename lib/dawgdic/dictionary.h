@@ -1,18 +1,29 @@
 #ifndef DAWGDIC_DICTIONARY_H
 #define DAWGDIC_DICTIONARY_H
 
+#include <cstring>
 #include <iostream>
+#include <sstream>
+#include <string>
 #include <vector>
 
 #include "base-types.h"
+#include "dictionary-tail.h"
 #include "dictionary-unit.h"
 
 namespace dawgdic {
 
 // Dictionary class for retrieval and binary I/O.
+//
+// A dictionary may have tails (see DictionaryTail). Indices of positions
+// in tails start from size(), so they can be followed and checked in the
+// same way as indices of units.
 class Dictionary {
  public:
-  Dictionary() : units_(NULL), size_(0), units_buf_() {}
+  // Flag of a stored size which shows that units are followed by tails.
+  static const BaseType HAS_TAIL_FLAG = static_cast<BaseType>(1) << 31;
+
+  Dictionary() : units_(NULL), size_(0), units_buf_(), tail_() {}
 
   const DictionaryUnit *units() const {
     return units_;
@@ -21,10 +32,25 @@ class Dictionary {
     return size_;
   }
   SizeType total_size() const {
-    return sizeof(DictionaryUnit) * size_;
+    return sizeof(DictionaryUnit) * size_ + tail_.total_size();
+  }
+  // Size of units and tails owned by a dictionary; mapped units are not
+  // counted, tails are always copied.
+  SizeType heap_size() const {
+    return sizeof(DictionaryUnit) * units_buf_.capacity() +
+        tail_.total_size();
   }
   SizeType file_size() const {
-    return sizeof(BaseType) + total_size();
+    SizeType size = sizeof(BaseType) + sizeof(DictionaryUnit) * size_;
+    return has_tail() ? (size + tail_.file_size()) : size;
+  }
+
+  // Checks if a dictionary has tails or not.
+  bool has_tail() const {
+    return !tail_.empty();
+  }
+  const DictionaryTail &tail() const {
+    return tail_;
   }
 
   // Root index.
@@ -34,13 +60,37 @@ class Dictionary {
 
   // Checks if a given index is related to the end of a key.
   bool has_value(BaseType index) const {
+    if (index >= size_) {
+      return *tail_.chars(index - static_cast<BaseType>(size_)) == '\0';
+    }
     return units_[index].has_leaf();
   }
   // Gets a value from a given index.
   ValueType value(BaseType index) const {
+    if (index >= size_) {
+      return tail_.value(index - static_cast<BaseType>(size_));
+    }
     return units_[index ^ units_[index].offset()].value();
   }
 
+  // Checks if a given index is a unit which leads to a tail or a position
+  // in a tail. The index of the rest of the tail is set to tail_index.
+  bool FindTail(BaseType index, BaseType *tail_index) const {
+    if (index >= size_) {
+      *tail_index = index;
+      return true;
+    }
+    if (!has_tail() || !tail_.is_link(index)) {
+      return false;
+    }
+    *tail_index = static_cast<BaseType>(size_) + tail_.offset(index);
+    return true;
+  }
+  // Gets labels of a tail from an index of a position in the tail.
+  const CharType *tail_chars(BaseType tail_index) const {
+    return tail_.chars(tail_index - static_cast<BaseType>(size_));
+  }
+
   // Reads a dictionary from an input stream.
   bool Read(std::istream *input) {
     BaseType base_size;
@@ -48,20 +98,29 @@ class Dictionary {
       return false;
     }
 
-    SizeType size = static_cast<SizeType>(base_size);
+    SizeType size = static_cast<SizeType>(base_size & ~HAS_TAIL_FLAG);
     std::vector<DictionaryUnit> units_buf(size);
     if (!input->read(reinterpret_cast<char *>(&units_buf[0]),
                      sizeof(DictionaryUnit) * size)) {
       return false;
     }
 
+    DictionaryTail tail;
+    if ((base_size & HAS_TAIL_FLAG) && !ReadTail(input, size, &tail)) {
+      return false;
+    }
+
     SwapUnitsBuf(&units_buf);
+    tail_.Swap(&tail);
     return true;
   }
 
   // Writes a dictionry to an output stream.
   bool Write(std::ostream *output) const {
     BaseType base_size = static_cast<BaseType>(size_);
+    if (has_tail()) {
+      base_size |= HAS_TAIL_FLAG;
+    }
     if (!output->write(reinterpret_cast<const char *>(&base_size),
                        sizeof(BaseType))) {
       return false;
@@ -72,7 +131,7 @@ class Dictionary {
       return false;
     }
 
-    return true;
+    return !has_tail() || tail_.Write(output);
   }
 
   // Exact matching.
@@ -125,10 +184,14 @@ class Dictionary {
 
   // Follows a transition.
   bool Follow(CharType label, BaseType *index) const {
+    if (*index >= size_) {
+      return FollowTail(label, index);
+    }
     BaseType next_index =
         *index ^ units_[*index].offset() ^ static_cast<UCharType>(label);
     if (units_[next_index].label() != static_cast<UCharType>(label)) {
-      return false;
+      // A unit which leads to a tail has no children.
+      return has_tail() && tail_.is_link(*index) && FollowLink(label, index);
     }
     *index = next_index;
     return true;
@@ -136,10 +199,16 @@ class Dictionary {
 
   // Follows transitions.
   bool Follow(const CharType *s, BaseType *index) const {
-    while (*s != '\0' && Follow(*s, index)) {
+    while (*s != '\0') {
+      if (*index >= size_) {
+        return FollowTail(s, index);
+      }
+      if (!Follow(*s, index)) {
+        return false;
+      }
       ++s;
     }
-    return *s == '\0';
+    return true;
   }
   bool Follow(const CharType *s, BaseType *index, SizeType *count) const {
     while (*s != '\0' && Follow(*s, index)) {
@@ -151,6 +220,9 @@ class Dictionary {
   // Follows transitions.
   bool Follow(const CharType *s, SizeType length, BaseType *index) const {
     for (SizeType i = 0; i < length; ++i) {
+      if (*index >= size_) {
+        return FollowTail(s + i, length - i, index);
+      }
       if (!Follow(s[i], index)) {
         return false;
       }
@@ -167,6 +239,35 @@ class Dictionary {
     return true;
   }
 
+  // Maps units of a dictionary written by Write(); tails are copied.
+  bool MapImage(const void *address, SizeType size) {
+    if (size < sizeof(BaseType)) {
+      return false;
+    }
+    BaseType base_size = *static_cast<const BaseType *>(address);
+    SizeType num_of_units = static_cast<SizeType>(base_size & ~HAS_TAIL_FLAG);
+    SizeType units_size = sizeof(BaseType) +
+        sizeof(DictionaryUnit) * num_of_units;
+    if (num_of_units == 0 || size < units_size ||
+        (!(base_size & HAS_TAIL_FLAG) && size != units_size)) {
+      return false;
+    }
+
+    DictionaryTail tail;
+    if (base_size & HAS_TAIL_FLAG) {
+      std::istringstream input(std::string(
+          static_cast<const char *>(address) + units_size, size - units_size));
+      if (!ReadTail(&input, num_of_units, &tail) ||
+          input.peek() != std::istringstream::traits_type::eof()) {
+        return false;
+      }
+    }
+
+    Map(static_cast<const BaseType *>(address) + 1, num_of_units);
+    tail_.Swap(&tail);
+    return true;
+  }
+
   // Maps memory with its size.
   void Map(const void *address) {
     Clear();
@@ -185,6 +286,7 @@ class Dictionary {
     units_ = NULL;
     size_ = 0;
     std::vector<DictionaryUnit>(0).swap(units_buf_);
+    tail_.Clear();
   }
 
   // Swaps dictionaries.
@@ -192,6 +294,7 @@ class Dictionary {
     std::swap(units_, dic->units_);
     std::swap(size_, dic->size_);
     units_buf_.swap(dic->units_buf_);
+    tail_.Swap(&dic->tail_);
   }
 
   // Shrinks a vector.
@@ -205,23 +308,75 @@ class Dictionary {
   }
 
 public:
-  // Following member function is called from DawgBuilder.
+  // Following member functions are called from DictionaryBuilder.
 
   // Swaps buffers for units.
   void SwapUnitsBuf(std::vector<DictionaryUnit> *units_buf) {
     units_ = &(*units_buf)[0];
     size_ = static_cast<BaseType>(units_buf->size());
     units_buf_.swap(*units_buf);
+    tail_.Clear();
+  }
+  // Swaps tails.
+  void SwapTail(DictionaryTail *tail) {
+    tail_.Swap(tail);
   }
 
  private:
   const DictionaryUnit *units_;
   SizeType size_;
   std::vector<DictionaryUnit> units_buf_;
+  DictionaryTail tail_;
 
   // Disallows copies.
   Dictionary(const Dictionary &);
   Dictionary &operator=(const Dictionary &);
+
+  // Follows the first label of a tail from a unit which leads to it.
+  bool FollowLink(CharType label, BaseType *index) const {
+    BaseType tail_index =
+        static_cast<BaseType>(size_) + tail_.offset(*index);
+    if (!FollowTail(label, &tail_index)) {
+      return false;
+    }
+    *index = tail_index;
+    return true;
+  }
+
+  // Follows transitions in a tail.
+  bool FollowTail(CharType label, BaseType *index) const {
+    if (label == '\0' || *tail_chars(*index) != label) {
+      return false;
+    }
+    ++*index;
+    return true;
+  }
+  bool FollowTail(const CharType *s, BaseType *index) const {
+    const CharType *chars = tail_chars(*index);
+    SizeType length = 0;
+    while (s[length] != '\0' && s[length] == chars[length]) {
+      ++length;
+    }
+    *index += static_cast<BaseType>(length);
+    return s[length] == '\0';
+  }
+  bool FollowTail(const CharType *s, SizeType length, BaseType *index) const {
+    // A tail ends with '\0', so memchr() stops inside a pool.
+    const CharType *chars = tail_chars(*index);
+    if (std::memchr(chars, '\0', length) != NULL ||
+        std::memcmp(chars, s, length) != 0) {
+      return false;
+    }
+    *index += static_cast<BaseType>(length);
+    return true;
+  }
+
+  static bool ReadTail(std::istream *input, SizeType num_of_units,
+                       DictionaryTail *tail) {
+    // Indices of positions in tails must not overflow.
+    return tail->Read(input, num_of_units) &&
+        num_of_units + tail->size() <= static_cast<BaseType>(~HAS_TAIL_FLAG);
+  }
 };
 
 }  // namespace dawgdic
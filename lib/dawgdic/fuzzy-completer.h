@@ -0,0 +1,263 @@
+#ifndef DAWGDIC_FUZZY_COMPLETER_H
+#define DAWGDIC_FUZZY_COMPLETER_H
+
+#include "dictionary.h"
+#include "guide.h"
+
+#include <vector>
+
+namespace dawgdic {
+
+// Completes keys within a Levenshtein distance of a given key in the
+// order of keys. Keys are UTF-8 strings and distances are counted in
+// characters: a row of the distance matrix is computed at the end of
+// each character of a path, and subtrees in which every cell of the row
+// exceeds the bound are skipped.
+//
+// If a separator is set, keys are paths which are followed by the
+// separator (as in BytesDAWG) and transitions by the separator are not
+// followed.
+class FuzzyCompleter {
+ public:
+  FuzzyCompleter()
+    : dic_(NULL), guide_(NULL), separator_('\0'), chars_(),
+      max_distance_(0), key_(), index_stack_(), char_ends_(), rows_(),
+      last_index_(0), distance_(0), descends_(false) {}
+  FuzzyCompleter(const Dictionary &dic, const Guide &guide)
+    : dic_(&dic), guide_(&guide), separator_('\0'), chars_(),
+      max_distance_(0), key_(), index_stack_(), char_ends_(), rows_(),
+      last_index_(0), distance_(0), descends_(false) {}
+
+  void set_dic(const Dictionary &dic) {
+    dic_ = &dic;
+  }
+  void set_guide(const Guide &guide) {
+    guide_ = &guide;
+  }
+  void set_separator(UCharType separator) {
+    separator_ = separator;
+  }
+
+  // These member functions are available only when Next() returns true.
+  const char *key() const {
+    return reinterpret_cast<const char *>(&key_[0]);
+  }
+  SizeType length() const {
+    return key_.size() - 1;
+  }
+  // The index of the end of a key (before a separator).
+  BaseType index() const {
+    return last_index_;
+  }
+  ValueType value() const {
+    return dic_->value(last_index_);
+  }
+  SizeType distance() const {
+    return distance_;
+  }
+
+  // Starts completing keys within max_distance of a key.
+  void Start(const char *key, SizeType length, SizeType max_distance) {
+    chars_.clear();
+    for (SizeType i = 0; i < length; ) {
+      SizeType char_length = CharLength(static_cast<UCharType>(key[i]));
+      if (char_length > length - i) {
+        char_length = length - i;
+      }
+      chars_.push_back(DecodeChar(
+          reinterpret_cast<const UCharType *>(key + i), char_length));
+      i += char_length;
+    }
+    max_distance_ = max_distance;
+
+    key_.resize(1);
+    key_[0] = '\0';
+    index_stack_.clear();
+    char_ends_.assign(1, 0);
+    rows_.resize(chars_.size() + 1);
+    for (SizeType i = 0; i <= chars_.size(); ++i) {
+      rows_[i] = static_cast<BaseType>(i);
+    }
+    if (guide_->size() != 0) {
+      index_stack_.push_back(dic_->root());
+    }
+    descends_ = true;
+  }
+
+  // Gets the next key.
+  bool Next() {
+    while (!index_stack_.empty()) {
+      UCharType label = descends_ ? child(index_stack_.back()) : '\0';
+
+      // Moves to the next sibling or to a sibling of an ancestor.
+      while (label == '\0') {
+        if (index_stack_.size() == 1) {
+          index_stack_.clear();
+          return false;
+        }
+        label = sibling(index_stack_.back());
+        Pop();
+      }
+
+      BaseType index = index_stack_.back();
+      if (!dic_->Follow(static_cast<CharType>(label), &index)) {
+        index_stack_.clear();
+        return false;
+      }
+      key_.back() = label;
+      key_.push_back('\0');
+      index_stack_.push_back(index);
+      descends_ = true;
+
+      // Rows are computed at the ends of characters.
+      SizeType char_begin = char_ends_.back();
+      if (length() - char_begin < CharLength(key_[char_begin])) {
+        continue;
+      }
+      char_ends_.push_back(length());
+      if (!AppendRow(DecodeChar(&key_[char_begin], length() - char_begin))) {
+        descends_ = false;
+        continue;
+      }
+
+      distance_ = rows_.back();
+      if (distance_ <= max_distance_ && IsKey(index)) {
+        last_index_ = index;
+        return true;
+      }
+    }
+    return false;
+  }
+
+ private:
+  const Dictionary *dic_;
+  const Guide *guide_;
+  UCharType separator_;
+  std::vector<BaseType> chars_;
+  SizeType max_distance_;
+  std::vector<UCharType> key_;
+  std::vector<BaseType> index_stack_;
+  // Lengths of a path at the ends of its characters and rows of the
+  // distance matrix for them; a row has chars_.size() + 1 cells.
+  std::vector<SizeType> char_ends_;
+  std::vector<BaseType> rows_;
+  BaseType last_index_;
+  SizeType distance_;
+  bool descends_;
+
+  // Disallows copies.
+  FuzzyCompleter(const FuzzyCompleter &);
+  FuzzyCompleter &operator=(const FuzzyCompleter &);
+
+  // Gets the number of bytes of a character from its first byte. Bytes
+  // which can't start a character are taken as characters.
+  static SizeType CharLength(UCharType first) {
+    if (first < 0xC0) {
+      return 1;
+    } else if (first < 0xE0) {
+      return 2;
+    } else if (first < 0xF0) {
+      return 3;
+    } else if (first < 0xF8) {
+      return 4;
+    }
+    return 1;
+  }
+  static BaseType DecodeChar(const UCharType *s, SizeType length) {
+    static const UCharType FIRST_MASKS[] = { 0xFF, 0xFF, 0x1F, 0x0F, 0x07 };
+    BaseType code = s[0] & FIRST_MASKS[length];
+    for (SizeType i = 1; i < length; ++i) {
+      code = (code << 6) | (s[i] & 0x3F);
+    }
+    return code;
+  }
+
+  // Appends a row for a character; returns false if all of its cells
+  // exceed the bound. A cell is not less than the difference of lengths
+  // of its prefixes, so only cells within max_distance of the diagonal
+  // are computed (Ukkonen's band); the last cell is always set.
+  bool AppendRow(BaseType c) {
+    SizeType width = chars_.size() + 1;
+    SizeType prev = rows_.size() - width;
+    rows_.resize(rows_.size() + width);
+    BaseType *row = &rows_[prev + width];
+    const BaseType *prev_row = &rows_[prev];
+
+    SizeType depth = char_ends_.size() - 1;
+    SizeType first = (depth > max_distance_) ? (depth - max_distance_) : 0;
+    SizeType last = depth + max_distance_;
+    if (last > chars_.size()) {
+      last = chars_.size();
+    }
+    row[chars_.size()] = static_cast<BaseType>(max_distance_ + 1);
+    if (first > last) {
+      return false;
+    }
+
+    BaseType min_cell = static_cast<BaseType>(max_distance_ + 1);
+    for (SizeType i = first; i <= last; ++i) {
+      BaseType cell;
+      if (i == 0) {
+        cell = prev_row[0] + 1;
+      } else {
+        cell = prev_row[i - 1] + (chars_[i - 1] != c);
+        if (i < depth + max_distance_ && prev_row[i] + 1 < cell) {
+          cell = prev_row[i] + 1;
+        }
+        if (i > first && row[i - 1] + 1 < cell) {
+          cell = row[i - 1] + 1;
+        }
+      }
+      row[i] = cell;
+      if (cell < min_cell) {
+        min_cell = cell;
+      }
+    }
+    return min_cell <= max_distance_;
+  }
+
+  // Removes the last label and the row of a character which ends there.
+  void Pop() {
+    if (char_ends_.back() == length()) {
+      char_ends_.pop_back();
+      rows_.resize(rows_.size() - chars_.size() - 1);
+    }
+    key_.pop_back();
+    key_.back() = '\0';
+    index_stack_.pop_back();
+  }
+
+  bool IsKey(BaseType index) const {
+    if (separator_ == '\0') {
+      return dic_->has_value(index);
+    }
+    return dic_->Follow(static_cast<CharType>(separator_), &index);
+  }
+
+  // Gets labels from a guide; a path in a tail has only one child and
+  // no siblings. Transitions by a separator are skipped.
+  UCharType child(BaseType index) const {
+    UCharType label = '\0';
+    BaseType tail_index;
+    if (index < guide_->size()) {
+      label = guide_->child(index);
+    }
+    if (label == '\0' && dic_->FindTail(index, &tail_index)) {
+      label = static_cast<UCharType>(*dic_->tail_chars(tail_index));
+    }
+    if (label != '\0' && label == separator_) {
+      if (!dic_->Follow(static_cast<CharType>(label), &index)) {
+        return '\0';
+      }
+      label = sibling(index);
+    }
+    return label;
+  }
+  UCharType sibling(BaseType index) const {
+    return (index < guide_->size()) ? guide_->sibling(index) : '\0';
+  }
+};
+
+}  // namespace dawgdic
+
+#endif  // DAWGDIC_FUZZY_COMPLETER_H
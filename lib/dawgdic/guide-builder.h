@@ -5,6 +5,7 @@
 #include "dawg.h"
 #include "dictionary.h"
 
+#include <utility>
 #include <vector>
 
 namespace dawgdic {
@@ -24,13 +25,16 @@ class GuideBuilder {
 
   std::vector<GuideUnit> units_;
   std::vector<UCharType> is_fixed_table_;
+  // Pairs of the next sibling to visit and an index of its parent.
+  std::vector<std::pair<BaseType, BaseType> > node_stack_;
 
   // Disallows copies.
   GuideBuilder(const GuideBuilder &);
   GuideBuilder &operator=(const GuideBuilder &);
 
   GuideBuilder(const Dawg &dawg, const Dictionary &dic, Guide *guide)
-    : dawg_(dawg), dic_(dic), guide_(guide), units_(), is_fixed_table_() {}
+    : dawg_(dawg), dic_(dic), guide_(guide), units_(), is_fixed_table_(),
+      node_stack_() {}
 
   bool BuildGuide() {
     // Initializes units and flags.
@@ -49,44 +53,70 @@ class GuideBuilder {
     return true;
   }
 
-  // Builds a guide recursively.
+  // Builds a guide in depth-first order. An explicit stack is used
+  // instead of recursion because keys may be very long.
   bool BuildGuide(BaseType dawg_index, BaseType dic_index) {
+    node_stack_.clear();
+    BaseType dawg_child_index = BuildNode(dawg_index, dic_index);
+    for ( ; ; ) {
+      // Resumes visiting siblings after descendants of a node.
+      if (dawg_child_index == 0) {
+        if (node_stack_.empty()) {
+          return true;
+        }
+        dawg_child_index = node_stack_.back().first;
+        dic_index = node_stack_.back().second;
+        node_stack_.pop_back();
+      }
+
+      BaseType dawg_sibling_index = dawg_.sibling(dawg_child_index);
+      BaseType dic_child_index = dic_index;
+      if (!dic_.Follow(dawg_.label(dawg_child_index), &dic_child_index)) {
+        return false;
+      }
+      if (dawg_sibling_index != 0) {
+        units_[dic_child_index].set_sibling(dawg_.label(dawg_sibling_index));
+      }
+
+      BaseType dawg_grandchild_index =
+          BuildNode(dawg_child_index, dic_child_index);
+      if (dawg_grandchild_index != 0) {
+        if (dawg_sibling_index != 0) {
+          node_stack_.push_back(
+              std::make_pair(dawg_sibling_index, dic_index));
+        }
+        dawg_child_index = dawg_grandchild_index;
+        dic_index = dic_child_index;
+      } else {
+        dawg_child_index = dawg_sibling_index;
+      }
+    }
+  }
+
+  // Sets the first child of a node and returns it if children of the
+  // node have to be visited, or returns 0 otherwise.
+  BaseType BuildNode(BaseType dawg_index, BaseType dic_index) {
     if (is_fixed(dic_index)) {
-      return true;
+      return 0;
     }
     set_is_fixed(dic_index);
 
+    // A unit which leads to a tail has no children.
+    BaseType tail_index;
+    if (dic_.FindTail(dic_index, &tail_index)) {
+      return 0;
+    }
+
     // Finds the first non-terminal child.
     BaseType dawg_child_index = dawg_.child(dawg_index);
     if (dawg_.label(dawg_child_index) == '\0') {
       dawg_child_index = dawg_.sibling(dawg_child_index);
       if (dawg_child_index == 0) {
-        return true;
+        return 0;
       }
     }
     units_[dic_index].set_child(dawg_.label(dawg_child_index));
-
-    do {
-      UCharType child_label = dawg_.label(dawg_child_index);
-      BaseType dic_child_index = dic_index;
-      if (!dic_.Follow(child_label, &dic_child_index)) {
-        return false;
-      }
-
-      if (!BuildGuide(dawg_child_index, dic_child_index)) {
-        return false;
-      }
-
-      BaseType dawg_sibling_index = dawg_.sibling(dawg_child_index);
-      UCharType sibling_label = dawg_.label(dawg_sibling_index);
-      if (dawg_sibling_index != 0) {
-        units_[dic_child_index].set_sibling(sibling_label);
-      }
-
-      dawg_child_index = dawg_sibling_index;
-    } while (dawg_child_index != 0);
-
-    return true;
+    return dawg_child_index;
   }
 
   void set_is_fixed(BaseType index) {
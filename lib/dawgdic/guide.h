@@ -25,6 +25,10 @@ class Guide {
   SizeType file_size() const {
     return sizeof(BaseType) + total_size();
   }
+  // Size of units owned by a guide; mapped units are not counted.
+  SizeType heap_size() const {
+    return sizeof(GuideUnit) * units_buf_.capacity();
+  }
 
   // The root index.
   BaseType root() const {
@@ -12,6 +12,11 @@ class LinkTable {
  public:
   explicit LinkTable() : hash_table_() {}
 
+  // Size of a hash table in bytes.
+  SizeType total_size() const {
+    return sizeof(PairType) * hash_table_.capacity();
+  }
+
   // Initializes a hash table.
   void Init(SizeType table_size) {
     PairType initial_pair(0, 0);
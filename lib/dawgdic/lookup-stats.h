@@ -0,0 +1,151 @@
+#ifndef DAWGDIC_LOOKUP_STATS_H
+#define DAWGDIC_LOOKUP_STATS_H
+
+#include <atomic>
+#include <chrono>
+
+#include "base-types.h"
+
+// Lookups are counted only if DAWGDIC_LOOKUP_STATS is defined; callers
+// check DAWGDIC_LOOKUP_STATS_ENABLED, so counting code is removed by a
+// compiler otherwise.
+#ifdef DAWGDIC_LOOKUP_STATS
+#define DAWGDIC_LOOKUP_STATS_ENABLED 1
+#else  // DAWGDIC_LOOKUP_STATS
+#define DAWGDIC_LOOKUP_STATS_ENABLED 0
+#endif  // DAWGDIC_LOOKUP_STATS
+
+namespace dawgdic {
+
+// Kinds of counted lookups.
+enum LookupKind {
+  LOOKUP_GET,
+  LOOKUP_KEYS,
+  LOOKUP_PREFIXES,
+  LOOKUP_SIMILAR_KEYS,
+  NUM_OF_LOOKUP_KINDS
+};
+
+// Counters of lookups of one kind. The i-th bucket of latencies counts
+// lookups which took [2^i, 2^(i+1)) nanoseconds.
+struct LookupCounters {
+  enum {
+    NUM_OF_BUCKETS = 40
+  };
+
+  unsigned long long num_of_calls;
+  unsigned long long num_of_hits;
+  unsigned long long num_of_misses;
+  unsigned long long num_of_transitions;
+  unsigned long long num_of_completions;
+  unsigned long long latencies[NUM_OF_BUCKETS];
+};
+
+// Lookup counters of an object. Counters are sharded by threads: each
+// thread updates a cache-aligned shard, and Get() sums all shards. If
+// there are more threads than shards, threads share shards, so updates
+// are atomic; they are uncontended while threads don't share shards.
+class LookupStats {
+ public:
+  LookupStats() {
+    Clear();
+  }
+
+  // Current time in nanoseconds.
+  static unsigned long long Now() {
+    return static_cast<unsigned long long>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count());
+  }
+
+  // Records a lookup which started at start_time.
+  void Record(LookupKind kind, bool is_hit, SizeType num_of_transitions,
+              SizeType num_of_completions, unsigned long long start_time) {
+    unsigned long long latency = Now() - start_time;
+    SizeType bucket = 0;
+    for ( ; (latency >> 1) != 0 &&
+          bucket + 1 < LookupCounters::NUM_OF_BUCKETS; latency >>= 1) {
+      ++bucket;
+    }
+
+    Counter *counters = shards_[ShardId()].counters[kind];
+    Add(&counters[CALLS], 1);
+    Add(&counters[is_hit ? HITS : MISSES], 1);
+    Add(&counters[TRANSITIONS], num_of_transitions);
+    Add(&counters[COMPLETIONS], num_of_completions);
+    Add(&counters[LATENCIES + bucket], 1);
+  }
+
+  // Gets counters of a kind summed over shards.
+  void Get(LookupKind kind, LookupCounters *result) const {
+    unsigned long long sums[NUM_OF_FIELDS] = {};
+    for (SizeType i = 0; i < NUM_OF_SHARDS; ++i) {
+      const Counter *counters = shards_[i].counters[kind];
+      for (SizeType j = 0; j < NUM_OF_FIELDS; ++j) {
+        sums[j] += counters[j].load(std::memory_order_relaxed);
+      }
+    }
+    result->num_of_calls = sums[CALLS];
+    result->num_of_hits = sums[HITS];
+    result->num_of_misses = sums[MISSES];
+    result->num_of_transitions = sums[TRANSITIONS];
+    result->num_of_completions = sums[COMPLETIONS];
+    for (SizeType i = 0; i < LookupCounters::NUM_OF_BUCKETS; ++i) {
+      result->latencies[i] = sums[LATENCIES + i];
+    }
+  }
+
+  // Resets counters.
+  void Clear() {
+    for (SizeType i = 0; i < NUM_OF_SHARDS; ++i) {
+      for (SizeType kind = 0; kind < NUM_OF_LOOKUP_KINDS; ++kind) {
+        for (SizeType j = 0; j < NUM_OF_FIELDS; ++j) {
+          shards_[i].counters[kind][j].store(0, std::memory_order_relaxed);
+        }
+      }
+    }
+  }
+
+ private:
+  typedef std::atomic<unsigned long long> Counter;
+
+  enum {
+    NUM_OF_SHARDS = 16,
+    CALLS = 0,
+    HITS,
+    MISSES,
+    TRANSITIONS,
+    COMPLETIONS,
+    LATENCIES,
+    NUM_OF_FIELDS = LATENCIES + LookupCounters::NUM_OF_BUCKETS
+  };
+
+  struct alignas(64) Shard {
+    Counter counters[NUM_OF_LOOKUP_KINDS][NUM_OF_FIELDS];
+  };
+
+  Shard shards_[NUM_OF_SHARDS];
+
+  // Disallows copies.
+  LookupStats(const LookupStats &);
+  LookupStats &operator=(const LookupStats &);
+
+  // Counters are not used to order other memory accesses, so relaxed
+  // updates are enough.
+  static void Add(Counter *counter, unsigned long long value) {
+    counter->fetch_add(value, std::memory_order_relaxed);
+  }
+
+  // Threads get shards in the order of their first lookups.
+  static SizeType ShardId() {
+    static std::atomic<SizeType> num_of_threads(0);
+    thread_local SizeType shard_id =
+        num_of_threads.fetch_add(1, std::memory_order_relaxed) %
+        NUM_OF_SHARDS;
+    return shard_id;
+  }
+};
+
+}  // namespace dawgdic
+
+#endif  // DAWGDIC_LOOKUP_STATS_H
@@ -1,6 +1,8 @@
 #ifndef DAWGDIC_OBJECT_POOL_H
 #define DAWGDIC_OBJECT_POOL_H
 
+#include <memory>
+#include <new>
 #include <vector>
 
 #include "base-types.h"
@@ -8,7 +10,11 @@
 namespace dawgdic {
 
 // This class works like an array of objects with compact memory management.
-template <typename OBJECT_TYPE, SizeType BLOCK_SIZE = 1 << 10>
+// Objects are stored in blocks of 2MB (the size of a huge page) and are
+// constructed when allocated, so pages of a block are not touched until
+// they are used.
+template <typename OBJECT_TYPE,
+          SizeType BLOCK_SIZE = (1 << 21) / sizeof(OBJECT_TYPE)>
 class ObjectPool {
  public:
   typedef OBJECT_TYPE ObjectType;
@@ -30,11 +36,19 @@ class ObjectPool {
   SizeType size() const {
     return size_;
   }
+  // Size of allocated objects in bytes. The rest of the last block is
+  // reserved but not touched, so it is not counted.
+  SizeType total_size() const {
+    return sizeof(ObjectType) * size_;
+  }
 
   // Deletes all objects and frees memory.
   void Clear() {
+    for (SizeType i = 0; i < size_; ++i) {
+      (*this)[i].~ObjectType();
+    }
     for (SizeType i = 0; i < blocks_.size(); ++i) {
-      delete [] blocks_[i];
+      ::operator delete(blocks_[i]);
     }
 
     std::vector<ObjectType *>(0).swap(blocks_);
@@ -47,11 +61,29 @@ class ObjectPool {
     std::swap(size_, pool->size_);
   }
 
+  // Copies objects of another pool.
+  void Copy(const ObjectPool &pool) {
+    Clear();
+    for (SizeType i = 0; i < pool.blocks_.size(); ++i) {
+      blocks_.push_back(static_cast<ObjectType *>(
+          ::operator new(sizeof(ObjectType) * BLOCK_SIZE)));
+      SizeType end = pool.size_ - i * BLOCK_SIZE;
+      if (end > BLOCK_SIZE) {
+        end = BLOCK_SIZE;
+      }
+      std::uninitialized_copy(pool.blocks_[i], pool.blocks_[i] + end,
+                              blocks_[i]);
+    }
+    size_ = pool.size_;
+  }
+
   // Allocates memory for a new object and returns its ID.
   SizeType Allocate() {
     if (size_ == BLOCK_SIZE * blocks_.size()) {
-      blocks_.push_back(new ObjectType[BLOCK_SIZE]);
+      blocks_.push_back(static_cast<ObjectType *>(
+          ::operator new(sizeof(ObjectType) * BLOCK_SIZE)));
     }
+    new (&(*this)[size_]) ObjectType;
     return size_++;
   }
 
@@ -0,0 +1,170 @@
+#ifndef DAWGDIC_PACKED_ARRAY_H
+#define DAWGDIC_PACKED_ARRAY_H
+
+#include <iostream>
+#include <utility>
+#include <vector>
+
+#include "base-types.h"
+
+namespace dawgdic {
+
+// Array of unsigned integers packed with the minimum number of bits.
+// An array written by Write() can also be mapped from memory.
+class PackedArray {
+ public:
+  PackedArray() : units_(NULL), size_(0), width_(0), units_buf_() {}
+
+  BaseType operator[](SizeType index) const {
+    if (width_ == 0) {
+      return 0;
+    }
+    SizeType bit = index * width_;
+    SizeType unit = bit / UNIT_BITS;
+    SizeType shift = bit % UNIT_BITS;
+    unsigned long long value = units_[unit] >> shift;
+    if (shift + width_ > UNIT_BITS) {
+      value |= static_cast<unsigned long long>(units_[unit + 1]) <<
+          (UNIT_BITS - shift);
+    }
+    return static_cast<BaseType>(value & ((1ULL << width_) - 1));
+  }
+
+  // Number of values.
+  SizeType size() const {
+    return size_;
+  }
+  // Number of bits per value.
+  SizeType width() const {
+    return width_;
+  }
+  SizeType total_size() const {
+    return sizeof(BaseType) * NumOfUnits(size_, width_);
+  }
+  // Number of bytes allocated for an array; mapped data is not counted.
+  SizeType heap_size() const {
+    return sizeof(BaseType) * units_buf_.capacity();
+  }
+  SizeType file_size() const {
+    return sizeof(BaseType) * 2 + total_size();
+  }
+
+  // Packs values.
+  void Build(const std::vector<BaseType> &values) {
+    BaseType max_value = 0;
+    for (SizeType i = 0; i < values.size(); ++i) {
+      max_value |= values[i];
+    }
+    width_ = 0;
+    for ( ; max_value != 0; max_value >>= 1) {
+      ++width_;
+    }
+    size_ = values.size();
+
+    std::vector<BaseType>(NumOfUnits(size_, width_), 0).swap(units_buf_);
+    units_ = units_buf_.empty() ? NULL : &units_buf_[0];
+    if (width_ == 0) {
+      return;
+    }
+    for (SizeType i = 0; i < size_; ++i) {
+      SizeType bit = i * width_;
+      SizeType unit = bit / UNIT_BITS;
+      SizeType shift = bit % UNIT_BITS;
+      units_buf_[unit] |= values[i] << shift;
+      if (shift + width_ > UNIT_BITS) {
+        units_buf_[unit + 1] |= values[i] >> (UNIT_BITS - shift);
+      }
+    }
+  }
+
+  // Reads an array from an input stream.
+  bool Read(std::istream *input) {
+    BaseType header[2];
+    if (!input->read(reinterpret_cast<char *>(header), sizeof(header)) ||
+        header[1] > UNIT_BITS) {
+      return false;
+    }
+    std::vector<BaseType> units(NumOfUnits(header[0], header[1]));
+    if (!units.empty() &&
+        !input->read(reinterpret_cast<char *>(&units[0]),
+                     sizeof(BaseType) * units.size())) {
+      return false;
+    }
+    units_buf_.swap(units);
+    units_ = units_buf_.empty() ? NULL : &units_buf_[0];
+    size_ = header[0];
+    width_ = header[1];
+    return true;
+  }
+
+  // Maps an array written by Write(); *address is moved to the end of
+  // the array.
+  bool Map(const BaseType **address, const BaseType *end) {
+    const BaseType *header = *address;
+    if (end - header < 2 || header[1] > UNIT_BITS) {
+      return false;
+    }
+    SizeType num_of_units = NumOfUnits(header[0], header[1]);
+    if (static_cast<SizeType>(end - header) - 2 < num_of_units) {
+      return false;
+    }
+    Clear();
+    units_ = header + 2;
+    size_ = header[0];
+    width_ = header[1];
+    *address = units_ + num_of_units;
+    return true;
+  }
+
+  // Writes an array to an output stream.
+  bool Write(std::ostream *output) const {
+    BaseType header[2] = {
+      static_cast<BaseType>(size_), static_cast<BaseType>(width_)
+    };
+    if (!output->write(reinterpret_cast<const char *>(header),
+                       sizeof(header))) {
+      return false;
+    }
+    return total_size() == 0 ||
+        output->write(reinterpret_cast<const char *>(units_), total_size());
+  }
+
+  // Initializes an array.
+  void Clear() {
+    units_ = NULL;
+    size_ = 0;
+    width_ = 0;
+    std::vector<BaseType>(0).swap(units_buf_);
+  }
+
+  // Swaps arrays.
+  void Swap(PackedArray *array) {
+    std::swap(units_, array->units_);
+    std::swap(size_, array->size_);
+    std::swap(width_, array->width_);
+    units_buf_.swap(array->units_buf_);
+  }
+
+ private:
+  enum {
+    UNIT_BITS = 32
+  };
+
+  // Units point to a buffer or to mapped memory.
+  const BaseType *units_;
+  SizeType size_;
+  SizeType width_;
+  std::vector<BaseType> units_buf_;
+
+  // Disallows copies.
+  PackedArray(const PackedArray &);
+  PackedArray &operator=(const PackedArray &);
+
+  static SizeType NumOfUnits(SizeType size, SizeType width) {
+    return (size * width + UNIT_BITS - 1) / UNIT_BITS;
+  }
+};
+
+}  // namespace dawgdic
+
+#endif  // DAWGDIC_PACKED_ARRAY_H
@@ -0,0 +1,175 @@
+#ifndef DAWGDIC_PATTERN_MATCHER_H
+#define DAWGDIC_PATTERN_MATCHER_H
+
+#include <vector>
+
+#include "completer.h"
+#include "dawg-builder.h"
+#include "dictionary-builder.h"
+
+namespace dawgdic {
+
+// Aho-Corasick automaton of keys of a dictionary. A state of a dawg is
+// shared by keys with the same suffixes and so has no single failure
+// link; keys are unfolded into a trie which is stored as a dictionary,
+// and failure links, output links and depths of its units are kept in
+// arrays indexed by units. The root has no value, so 0 ends a chain of
+// output links.
+class PatternMatcher {
+ public:
+  PatternMatcher()
+    : dic_(), failures_(), outputs_(), depths_(), max_depth_(0) {}
+
+  // The trie of keys.
+  const Dictionary &dic() const {
+    return dic_;
+  }
+  // Number of units.
+  SizeType size() const {
+    return dic_.size();
+  }
+  // Size of the trie and links in bytes.
+  SizeType total_size() const {
+    return dic_.total_size() + sizeof(BaseType) *
+        (failures_.capacity() + outputs_.capacity() + depths_.capacity());
+  }
+  // Length of the longest key in bytes.
+  SizeType max_depth() const {
+    return max_depth_;
+  }
+
+  // The root index.
+  BaseType root() const {
+    return dic_.root();
+  }
+
+  // Moves from a state by a label; failure links are followed until a
+  // state has a transition by the label. Keys have no '\0', so it leads
+  // back to the root.
+  BaseType Next(BaseType index, UCharType label) const {
+    if (label == '\0') {
+      return root();
+    }
+    for ( ; ; ) {
+      BaseType next_index = index;
+      if (dic_.Follow(static_cast<CharType>(label), &next_index)) {
+        return next_index;
+      }
+      if (index == root()) {
+        return index;
+      }
+      index = failures_[index];
+    }
+  }
+
+  // Gets the longest key which ends at a state: the state itself or the
+  // first key on its failure links (0 if none).
+  BaseType output(BaseType index) const {
+    return dic_.has_value(index) ? index : outputs_[index];
+  }
+  // Gets the next shorter key which ends with a key (0 if none).
+  BaseType next_output(BaseType index) const {
+    return outputs_[index];
+  }
+  // Length of a key in bytes.
+  SizeType depth(BaseType index) const {
+    return depths_[index];
+  }
+  ValueType value(BaseType index) const {
+    return dic_.value(index);
+  }
+
+  // Builds a matcher of keys of a dictionary with a guide.
+  bool Build(const Dictionary &dic, const Guide &guide) {
+    Clear();
+
+    Dawg trie;
+    Guide trie_guide;
+    if (!BuildTrie(dic, guide, &trie) ||
+        !DictionaryBuilder::Build(trie, &dic_, &trie_guide)) {
+      Clear();
+      return false;
+    }
+    trie.Clear();
+
+    if (!BuildLinks(trie_guide)) {
+      Clear();
+      return false;
+    }
+    return true;
+  }
+
+  // Initializes a matcher.
+  void Clear() {
+    dic_.Clear();
+    std::vector<BaseType>(0).swap(failures_);
+    std::vector<BaseType>(0).swap(outputs_);
+    std::vector<BaseType>(0).swap(depths_);
+    max_depth_ = 0;
+  }
+
+ private:
+  Dictionary dic_;
+  std::vector<BaseType> failures_;
+  std::vector<BaseType> outputs_;
+  std::vector<BaseType> depths_;
+  SizeType max_depth_;
+
+  // Disallows copies.
+  PatternMatcher(const PatternMatcher &);
+  PatternMatcher &operator=(const PatternMatcher &);
+
+  // Keys are completed in sorted order, so they go straight into a
+  // builder which doesn't merge states.
+  static bool BuildTrie(const Dictionary &dic, const Guide &guide,
+                        Dawg *trie) {
+    Completer completer(dic, guide);
+    DawgBuilder builder(0, false);
+
+    completer.Start(dic.root());
+    while (completer.Next()) {
+      if (!builder.Insert(completer.key(), completer.length(),
+                          completer.value())) {
+        return false;
+      }
+    }
+    return builder.Finish(trie);
+  }
+
+  // States are visited in breadth-first order, so failure links of
+  // shallower states are ready when a state is visited.
+  bool BuildLinks(const Guide &guide) {
+    failures_.assign(dic_.size(), root());
+    outputs_.assign(dic_.size(), 0);
+    depths_.assign(dic_.size(), 0);
+
+    std::vector<BaseType> queue(1, root());
+    for (SizeType head = 0; head < queue.size(); ++head) {
+      BaseType index = queue[head];
+      UCharType label = guide.child(index);
+      while (label != '\0') {
+        BaseType child_index = index;
+        if (!dic_.Follow(static_cast<CharType>(label), &child_index)) {
+          return false;
+        }
+
+        BaseType failure = (index == root()) ?
+            root() : Next(failures_[index], label);
+        failures_[child_index] = failure;
+        outputs_[child_index] = output(failure);
+        depths_[child_index] = depths_[index] + 1;
+        if (depths_[child_index] > max_depth_) {
+          max_depth_ = depths_[child_index];
+        }
+
+        queue.push_back(child_index);
+        label = guide.sibling(child_index);
+      }
+    }
+    return true;
+  }
+};
+
+}  // namespace dawgdic
+
+#endif  // DAWGDIC_PATTERN_MATCHER_H
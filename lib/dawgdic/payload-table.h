@@ -0,0 +1,153 @@
+#ifndef DAWGDIC_PAYLOAD_TABLE_H
+#define DAWGDIC_PAYLOAD_TABLE_H
+
+#include <iostream>
+#include <vector>
+
+#include "base-types.h"
+
+namespace dawgdic {
+
+// Table of unique payloads which are referred to by IDs.
+class PayloadTable {
+ public:
+  PayloadTable()
+    : offsets_(NULL), data_(NULL), size_(0), offsets_buf_(), data_buf_() {}
+
+  // Number of payloads.
+  SizeType size() const {
+    return size_;
+  }
+  // Number of bytes used by payloads and their offsets.
+  SizeType total_size() const {
+    return sizeof(BaseType) * (size_ + 1) + data_size();
+  }
+  SizeType file_size() const {
+    return sizeof(BaseType) + total_size();
+  }
+  // Number of bytes owned by a table; mapped data is not counted.
+  SizeType heap_size() const {
+    return sizeof(BaseType) * offsets_buf_.capacity() + data_buf_.capacity();
+  }
+
+  // Reads a payload.
+  const char *payload(BaseType id) const {
+    return data_ + offsets_[id];
+  }
+  SizeType payload_length(BaseType id) const {
+    return offsets_[id + 1] - offsets_[id];
+  }
+
+  // Appends a payload and returns its ID.
+  BaseType Append(const char *payload, SizeType length) {
+    if (offsets_buf_.empty()) {
+      offsets_buf_.push_back(0);
+    }
+    data_buf_.insert(data_buf_.end(), payload, payload + length);
+    offsets_buf_.push_back(static_cast<BaseType>(data_buf_.size()));
+    ResetPointers();
+    return static_cast<BaseType>(size_ - 1);
+  }
+
+  // Reads a table from an input stream.
+  bool Read(std::istream *input) {
+    BaseType base_size;
+    if (!input->read(reinterpret_cast<char *>(&base_size), sizeof(BaseType))) {
+      return false;
+    }
+
+    std::vector<BaseType> offsets_buf(base_size + 1);
+    if (!input->read(reinterpret_cast<char *>(&offsets_buf[0]),
+                     sizeof(BaseType) * offsets_buf.size())) {
+      return false;
+    }
+    for (SizeType i = 1; i < offsets_buf.size(); ++i) {
+      if (offsets_buf[i] < offsets_buf[i - 1]) {
+        return false;
+      }
+    }
+
+    std::vector<char> data_buf(offsets_buf.back());
+    if (!data_buf.empty() && !input->read(&data_buf[0], data_buf.size())) {
+      return false;
+    }
+
+    offsets_buf_.swap(offsets_buf);
+    data_buf_.swap(data_buf);
+    ResetPointers();
+    return true;
+  }
+
+  // Writes a table to an output stream.
+  bool Write(std::ostream *output) const {
+    BaseType base_size = static_cast<BaseType>(size_);
+    if (!output->write(reinterpret_cast<const char *>(&base_size),
+                       sizeof(BaseType))) {
+      return false;
+    }
+
+    BaseType zero = 0;
+    const BaseType *offsets = (offsets_ != NULL) ? offsets_ : &zero;
+    if (!output->write(reinterpret_cast<const char *>(offsets),
+                       sizeof(BaseType) * (size_ + 1))) {
+      return false;
+    }
+
+    if (data_size() != 0 && !output->write(data_, data_size())) {
+      return false;
+    }
+
+    return true;
+  }
+
+  // Maps memory written by Write().
+  void Map(const void *address) {
+    Clear();
+    size_ = *static_cast<const BaseType *>(address);
+    offsets_ = static_cast<const BaseType *>(address) + 1;
+    data_ = reinterpret_cast<const char *>(offsets_ + size_ + 1);
+  }
+
+  // Initializes a table.
+  void Clear() {
+    offsets_ = NULL;
+    data_ = NULL;
+    size_ = 0;
+    std::vector<BaseType>(0).swap(offsets_buf_);
+    std::vector<char>(0).swap(data_buf_);
+  }
+
+  // Swaps tables.
+  void Swap(PayloadTable *table) {
+    std::swap(offsets_, table->offsets_);
+    std::swap(data_, table->data_);
+    std::swap(size_, table->size_);
+    offsets_buf_.swap(table->offsets_buf_);
+    data_buf_.swap(table->data_buf_);
+  }
+
+ private:
+  const BaseType *offsets_;
+  const char *data_;
+  SizeType size_;
+  std::vector<BaseType> offsets_buf_;
+  std::vector<char> data_buf_;
+
+  // Disallows copies.
+  PayloadTable(const PayloadTable &);
+  PayloadTable &operator=(const PayloadTable &);
+
+  SizeType data_size() const {
+    return (offsets_ != NULL) ? offsets_[size_] : 0;
+  }
+
+  void ResetPointers() {
+    offsets_ = offsets_buf_.empty() ? NULL : &offsets_buf_[0];
+    data_ = data_buf_.empty() ? NULL : &data_buf_[0];
+    size_ = offsets_buf_.empty() ? 0 : offsets_buf_.size() - 1;
+  }
+};
+
+}  // namespace dawgdic
+
+#endif  // DAWGDIC_PAYLOAD_TABLE_H
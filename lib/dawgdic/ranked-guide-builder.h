@@ -29,6 +29,17 @@ class RankedGuideBuilder {
   }
 
  private:
+  // A node whose links are being enumerated.
+  struct Node {
+    BaseType dic_index;
+    // The next child to visit.
+    BaseType dawg_child_index;
+    // The first link of the node.
+    SizeType links_begin;
+    // Label of a transition to the node.
+    UCharType label;
+  };
+
   const Dawg &dawg_;
   const Dictionary &dic_;
   RankedGuide *guide_;
@@ -36,6 +47,7 @@ class RankedGuideBuilder {
   std::vector<RankedGuideUnit> units_;
   std::vector<RankedGuideLink> links_;
   std::vector<UCharType> is_fixed_table_;
+  std::vector<Node> node_stack_;
 
   // Disallows copies.
   RankedGuideBuilder(const RankedGuideBuilder &);
@@ -44,7 +56,7 @@ class RankedGuideBuilder {
   RankedGuideBuilder(const Dawg &dawg, const Dictionary &dic,
                      RankedGuide *guide)
     : dawg_(dawg), dic_(dic), guide_(guide),
-      units_(), links_(), is_fixed_table_() {}
+      units_(), links_(), is_fixed_table_(), node_stack_() {}
 
   template <typename VALUE_COMPARER_TYPE>
   bool BuildRankedGuide(VALUE_COMPARER_TYPE value_comparer) {
@@ -55,6 +67,10 @@ class RankedGuideBuilder {
     if (dawg_.size() <= 1) {
       return true;
     }
+    // Ranked completion doesn't support tails.
+    if (dic_.has_tail()) {
+      return false;
+    }
 
     ValueType max_value = -1;
     if (!BuildRankedGuide(dawg_.root(), dic_.root(),
@@ -66,35 +82,79 @@ class RankedGuideBuilder {
     return true;
   }
 
-  // Builds a guide recursively.
+  // Builds a guide in depth-first order. An explicit stack is used
+  // instead of recursion because keys may be very long.
   template <typename VALUE_COMPARER_TYPE>
   bool BuildRankedGuide(BaseType dawg_index, BaseType dic_index,
                         ValueType *max_value,
                         VALUE_COMPARER_TYPE value_comparer) {
-    if (is_fixed(dic_index)) {
-      return FindMaxValue(dic_index, max_value);
-    }
+    node_stack_.clear();
     set_is_fixed(dic_index);
+    Node node = MakeNode(dawg_index, dic_index, '\0');
+
+    for ( ; ; ) {
+      if (node.dawg_child_index != 0) {
+        // Enumerates links to the next states.
+        BaseType dawg_child_index = node.dawg_child_index;
+        node.dawg_child_index = dawg_.sibling(dawg_child_index);
+
+        ValueType value = -1;
+        UCharType child_label = dawg_.label(dawg_child_index);
+        if (child_label == '\0') {
+          if (!dic_.has_value(node.dic_index)) {
+            return false;
+          }
+          value = dic_.value(node.dic_index);
+        } else {
+          BaseType dic_child_index = node.dic_index;
+          if (!dic_.Follow(child_label, &dic_child_index)) {
+            return false;
+          }
+
+          if (!is_fixed(dic_child_index)) {
+            set_is_fixed(dic_child_index);
+            node_stack_.push_back(node);
+            node = MakeNode(dawg_child_index, dic_child_index, child_label);
+            continue;
+          }
+          if (!FindMaxValue(dic_child_index, &value)) {
+            return false;
+          }
+        }
+        links_.push_back(RankedGuideLink(child_label, value));
+        continue;
+      }
 
-    SizeType initial_num_links = links_.size();
+      std::stable_sort(links_.begin() + node.links_begin, links_.end(),
+        RankedGuideLink::MakeComparer(value_comparer));
 
-    // Enumerates links to the next states.
-    if (!EnumerateLinks(dawg_index, dic_index, value_comparer)) {
-      return false;
-    }
+      // Reflects links into units.
+      if (!TurnLinksToUnits(node.dic_index, node.links_begin)) {
+        return false;
+      }
 
-    std::stable_sort(links_.begin() + initial_num_links, links_.end(),
-      RankedGuideLink::MakeComparer(value_comparer));
+      ValueType value = links_[node.links_begin].value();
+      links_.resize(node.links_begin);
 
-    // Reflects links into units.
-    if (!TurnLinksToUnits(dic_index, initial_num_links)) {
-      return false;
+      if (node_stack_.empty()) {
+        *max_value = value;
+        return true;
+      }
+      links_.push_back(RankedGuideLink(node.label, value));
+      node = node_stack_.back();
+      node_stack_.pop_back();
     }
+  }
 
-    *max_value = links_[initial_num_links].value();
-    links_.resize(initial_num_links);
-
-    return true;
+  // Makes a node whose links are to be enumerated.
+  Node MakeNode(BaseType dawg_index, BaseType dic_index,
+                UCharType label) const {
+    Node node;
+    node.dic_index = dic_index;
+    node.dawg_child_index = dawg_.child(dawg_index);
+    node.links_begin = links_.size();
+    node.label = label;
+    return node;
   }
 
   // Finds the maximum value by using fixed units.
@@ -112,37 +172,6 @@ class RankedGuideBuilder {
     return true;
   }
 
-  // Enumerates links to the next states.
-  template <typename VALUE_COMPARER_TYPE>
-  bool EnumerateLinks(BaseType dawg_index, BaseType dic_index,
-                      VALUE_COMPARER_TYPE value_comparer) {
-    for (BaseType dawg_child_index = dawg_.child(dawg_index);
-        dawg_child_index != 0;
-        dawg_child_index = dawg_.sibling(dawg_child_index)) {
-      ValueType value = -1;
-      UCharType child_label = dawg_.label(dawg_child_index);
-      if (child_label == '\0') {
-        if (!dic_.has_value(dic_index)) {
-          return false;
-        }
-        value = dic_.value(dic_index);
-      } else {
-        BaseType dic_child_index = dic_index;
-        if (!dic_.Follow(child_label, &dic_child_index)) {
-          return false;
-        }
-
-        if (!BuildRankedGuide(dawg_child_index, dic_child_index,
-                              &value, value_comparer)) {
-          return false;
-        }
-      }
-      links_.push_back(RankedGuideLink(child_label, value));
-    }
-
-    return true;
-  }
-
   // Modifies units.
   bool TurnLinksToUnits(BaseType dic_index, SizeType links_begin) {
     // The first child.
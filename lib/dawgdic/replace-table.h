@@ -0,0 +1,131 @@
+#ifndef DAWGDIC_REPLACE_TABLE_H
+#define DAWGDIC_REPLACE_TABLE_H
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+#include "base-types.h"
+
+namespace dawgdic {
+
+// Table of replacements of byte strings (e.g. UTF-8 characters) for
+// SimilarCompleter. Rules are sorted by sources and grouped by their
+// first bytes, so rules which may match at a position of a key are
+// found by one lookup.
+class ReplaceTable {
+ public:
+  ReplaceTable() : rules_(), chars_(), begins_(257, 0) {}
+
+  // Number of rules.
+  SizeType size() const {
+    return rules_.size();
+  }
+  // Size of rules, their strings and the index in bytes.
+  SizeType total_size() const {
+    return sizeof(Rule) * rules_.capacity() + chars_.capacity() +
+        sizeof(BaseType) * begins_.capacity();
+  }
+
+  // Adds a rule; rules are available after Build().
+  bool Add(const CharType *source, SizeType source_length,
+           const CharType *target, SizeType target_length) {
+    if (source_length == 0 || target_length == 0) {
+      return false;
+    }
+    Rule rule;
+    rule.source = static_cast<BaseType>(chars_.size());
+    rule.source_length = static_cast<BaseType>(source_length);
+    chars_.insert(chars_.end(), source, source + source_length);
+    rule.target = static_cast<BaseType>(chars_.size());
+    rule.target_length = static_cast<BaseType>(target_length);
+    chars_.insert(chars_.end(), target, target + target_length);
+    rules_.push_back(rule);
+    return true;
+  }
+
+  // Sorts rules and indexes them by first bytes of sources.
+  void Build() {
+    std::stable_sort(rules_.begin(), rules_.end(), RuleLess(chars_));
+    begins_.assign(257, 0);
+    for (SizeType i = 0; i < rules_.size(); ++i) {
+      ++begins_[static_cast<UCharType>(chars_[rules_[i].source]) + 1];
+    }
+    for (SizeType i = 1; i < begins_.size(); ++i) {
+      begins_[i] += begins_[i - 1];
+    }
+  }
+
+  // Rules whose sources start with a given byte are [begin, end).
+  BaseType begin(UCharType first) const {
+    return begins_[first];
+  }
+  BaseType end(UCharType first) const {
+    return begins_[first + 1];
+  }
+
+  const CharType *source(BaseType id) const {
+    return &chars_[rules_[id].source];
+  }
+  SizeType source_length(BaseType id) const {
+    return rules_[id].source_length;
+  }
+  const CharType *target(BaseType id) const {
+    return &chars_[rules_[id].target];
+  }
+  SizeType target_length(BaseType id) const {
+    return rules_[id].target_length;
+  }
+
+  // Checks if the source of a rule is at the beginning of a string.
+  bool Matches(BaseType id, const CharType *s, SizeType length) const {
+    return source_length(id) <= length &&
+        std::memcmp(source(id), s, source_length(id)) == 0;
+  }
+
+  // Initializes a table.
+  void Clear() {
+    std::vector<Rule>(0).swap(rules_);
+    std::vector<CharType>(0).swap(chars_);
+    begins_.assign(257, 0);
+  }
+
+ private:
+  struct Rule {
+    BaseType source;
+    BaseType source_length;
+    BaseType target;
+    BaseType target_length;
+  };
+
+  // Compares sources of rules as unsigned bytes.
+  class RuleLess {
+   public:
+    explicit RuleLess(const std::vector<CharType> &chars) : chars_(&chars) {}
+
+    bool operator()(const Rule &lhs, const Rule &rhs) const {
+      SizeType length = std::min(lhs.source_length, rhs.source_length);
+      int result = std::memcmp(&(*chars_)[lhs.source],
+                               &(*chars_)[rhs.source], length);
+      if (result != 0) {
+        return result < 0;
+      }
+      return lhs.source_length < rhs.source_length;
+    }
+
+   private:
+    const std::vector<CharType> *chars_;
+  };
+
+  std::vector<Rule> rules_;
+  std::vector<CharType> chars_;
+  std::vector<BaseType> begins_;
+
+  // Disallows copies.
+  ReplaceTable(const ReplaceTable &);
+  ReplaceTable &operator=(const ReplaceTable &);
+};
+
+}  // namespace dawgdic
+
+#endif  // DAWGDIC_REPLACE_TABLE_H
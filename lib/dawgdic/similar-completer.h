@@ -0,0 +1,188 @@
+#ifndef DAWGDIC_SIMILAR_COMPLETER_H
+#define DAWGDIC_SIMILAR_COMPLETER_H
+
+#include "replace-table.h"
+
+#include <vector>
+
+namespace dawgdic {
+
+// Finds variants of a key which are keys of a dictionary (Dictionary or
+// SuccinctDawg): each substring of the key which is a source of a rule
+// may be replaced with its target. Replaced strings are not replaced
+// again. For each state of a search the key without further replacements
+// comes first, then variants with a replacement at each position from
+// left to right. The search uses an explicit stack of such states.
+//
+// If a separator is set, keys are paths which are followed by the
+// separator (as in BytesDAWG).
+template <typename DictionaryType>
+class SimilarCompleter {
+ public:
+  SimilarCompleter()
+    : dic_(NULL), table_(NULL), separator_('\0'), key_(NULL), length_(0),
+      result_(), frames_(), path_(), last_index_(0) {}
+
+  void set_dic(const DictionaryType &dic) {
+    dic_ = &dic;
+  }
+  void set_table(const ReplaceTable &table) {
+    table_ = &table;
+  }
+  void set_separator(UCharType separator) {
+    separator_ = separator;
+  }
+
+  // These member functions are available only when Next() returns true.
+  const char *key() const {
+    return result_.empty() ? "" : &result_[0];
+  }
+  SizeType length() const {
+    return result_.size();
+  }
+  // The index of the end of a key (before a separator).
+  BaseType index() const {
+    return last_index_;
+  }
+
+  // Starts finding variants of a key; the key must outlive a search.
+  void Start(const char *key, SizeType length) {
+    key_ = key;
+    length_ = length;
+    result_.clear();
+    frames_.clear();
+    path_.clear();
+    PushFrame(0, 0, dic_->root());
+  }
+
+  // Gets the next variant.
+  bool Next() {
+    while (!frames_.empty()) {
+      Frame &frame = frames_.back();
+      if (!frame.visited) {
+        // The key without further replacements comes first. Indices
+        // of its path are kept for moving along the key later.
+        frame.visited = true;
+        BaseType index = frame.index;
+        path_.push_back(index);
+        while (frame.end < length_ && dic_->Follow(key_[frame.end], &index)) {
+          path_.push_back(index);
+          ++frame.end;
+        }
+        if (frame.end == length_ && IsKey(index)) {
+          result_.resize(frame.prefix_length);
+          result_.insert(result_.end(), key_ + frame.start, key_ + length_);
+          last_index_ = index;
+          return true;
+        }
+      }
+
+      if (frame.pos == length_) {
+        PopFrame();
+        continue;
+      }
+
+      // Tries the next rule at the position.
+      const CharType *s = key_ + frame.pos;
+      BaseType end = table_->end(static_cast<UCharType>(*s));
+      while (frame.rule < end &&
+             !table_->Matches(frame.rule, s, length_ - frame.pos)) {
+        ++frame.rule;
+      }
+      if (frame.rule < end) {
+        BaseType rule = frame.rule++;
+        BaseType index = path_[frame.path_begin + frame.pos - frame.start];
+        if (Follow(table_->target(rule), table_->target_length(rule),
+                   &index)) {
+          result_.resize(frame.prefix_length);
+          result_.insert(result_.end(), key_ + frame.start, s);
+          result_.insert(result_.end(), table_->target(rule),
+                         table_->target(rule) + table_->target_length(rule));
+          PushFrame(result_.size(), frame.pos + table_->source_length(rule),
+                    index);
+        }
+        continue;
+      }
+
+      // Moves to the next byte of the key.
+      if (frame.pos == frame.end) {
+        PopFrame();
+        continue;
+      }
+      ++frame.pos;
+      if (frame.pos < length_) {
+        frame.rule = table_->begin(static_cast<UCharType>(key_[frame.pos]));
+      }
+    }
+    return false;
+  }
+
+ private:
+  // A state of a search: a variant with replacements before start which
+  // follows the key from start to end. Indices of the path from start
+  // are in path_ from path_begin; pos is the current position and rule
+  // is the next rule to try there.
+  struct Frame {
+    SizeType prefix_length;
+    SizeType start;
+    SizeType end;
+    SizeType pos;
+    SizeType path_begin;
+    BaseType index;
+    BaseType rule;
+    bool visited;
+  };
+
+  const DictionaryType *dic_;
+  const ReplaceTable *table_;
+  UCharType separator_;
+  const char *key_;
+  SizeType length_;
+  std::vector<char> result_;
+  std::vector<Frame> frames_;
+  std::vector<BaseType> path_;
+  BaseType last_index_;
+
+  // Disallows copies.
+  SimilarCompleter(const SimilarCompleter &);
+  SimilarCompleter &operator=(const SimilarCompleter &);
+
+  void PushFrame(SizeType prefix_length, SizeType start, BaseType index) {
+    Frame frame;
+    frame.prefix_length = prefix_length;
+    frame.start = start;
+    frame.end = start;
+    frame.pos = start;
+    frame.path_begin = path_.size();
+    frame.index = index;
+    frame.rule = (start < length_) ?
+        table_->begin(static_cast<UCharType>(key_[start])) : 0;
+    frame.visited = false;
+    frames_.push_back(frame);
+  }
+
+  void PopFrame() {
+    path_.resize(frames_.back().path_begin);
+    frames_.pop_back();
+  }
+
+  bool Follow(const CharType *s, SizeType length, BaseType *index) const {
+    for (SizeType i = 0; i < length; ++i) {
+      if (!dic_->Follow(s[i], index)) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  bool IsKey(BaseType index) const {
+    if (separator_ == '\0') {
+      return dic_->has_value(index);
+    }
+    return dic_->Follow(static_cast<CharType>(separator_), &index);
+  }
+};
+
+}  // namespace dawgdic
+
+#endif  // DAWGDIC_SIMILAR_COMPLETER_H
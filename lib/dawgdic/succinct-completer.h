@@ -0,0 +1,109 @@
+#ifndef DAWGDIC_SUCCINCT_COMPLETER_H
+#define DAWGDIC_SUCCINCT_COMPLETER_H
+
+#include <string>
+#include <vector>
+
+#include "succinct-dawg.h"
+
+namespace dawgdic {
+
+// Completer for SuccinctDawg. Keys are enumerated in lexicographic order
+// by a depth-first traversal with an explicit stack.
+class SuccinctCompleter {
+ public:
+  SuccinctCompleter()
+    : dawg_(NULL), key_(), stack_(), value_(0), is_started_(false) {}
+  explicit SuccinctCompleter(const SuccinctDawg &dawg)
+    : dawg_(&dawg), key_(), stack_(), value_(0), is_started_(false) {}
+
+  void set_dawg(const SuccinctDawg &dawg) {
+    dawg_ = &dawg;
+  }
+
+  const SuccinctDawg &dawg() const {
+    return *dawg_;
+  }
+
+  // These member functions are available only when Next() returns true.
+  const char *key() const {
+    return key_.c_str();
+  }
+  SizeType length() const {
+    return key_.length();
+  }
+  ValueType value() const {
+    return value_;
+  }
+
+  // Starts completing keys from a given state and prefix.
+  void Start(BaseType state, const char *prefix = "") {
+    Start(state, prefix, std::char_traits<char>::length(prefix));
+  }
+  void Start(BaseType state, const char *prefix, SizeType length) {
+    key_.assign(prefix, length);
+    stack_.clear();
+    PushState(state);
+    is_started_ = false;
+  }
+
+  // Gets the next key.
+  bool Next() {
+    if (stack_.empty()) {
+      return false;
+    }
+    if (!is_started_) {
+      is_started_ = true;
+      BaseType state = stack_.back().state;
+      if (dawg_->has_value(state)) {
+        value_ = dawg_->value(state);
+        return true;
+      }
+    }
+
+    while (!stack_.empty()) {
+      Frame &frame = stack_.back();
+      if (frame.transition == frame.end) {
+        stack_.pop_back();
+        continue;
+      }
+      SizeType transition = frame.transition++;
+      key_.resize(frame.length);
+      key_ += static_cast<char>(dawg_->label(transition));
+
+      BaseType state = dawg_->target(transition);
+      PushState(state);
+      if (dawg_->has_value(state)) {
+        value_ = dawg_->value(state);
+        return true;
+      }
+    }
+    return false;
+  }
+
+ private:
+  struct Frame {
+    BaseType state;
+    SizeType transition;
+    SizeType end;
+    SizeType length;
+  };
+
+  const SuccinctDawg *dawg_;
+  std::string key_;
+  std::vector<Frame> stack_;
+  ValueType value_;
+  bool is_started_;
+
+  void PushState(BaseType state) {
+    Frame frame;
+    frame.state = state;
+    dawg_->GetTransitions(state, &frame.transition, &frame.end);
+    frame.length = key_.length();
+    stack_.push_back(frame);
+  }
+};
+
+}  // namespace dawgdic
+
+#endif  // DAWGDIC_SUCCINCT_COMPLETER_H
@@ -0,0 +1,84 @@
+#ifndef DAWGDIC_SUCCINCT_DAWG_BUILDER_H
+#define DAWGDIC_SUCCINCT_DAWG_BUILDER_H
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+#include "dawg.h"
+#include "succinct-dawg.h"
+
+namespace dawgdic {
+
+class SuccinctDawgBuilder {
+ public:
+  // Builds a succinct dawg from a dawg.
+  static bool Build(const Dawg &dawg, SuccinctDawg *succinct_dawg) {
+    SuccinctDawgBuilder builder(dawg);
+    return builder.BuildSuccinctDawg(succinct_dawg);
+  }
+
+ private:
+  const Dawg &dawg_;
+
+  // Disallows copies.
+  SuccinctDawgBuilder(const SuccinctDawgBuilder &);
+  SuccinctDawgBuilder &operator=(const SuccinctDawgBuilder &);
+
+  explicit SuccinctDawgBuilder(const Dawg &dawg) : dawg_(dawg) {}
+
+  bool BuildSuccinctDawg(SuccinctDawg *succinct_dawg) {
+    SuccinctDawg result;
+    std::vector<BaseType> targets;
+    std::vector<BaseType> values;
+
+    // A state of a dawg is identified by the index of its first
+    // transition; 0 is used for a root without transitions.
+    std::vector<BaseType> states;
+    std::vector<BaseType> state_ids(dawg_.size(), 0);
+    states.push_back((dawg_.size() != 0) ? dawg_.child(dawg_.root()) : 0);
+
+    std::vector<std::pair<UCharType, BaseType> > transitions;
+    for (SizeType i = 0; i < states.size(); ++i) {
+      bool has_value = false;
+      transitions.clear();
+      if (states[i] != 0) {
+        for (BaseType index = states[i]; index != 0;
+             index = dawg_.sibling(index)) {
+          if (dawg_.is_leaf(index)) {
+            has_value = true;
+            values.push_back(static_cast<BaseType>(dawg_.value(index)));
+          } else {
+            transitions.push_back(std::make_pair(dawg_.label(index),
+                                                 dawg_.child(index)));
+          }
+        }
+      }
+      std::sort(transitions.begin(), transitions.end());
+
+      for (SizeType j = 0; j < transitions.size(); ++j) {
+        BaseType child = transitions[j].second;
+        if (child == 0 || child >= state_ids.size()) {
+          return false;
+        }
+        bool is_new = state_ids[child] == 0;
+        if (is_new) {
+          state_ids[child] = static_cast<BaseType>(states.size());
+          states.push_back(child);
+        } else {
+          targets.push_back(state_ids[child]);
+        }
+        result.AppendTransition(transitions[j].first, is_new);
+      }
+      result.AppendState(has_value);
+    }
+
+    result.Build(targets, values);
+    succinct_dawg->Swap(&result);
+    return true;
+  }
+};
+
+}  // namespace dawgdic
+
+#endif  // DAWGDIC_SUCCINCT_DAWG_BUILDER_H
@@ -0,0 +1,398 @@
+#ifndef DAWGDIC_SUCCINCT_DAWG_H
+#define DAWGDIC_SUCCINCT_DAWG_H
+
+#include <algorithm>
+#include <iostream>
+#include <vector>
+
+#include "base-types.h"
+#include "bit-vector.h"
+#include "packed-array.h"
+
+namespace dawgdic {
+
+// Succinct (LOUDS-based) representation of a minimized DAWG.
+//
+// States are numbered in BFS order. For each state, louds_ has 1s for its
+// transitions followed by a 0, and labels_ has labels of the transitions.
+// A transition to a state which is visited for the first time is marked
+// in is_new_ and its target is implicit (states are numbered in the order
+// of their visits); targets of other transitions are stored in targets_.
+// Values of states with keys are stored in values_.
+//
+// Labels are padded to a multiple of sizeof(BaseType) bytes in files, so
+// a dawg written by Write() can be mapped from memory.
+class SuccinctDawg {
+ public:
+  SuccinctDawg()
+    : louds_(), is_new_(), terminals_(), labels_(NULL), num_of_labels_(0),
+      targets_(), values_(), labels_buf_() {}
+
+  // The root state.
+  BaseType root() const {
+    return 0;
+  }
+
+  // Number of states.
+  SizeType num_of_states() const {
+    return terminals_.size();
+  }
+  // Number of transitions (not counting ends of keys).
+  SizeType num_of_transitions() const {
+    return num_of_labels_;
+  }
+  SizeType total_size() const {
+    return louds_.total_size() + is_new_.total_size() +
+        terminals_.total_size() + num_of_labels_ + targets_.total_size() +
+        values_.total_size();
+  }
+  // Number of bytes allocated for a dawg; mapped data is not counted.
+  SizeType heap_size() const {
+    return louds_.heap_size() + is_new_.heap_size() +
+        terminals_.heap_size() + labels_buf_.capacity() +
+        targets_.heap_size() + values_.heap_size();
+  }
+  SizeType file_size() const {
+    return louds_.file_size() + is_new_.file_size() +
+        terminals_.file_size() + sizeof(BaseType) +
+        LabelsFileSize(num_of_labels_) + targets_.file_size() +
+        values_.file_size();
+  }
+
+  // Checks if a key ends at a state or not.
+  bool has_value(BaseType state) const {
+    return terminals_[state];
+  }
+  // Gets a value of a key which ends at a state.
+  ValueType value(BaseType state) const {
+    return static_cast<ValueType>(values_[terminals_.Rank1(state)]);
+  }
+
+  // Gets a range of transitions of a state.
+  void GetTransitions(BaseType state, SizeType *begin, SizeType *end) const {
+    SizeType position = (state == 0) ? 0 : (louds_.Select0(state - 1) + 1);
+    *begin = position - state;
+    *end = louds_.NextZero(position) - state;
+  }
+  UCharType label(SizeType transition) const {
+    return labels_[transition];
+  }
+  BaseType target(SizeType transition) const {
+    SizeType num_of_new = is_new_.Rank1(transition);
+    if (is_new_[transition]) {
+      return static_cast<BaseType>(num_of_new + 1);
+    }
+    return targets_[transition - num_of_new];
+  }
+
+  // Checks if a given key exists or not.
+  bool Contains(const CharType *key) const {
+    BaseType state = root();
+    if (!Follow(key, &state)) {
+      return false;
+    }
+    return has_value(state);
+  }
+  bool Contains(const CharType *key, SizeType length) const {
+    BaseType state = root();
+    if (!Follow(key, length, &state)) {
+      return false;
+    }
+    return has_value(state);
+  }
+
+  // Finds a value from a key.
+  bool Find(const CharType *key, ValueType *value) const {
+    BaseType state = root();
+    if (!Follow(key, &state) || !has_value(state)) {
+      return false;
+    }
+    *value = this->value(state);
+    return true;
+  }
+  bool Find(const CharType *key, SizeType length, ValueType *value) const {
+    BaseType state = root();
+    if (!Follow(key, length, &state) || !has_value(state)) {
+      return false;
+    }
+    *value = this->value(state);
+    return true;
+  }
+
+  // Follows a transition.
+  bool Follow(CharType label, BaseType *state) const {
+    SizeType begin, end;
+    GetTransitions(*state, &begin, &end);
+    UCharType key = static_cast<UCharType>(label);
+
+    // Labels of transitions are sorted.
+    if (end - begin > LINEAR_SEARCH_LIMIT) {
+      begin = std::lower_bound(labels_ + begin, labels_ + end, key) - labels_;
+    }
+    for ( ; begin < end; ++begin) {
+      if (labels_[begin] == key) {
+        *state = target(begin);
+        return true;
+      } else if (labels_[begin] > key) {
+        break;
+      }
+    }
+    return false;
+  }
+
+  // Follows transitions.
+  bool Follow(const CharType *s, BaseType *state) const {
+    for ( ; *s != '\0'; ++s) {
+      if (!Follow(*s, state)) {
+        return false;
+      }
+    }
+    return true;
+  }
+  bool Follow(const CharType *s, BaseType *state, SizeType *count) const {
+    for ( ; *s != '\0'; ++s, ++*count) {
+      if (!Follow(*s, state)) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  // Follows transitions.
+  bool Follow(const CharType *s, SizeType length, BaseType *state) const {
+    for (SizeType i = 0; i < length; ++i) {
+      if (!Follow(s[i], state)) {
+        return false;
+      }
+    }
+    return true;
+  }
+  bool Follow(const CharType *s, SizeType length, BaseType *state,
+              SizeType *count) const {
+    for (SizeType i = 0; i < length; ++i, ++*count) {
+      if (!Follow(s[i], state)) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  // Reads a dawg from an input stream.
+  bool Read(std::istream *input) {
+    SuccinctDawg dawg;
+    if (!dawg.louds_.Read(input) || !dawg.is_new_.Read(input) ||
+        !dawg.terminals_.Read(input)) {
+      return false;
+    }
+
+    BaseType num_of_labels;
+    if (!input->read(reinterpret_cast<char *>(&num_of_labels),
+                     sizeof(BaseType))) {
+      return false;
+    }
+    if (num_of_labels != dawg.louds_.num_of_ones()) {
+      return false;
+    }
+    dawg.labels_buf_.resize(LabelsFileSize(num_of_labels));
+    if (!dawg.labels_buf_.empty() &&
+        !input->read(reinterpret_cast<char *>(&dawg.labels_buf_[0]),
+                     dawg.labels_buf_.size())) {
+      return false;
+    }
+    dawg.labels_buf_.resize(num_of_labels);
+    dawg.labels_ = dawg.labels_buf_.empty() ? NULL : &dawg.labels_buf_[0];
+    dawg.num_of_labels_ = num_of_labels;
+
+    if (!dawg.targets_.Read(input) || !dawg.values_.Read(input) ||
+        !dawg.IsValid()) {
+      return false;
+    }
+    Swap(&dawg);
+    return true;
+  }
+
+  // Maps a dawg written by Write(); address must be aligned to
+  // sizeof(BaseType). Parts of a dawg are checked as in Read(), so all
+  // data is read once.
+  bool Map(const void *address, SizeType size) {
+    if (size % sizeof(BaseType) != 0) {
+      return false;
+    }
+    const BaseType *p = static_cast<const BaseType *>(address);
+    const BaseType *end = p + size / sizeof(BaseType);
+
+    SuccinctDawg dawg;
+    if (!dawg.louds_.Map(&p, end) || !dawg.is_new_.Map(&p, end) ||
+        !dawg.terminals_.Map(&p, end) || p == end) {
+      return false;
+    }
+    SizeType num_of_labels = *p++;
+    if (num_of_labels != dawg.louds_.num_of_ones() ||
+        static_cast<SizeType>(end - p) * sizeof(BaseType) <
+        LabelsFileSize(num_of_labels)) {
+      return false;
+    }
+    dawg.labels_ = reinterpret_cast<const UCharType *>(p);
+    dawg.num_of_labels_ = num_of_labels;
+    p += LabelsFileSize(num_of_labels) / sizeof(BaseType);
+
+    if (!dawg.targets_.Map(&p, end) || !dawg.values_.Map(&p, end) ||
+        p != end || !dawg.IsValid()) {
+      return false;
+    }
+    Swap(&dawg);
+    return true;
+  }
+
+  // Writes a dawg to an output stream.
+  bool Write(std::ostream *output) const {
+    if (!louds_.Write(output) || !is_new_.Write(output) ||
+        !terminals_.Write(output)) {
+      return false;
+    }
+
+    BaseType num_of_labels = static_cast<BaseType>(num_of_labels_);
+    if (!output->write(reinterpret_cast<const char *>(&num_of_labels),
+                       sizeof(BaseType))) {
+      return false;
+    }
+    static const char padding[sizeof(BaseType)] = { '\0' };
+    if ((num_of_labels_ != 0 &&
+         !output->write(reinterpret_cast<const char *>(labels_),
+                        num_of_labels_)) ||
+        !output->write(padding,
+                       LabelsFileSize(num_of_labels_) - num_of_labels_)) {
+      return false;
+    }
+
+    return targets_.Write(output) && values_.Write(output);
+  }
+
+  // Initializes a dawg.
+  void Clear() {
+    louds_.Clear();
+    is_new_.Clear();
+    terminals_.Clear();
+    labels_ = NULL;
+    num_of_labels_ = 0;
+    targets_.Clear();
+    values_.Clear();
+    std::vector<UCharType>(0).swap(labels_buf_);
+  }
+
+  // Swaps dawgs.
+  void Swap(SuccinctDawg *dawg) {
+    louds_.Swap(&dawg->louds_);
+    is_new_.Swap(&dawg->is_new_);
+    terminals_.Swap(&dawg->terminals_);
+    std::swap(labels_, dawg->labels_);
+    std::swap(num_of_labels_, dawg->num_of_labels_);
+    targets_.Swap(&dawg->targets_);
+    values_.Swap(&dawg->values_);
+    labels_buf_.swap(dawg->labels_buf_);
+  }
+
+ public:
+  // Following member functions are called from SuccinctDawgBuilder.
+
+  // Appends transitions of a state and then the state itself. States
+  // must be appended in BFS order.
+  void AppendTransition(UCharType label, bool is_new) {
+    louds_.Append(true);
+    is_new_.Append(is_new);
+    labels_buf_.push_back(label);
+    labels_ = &labels_buf_[0];
+    num_of_labels_ = labels_buf_.size();
+  }
+  void AppendState(bool has_value) {
+    louds_.Append(false);
+    terminals_.Append(has_value);
+  }
+
+  // Builds indexes and packs targets and values.
+  void Build(const std::vector<BaseType> &targets,
+             const std::vector<BaseType> &values) {
+    louds_.Build();
+    is_new_.Build();
+    terminals_.Build();
+    targets_.Build(targets);
+    values_.Build(values);
+  }
+
+ private:
+  enum {
+    LINEAR_SEARCH_LIMIT = 8
+  };
+
+  BitVector louds_;
+  BitVector is_new_;
+  BitVector terminals_;
+  // Labels point to a buffer or to mapped memory.
+  const UCharType *labels_;
+  SizeType num_of_labels_;
+  PackedArray targets_;
+  PackedArray values_;
+  std::vector<UCharType> labels_buf_;
+
+  // Disallows copies.
+  SuccinctDawg(const SuccinctDawg &);
+  SuccinctDawg &operator=(const SuccinctDawg &);
+
+  // Labels are padded in files.
+  static SizeType LabelsFileSize(SizeType num_of_labels) {
+    return (num_of_labels + sizeof(BaseType) - 1) /
+        sizeof(BaseType) * sizeof(BaseType);
+  }
+
+  // Checks that parts of a dawg read from a stream are consistent.
+  bool IsValid() const {
+    if (terminals_.size() == 0 ||
+        louds_.num_of_zeros() != terminals_.size() ||
+        is_new_.size() != num_of_labels_ ||
+        is_new_.num_of_ones() + 1 != terminals_.size() ||
+        targets_.size() != is_new_.num_of_zeros() ||
+        values_.size() != terminals_.num_of_ones()) {
+      return false;
+    }
+    // The last bit of LOUDS ends the last state.
+    if (louds_[louds_.size() - 1]) {
+      return false;
+    }
+    for (SizeType i = 0; i < targets_.size(); ++i) {
+      if (targets_[i] == 0 || targets_[i] >= terminals_.size()) {
+        return false;
+      }
+    }
+    return IsAcyclic();
+  }
+
+  // Checks that states make a DAG, so that completion of keys ends.
+  // States are visited in topological order; states on a cycle are
+  // never visited.
+  bool IsAcyclic() const {
+    std::vector<BaseType> num_of_parents(num_of_states(), 0);
+    for (SizeType transition = 0; transition < num_of_labels_; ++transition) {
+      ++num_of_parents[target(transition)];
+    }
+    if (num_of_parents[root()] != 0) {
+      return false;
+    }
+
+    std::vector<BaseType> states(1, root());
+    for (SizeType i = 0; i < states.size(); ++i) {
+      SizeType begin, end;
+      GetTransitions(states[i], &begin, &end);
+      for ( ; begin < end; ++begin) {
+        BaseType child = target(begin);
+        if (--num_of_parents[child] == 0) {
+          states.push_back(child);
+        }
+      }
+    }
+    return states.size() == num_of_states();
+  }
+};
+
+}  // namespace dawgdic
+
+#endif  // DAWGDIC_SUCCINCT_DAWG_H
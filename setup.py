@@ -1,5 +1,6 @@
 #! /usr/bin/env python
 import glob
+import os
 from setuptools import setup, Extension
 
 setup(
@@ -17,6 +18,9 @@ setup(
             sources=glob.glob('src/*.cpp') + glob.glob('lib/b64/*.c'),
             include_dirs=['lib'],
             language="c++",
+            # DAWG_LOOKUP_STATS=1 builds the extension with lookup counters.
+            define_macros=[('DAWGDIC_LOOKUP_STATS', None)]
+            if os.environ.get('DAWG_LOOKUP_STATS') == '1' else [],
         )
     ],
 
@@ -19,6 +19,9 @@ cdef extern from "../lib/dawgdic/completer.h" namespace "dawgdic" nogil:
         SizeType length()
         ValueType value()
 
+        # Size of buffers in bytes.
+        SizeType total_size()
+
         # Starts completing keys from given index and prefix.
         void Start(BaseType index)
         void Start(BaseType index, char *prefix)
@@ -0,0 +1,74 @@
+from _base_types cimport BaseType, SizeType
+from _dictionary cimport Dictionary
+from _guide cimport Guide
+from _payload_table cimport PayloadTable
+from _succinct_dawg cimport SuccinctDawg
+from iostream cimport ostream
+
+cdef extern from "../lib/dawgdic/container.h" namespace "dawgdic":
+    cdef enum ContainerSectionId:
+        CONTAINER_DICTIONARY
+        CONTAINER_GUIDE
+        CONTAINER_RANKED_GUIDE
+        CONTAINER_VALUES
+        CONTAINER_METADATA
+        CONTAINER_SUCCINCT_DAWG
+        CONTAINER_MAX_SECTIONS
+
+    cdef cppclass ContainerHeader:
+        # Checks if data starts with a container header.
+        @staticmethod
+        bint HasMagic(const void *data, SizeType size) nogil
+
+    cdef cppclass ContainerWriter:
+        ContainerWriter(const char *class_tag) nogil
+        ContainerWriter(const char *class_tag, bint use_checksums) nogil
+        ContainerWriter(const char *class_tag, bint use_checksums, bint use_compression) nogil
+
+        # Sets data of a section; data is copied (and compressed).
+        void SetSection(SizeType id, const char *data, SizeType size) nogil except +
+        void SetSection(SizeType id, const char *data, SizeType size, SizeType element_size) nogil except +
+
+        # Writes a container to an output stream.
+        bint Write(ostream *output) nogil except +
+
+    cdef cppclass Container:
+        Container() nogil
+
+        # Opens a container file.
+        bint Open(const char *path) nogil except +
+        bint Open(const char *path, bint use_mmap) nogil except +
+
+        # Reads a container from memory; data is copied.
+        bint Load(const char *data, SizeType size) nogil except +
+
+        # Unmaps sections and frees memory.
+        void Close() nogil
+
+        const char *class_tag() nogil
+        BaseType version() nogil
+
+        bint has_section(SizeType id) nogil
+        bint has_checksum(SizeType id) nogil
+        bint is_compressed(SizeType id) nogil
+        SizeType section_size(SizeType id) nogil
+        bint is_mapped(SizeType id) nogil
+
+        # Numbers of bytes in memory, mapped and resident in physical memory.
+        SizeType heap_size() nogil
+        SizeType heap_size(SizeType id) nogil
+        SizeType mapped_size(SizeType id) nogil
+        SizeType resident_size(SizeType id) nogil
+
+        # Gets data of a section or NULL if there is no such section.
+        const char *section(SizeType id) nogil except +
+
+        # Verifies checksums.
+        bint VerifySection(SizeType id) nogil except +
+        bint VerifyAll() nogil except +
+
+        # Maps sections into objects.
+        bint Map(SizeType id, Dictionary *dic) nogil except +
+        bint Map(SizeType id, Guide *guide) nogil except +
+        bint Map(SizeType id, PayloadTable *table) nogil except +
+        bint Map(SizeType id, SuccinctDawg *dawg) nogil except +
@@ -26,6 +26,9 @@ cdef extern from "../lib/dawgdic/dawg.h" namespace "dawgdic":
         # Number of merging states.
         SizeType num_of_merging_states() nogil
 
+        # Size of allocated pools in bytes.
+        SizeType total_size() nogil
+
         # Reads values.
         BaseType child(BaseType index) nogil
 
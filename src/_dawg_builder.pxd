@@ -4,7 +4,9 @@ from _dawg cimport Dawg
 cdef extern from "../lib/dawgdic/dawg-builder.h" namespace "dawgdic":
     cdef cppclass DawgBuilder:
 
-        DawgBuilder() nogil  #(SizeType initial_hash_table_size = DEFAULT_INITIAL_HASH_TABLE_SIZE)
+        DawgBuilder() nogil
+        DawgBuilder(SizeType initial_hash_table_size) nogil
+        DawgBuilder(SizeType initial_hash_table_size, bint merges_states) nogil
 
         # Number of units.
         SizeType size() nogil
@@ -24,13 +26,24 @@ cdef extern from "../lib/dawgdic/dawg-builder.h" namespace "dawgdic":
         # Number of merging states.
         SizeType num_of_merging_states() nogil
 
+        # Size of pools, the hash table and stacks in bytes.
+        SizeType total_size() nogil
+
+        # Statistics of the last build.
+        SizeType num_of_expansions() nogil
+        SizeType hash_table_size() nogil
+        SizeType peak_total_size() nogil
+
         # Initializes a builder.
         void Clear() nogil
 
         # Inserts a key.
-        bint Insert(CharType *key)
-        bint Insert(CharType *key, ValueType value)
-        bint Insert(CharType *key, SizeType length, ValueType value)
+        bint Insert(CharType *key) nogil
+        bint Insert(CharType *key, ValueType value) nogil
+        bint Insert(CharType *key, SizeType length, ValueType value) nogil
 
         # Finishes building a dawg.
-        bint Finish(Dawg *dawg)
+        bint Finish(Dawg *dawg) nogil
+
+        # Builds a dawg of keys inserted so far without changing a builder.
+        bint Snapshot(Dawg *dawg) nogil
@@ -12,6 +12,12 @@ cdef extern from "../lib/dawgdic/dictionary.h" namespace "dawgdic":
         SizeType total_size() nogil
         SizeType file_size() nogil
 
+        # Size of units and tails which are not mapped.
+        SizeType heap_size() nogil
+
+        # Checks if unbranched paths are stored as tails.
+        bint has_tail() nogil
+
         # Root index.
         BaseType root() nogil
 
@@ -1,7 +1,24 @@
-from _base_types cimport BaseType
+from _base_types cimport BaseType, SizeType
 from _dawg cimport Dawg
 from _dictionary cimport Dictionary
+from _guide cimport Guide
 
 cdef extern from "../lib/dawgdic/dictionary-builder.h" namespace "dawgdic::DictionaryBuilder":
     cdef bint Build (Dawg &dawg, Dictionary *dic) nogil
+    cdef bint BuildWithTails (Dawg &dawg, Dictionary *dic) nogil
 
+    # Builds a dictionary and a guide at a time.
+    cdef bint Build (Dawg &dawg, Dictionary *dic, Guide *guide) nogil
+    cdef bint BuildWithTails (Dawg &dawg, Dictionary *dic, Guide *guide) nogil
+
+    # Also gets the number of unused units of a dictionary.
+    cdef bint Build (Dawg &dawg, Dictionary *dic, BaseType *num_of_unused_units) nogil
+    cdef bint BuildWithTails (Dawg &dawg, Dictionary *dic, BaseType *num_of_unused_units) nogil
+    cdef bint Build (Dawg &dawg, Dictionary *dic, Guide *guide, BaseType *num_of_unused_units) nogil
+    cdef bint BuildWithTails (Dawg &dawg, Dictionary *dic, Guide *guide, BaseType *num_of_unused_units) nogil
+
+    # Also gets the number of bytes used by buffers of the builder.
+    cdef bint Build (Dawg &dawg, Dictionary *dic, BaseType *num_of_unused_units, SizeType *peak_size) nogil
+    cdef bint BuildWithTails (Dawg &dawg, Dictionary *dic, BaseType *num_of_unused_units, SizeType *peak_size) nogil
+    cdef bint Build (Dawg &dawg, Dictionary *dic, Guide *guide, BaseType *num_of_unused_units, SizeType *peak_size) nogil
+    cdef bint BuildWithTails (Dawg &dawg, Dictionary *dic, Guide *guide, BaseType *num_of_unused_units, SizeType *peak_size) nogil
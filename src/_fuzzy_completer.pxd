@@ -0,0 +1,25 @@
+from _base_types cimport BaseType, SizeType, ValueType, UCharType
+from _dictionary cimport Dictionary
+from _guide cimport Guide
+
+cdef extern from "../lib/dawgdic/fuzzy-completer.h" namespace "dawgdic" nogil:
+    cdef cppclass FuzzyCompleter:
+        FuzzyCompleter()
+        FuzzyCompleter(Dictionary &dic, Guide &guide)
+
+        void set_dic(Dictionary &dic)
+        void set_guide(Guide &guide)
+        void set_separator(UCharType separator)
+
+        # These member functions are available only when Next() returns true.
+        char *key()
+        SizeType length()
+        BaseType index()
+        ValueType value()
+        SizeType distance()
+
+        # Starts completing keys within max_distance of a key.
+        void Start(char *key, SizeType length, SizeType max_distance)
+
+        # Gets the next key.
+        bint Next()
@@ -12,6 +12,9 @@ cdef extern from "../lib/dawgdic/guide.h" namespace "dawgdic":
         SizeType total_size()
         SizeType file_size()
 
+        # Size of units which are not mapped.
+        SizeType heap_size()
+
         # The root index.
         BaseType root()
 
@@ -0,0 +1,41 @@
+from _base_types cimport SizeType
+
+cdef extern from "../lib/dawgdic/lookup-stats.h":
+    # True if lookups are counted.
+    bint DAWGDIC_LOOKUP_STATS_ENABLED
+
+cdef extern from "../lib/dawgdic/lookup-stats.h" namespace "dawgdic" nogil:
+    cdef enum LookupKind:
+        LOOKUP_GET
+        LOOKUP_KEYS
+        LOOKUP_PREFIXES
+        LOOKUP_SIMILAR_KEYS
+        NUM_OF_LOOKUP_KINDS
+
+    cdef enum:
+        NUM_OF_BUCKETS "dawgdic::LookupCounters::NUM_OF_BUCKETS"
+
+    cdef struct LookupCounters:
+        unsigned long long num_of_calls
+        unsigned long long num_of_hits
+        unsigned long long num_of_misses
+        unsigned long long num_of_transitions
+        unsigned long long num_of_completions
+        unsigned long long latencies[NUM_OF_BUCKETS]
+
+    cdef cppclass LookupStats:
+        LookupStats()
+
+        # Current time in nanoseconds.
+        @staticmethod
+        unsigned long long Now()
+
+        # Records a lookup which started at start_time.
+        void Record(LookupKind kind, bint is_hit, SizeType num_of_transitions,
+                    SizeType num_of_completions, unsigned long long start_time)
+
+        # Gets counters of a kind summed over shards.
+        void Get(LookupKind kind, LookupCounters *result)
+
+        # Resets counters.
+        void Clear()
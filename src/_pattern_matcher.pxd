@@ -0,0 +1,37 @@
+from _base_types cimport BaseType, SizeType, ValueType, UCharType
+from _dictionary cimport Dictionary
+from _guide cimport Guide
+
+cdef extern from "../lib/dawgdic/pattern-matcher.h" namespace "dawgdic" nogil:
+    cdef cppclass PatternMatcher:
+        PatternMatcher()
+
+        # The trie of keys.
+        Dictionary &dic()
+
+        # Number of units.
+        SizeType size()
+
+        # Size of the trie and links in bytes.
+        SizeType total_size()
+
+        # Length of the longest key in bytes.
+        SizeType max_depth()
+
+        # The root index.
+        BaseType root()
+
+        # Moves from a state by a label, following failure links.
+        BaseType Next(BaseType index, UCharType label)
+
+        # Keys which end at a state (0 ends a chain).
+        BaseType output(BaseType index)
+        BaseType next_output(BaseType index)
+        SizeType depth(BaseType index)
+        ValueType value(BaseType index)
+
+        # Builds a matcher of keys of a dictionary with a guide.
+        bint Build(Dictionary &dic, Guide &guide)
+
+        # Initializes a matcher.
+        void Clear()
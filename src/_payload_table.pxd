@@ -0,0 +1,37 @@
+from _base_types cimport BaseType, SizeType
+from iostream cimport istream, ostream
+
+cdef extern from "../lib/dawgdic/payload-table.h" namespace "dawgdic":
+    cdef cppclass PayloadTable:
+
+        PayloadTable() nogil
+
+        # Number of payloads.
+        SizeType size() nogil
+        SizeType total_size() nogil
+        SizeType file_size() nogil
+
+        # Number of bytes which are not mapped.
+        SizeType heap_size() nogil
+
+        # Reads a payload.
+        const char *payload(BaseType id) nogil
+        SizeType payload_length(BaseType id) nogil
+
+        # Appends a payload and returns its ID.
+        BaseType Append(const char *payload, SizeType length) nogil
+
+        # Reads a table from an input stream.
+        bint Read(istream *input) nogil except +
+
+        # Writes a table to an output stream.
+        bint Write(ostream *output) nogil except +
+
+        # Maps memory written by Write().
+        void Map(void *address) nogil
+
+        # Initializes a table.
+        void Clear() nogil
+
+        # Swaps tables.
+        void Swap(PayloadTable *table) nogil
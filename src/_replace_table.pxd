@@ -0,0 +1,21 @@
+from _base_types cimport BaseType, SizeType, CharType, UCharType
+
+cdef extern from "../lib/dawgdic/replace-table.h" namespace "dawgdic" nogil:
+    cdef cppclass ReplaceTable:
+        ReplaceTable()
+
+        # Number of rules.
+        SizeType size()
+
+        # Size of rules, their strings and the index in bytes.
+        SizeType total_size()
+
+        # Adds a rule; rules are available after Build().
+        bint Add(CharType *source, SizeType source_length,
+                 CharType *target, SizeType target_length)
+
+        # Sorts rules and indexes them by first bytes of sources.
+        void Build()
+
+        # Initializes a table.
+        void Clear()
@@ -0,0 +1,21 @@
+from _base_types cimport BaseType, SizeType, UCharType
+from _replace_table cimport ReplaceTable
+
+cdef extern from "../lib/dawgdic/similar-completer.h" namespace "dawgdic" nogil:
+    cdef cppclass SimilarCompleter[DictionaryType]:
+        SimilarCompleter()
+
+        void set_dic(DictionaryType &dic)
+        void set_table(ReplaceTable &table)
+        void set_separator(UCharType separator)
+
+        # These member functions are available only when Next() returns true.
+        char *key()
+        SizeType length()
+        BaseType index()
+
+        # Starts finding variants of a key.
+        void Start(char *key, SizeType length)
+
+        # Gets the next variant.
+        bint Next()
@@ -0,0 +1,24 @@
+from _base_types cimport BaseType, SizeType, ValueType
+from _succinct_dawg cimport SuccinctDawg
+
+cdef extern from "../lib/dawgdic/succinct-completer.h" namespace "dawgdic" nogil:
+    cdef cppclass SuccinctCompleter:
+        SuccinctCompleter()
+        SuccinctCompleter(SuccinctDawg &dawg)
+
+        void set_dawg(SuccinctDawg &dawg)
+
+        SuccinctDawg &dawg()
+
+        # These member functions are available only when Next() returns true.
+        const char *key()
+        SizeType length()
+        ValueType value()
+
+        # Starts completing keys from given state and prefix.
+        void Start(BaseType state)
+        void Start(BaseType state, char *prefix)
+        void Start(BaseType state, char *prefix, SizeType length)
+
+        # Gets the next key.
+        bint Next()
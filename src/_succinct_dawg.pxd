@@ -0,0 +1,48 @@
+from _base_types cimport BaseType, SizeType, ValueType, CharType, UCharType
+from iostream cimport istream, ostream
+
+cdef extern from "../lib/dawgdic/succinct-dawg.h" namespace "dawgdic":
+    cdef cppclass SuccinctDawg:
+        SuccinctDawg()
+
+        # The root state.
+        BaseType root() nogil
+
+        # Number of states.
+        SizeType num_of_states() nogil
+
+        # Number of transitions.
+        SizeType num_of_transitions() nogil
+        SizeType total_size() nogil
+        SizeType heap_size() nogil
+        SizeType file_size() nogil
+
+        # Checks if a key ends at a state or not.
+        bint has_value(BaseType state) nogil
+
+        # Gets a value of a key which ends at a state.
+        ValueType value(BaseType state) nogil
+
+        # Checks if a given key exists or not.
+        bint Contains(CharType *key) nogil
+        bint Contains(CharType *key, SizeType length) nogil
+
+        # Finds a value from a key.
+        bint Find(CharType *key, ValueType *value) nogil
+        bint Find(CharType *key, SizeType length, ValueType *value) nogil
+
+        # Follows a transition.
+        bint Follow(CharType label, BaseType *state) nogil
+
+        # Follows transitions.
+        bint Follow(CharType *s, BaseType *state) nogil
+        bint Follow(CharType *s, SizeType length, BaseType *state) nogil
+
+        # Reads a dawg from an input stream.
+        bint Read(istream *input) nogil except +
+
+        # Writes a dawg to an output stream.
+        bint Write(ostream *output) nogil except +
+
+        # Initializes a dawg.
+        void Clear() nogil
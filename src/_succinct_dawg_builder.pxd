@@ -0,0 +1,5 @@
+from _dawg cimport Dawg
+from _succinct_dawg cimport SuccinctDawg
+
+cdef extern from "../lib/dawgdic/succinct-dawg-builder.h" namespace "dawgdic::SuccinctDawgBuilder":
+    cdef bint Build (Dawg &dawg, SuccinctDawg *succinct_dawg) nogil
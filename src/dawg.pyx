@@ -3,17 +3,35 @@
 from __future__ import unicode_literals
 from libcpp.string cimport string
 from libcpp.vector cimport vector
-from iostream cimport stringstream, istream, ostream, ifstream
+from libc.limits cimport INT_MAX
+from libc.string cimport memcmp, memcpy
+from cpython cimport array
+from cpython.unicode cimport PyUnicode_AsUTF8AndSize, PyUnicode_DecodeUTF8
+from iostream cimport stringstream, istream, ostream, ifstream, EOF
 cimport iostream
 
 cimport _dawg
 from _dawg_builder cimport DawgBuilder
 from _dictionary cimport Dictionary
+from _dictionary_unit cimport DictionaryUnit
 from _guide cimport Guide
+from _guide_unit cimport GuideUnit
 from _completer cimport Completer
-from _base_types cimport BaseType, SizeType, CharType
-cimport _guide_builder
+from _base_types cimport BaseType, SizeType, ValueType, CharType, UCharType
+from _payload_table cimport PayloadTable
+from _lookup_stats cimport (LookupStats, LookupCounters, LookupKind, NUM_OF_BUCKETS,
+    DAWGDIC_LOOKUP_STATS_ENABLED, LOOKUP_GET, LOOKUP_KEYS, LOOKUP_PREFIXES, LOOKUP_SIMILAR_KEYS)
+from _container cimport (Container, ContainerHeader, ContainerWriter,
+    CONTAINER_DICTIONARY, CONTAINER_GUIDE, CONTAINER_VALUES, CONTAINER_METADATA,
+    CONTAINER_SUCCINCT_DAWG, CONTAINER_MAX_SECTIONS)
+from _succinct_dawg cimport SuccinctDawg
+from _succinct_completer cimport SuccinctCompleter
+cimport _pattern_matcher
+from _fuzzy_completer cimport FuzzyCompleter
+from _replace_table cimport ReplaceTable
+from _similar_completer cimport SimilarCompleter
 cimport _dictionary_builder
+cimport _succinct_dawg_builder
 cimport b64_decode
 
 try:
@@ -21,63 +39,138 @@ try:
 except ImportError:
     # Python 2.7
     from collections import Mapping
+import array
+import json
 import struct
 import sys
+import threading
 from binascii import b2a_base64
+from timeit import default_timer
 
 
 class Error(Exception):
     pass
 
 
+# True if the extension is built with lookup counters
+# (DAWG_LOOKUP_STATS=1 environment variable for setup.py).
+LOOKUP_STATS = bool(DAWGDIC_LOOKUP_STATS_ENABLED)
+
+_LOOKUP_KINDS = (
+    ('get', LOOKUP_GET),
+    ('keys', LOOKUP_KEYS),
+    ('prefixes', LOOKUP_PREFIXES),
+    ('similar_keys', LOOKUP_SIMILAR_KEYS),
+)
+
+
 cdef class DAWG:
     """
     Base DAWG wrapper.
     """
     cdef Dictionary dct
     cdef _dawg.Dawg dawg
+    cdef Container* _container
+    cdef readonly dict build_stats
+    cdef LookupStats* _lookup_stats
 
-    def __init__(self, arg=None, input_is_sorted=False):
-        if arg is None:
-            arg = []
-        if not input_is_sorted:
-            arg = [
-                (<unicode>key).encode('utf8') if isinstance(key, unicode) else key
-                for key in arg
-            ]
-            arg.sort()
-        self._build_from_iterable(arg)
+    def __init__(self, arg=None, input_is_sorted=False, bint tails=False,
+                 SizeType initial_hash_table_size=0):
+        """
+        If ``tails`` is True then unbranched paths which end with keys
+        are stored as strings instead of double-array units; this makes
+        DAWGs with long unique suffixes (URLs, paths) much smaller.
 
-    def __dealloc__(self):
-        self.dct.Clear()
-        self.dawg.Clear()
+        ``initial_hash_table_size`` is a hint for the builder: its hash
+        table of DAWG states is not expanded while it is less than 3/4
+        full. For large key sets with a known number of states this
+        avoids rehashing during the build.
 
-    def _build_from_iterable(self, iterable):
-        cdef DawgBuilder dawg_builder
-        cdef bytes b_key
-        cdef int value
+        ``build_stats`` of a DAWG built from keys is a dict of counts,
+        sizes and times of build phases; it is None for other DAWGs.
+        """
+        cdef double start = default_timer()
+        keys = _sorted_keys(arg, input_is_sorted)
+        cdef double sort_time = default_timer() - start
 
-        for key in iterable:
-            if isinstance(key, tuple) or isinstance(key, list):
-                key, value = key
-                if value < 0:
-                    raise ValueError("Negative values are not supported")
-            else:
-                value = 0
+        self._build_from_iterable(keys, tails, initial_hash_table_size)
+        self.build_stats['sort_time'] = sort_time
 
-            if isinstance(key, unicode):
-                b_key = <bytes>(<unicode>key).encode('utf8')
-            else:
-                b_key = key
+    def __dealloc__(self):
+        self.dct.Clear()
+        self.dawg.Clear()
+        if self._container:
+            del self._container
+        if self._lookup_stats:
+            del self._lookup_stats
+
+    def _build_from_iterable(self, iterable, bint tails=False,
+                             SizeType initial_hash_table_size=0):
+        cdef dict stats = {}
+        _build_dawg(iterable, &self.dawg, initial_hash_table_size, stats)
+
+        cdef BaseType num_of_unused_units = 0
+        cdef SizeType dictionary_builder_peak_size = 0
+        cdef SizeType dawg_size = self.dawg.total_size()
+        cdef double start = default_timer()
+        if not self._build_dictionary(tails, &num_of_unused_units, &dictionary_builder_peak_size):
+            raise Error("Can't build dictionary")
+        stats['dictionary_time'] = default_timer() - start
+
+        # The dictionary is built while the DAWG is still in memory.
+        stats.update(
+            num_of_units=self.dct.size(),
+            num_of_unused_units=num_of_unused_units,
+            fill_ratio=1.0 - <double>num_of_unused_units / self.dct.size(),
+            dictionary_size=self.dct.total_size(),
+            dawg_size=dawg_size,
+            dictionary_builder_peak_size=dictionary_builder_peak_size,
+            build_peak_size=max(stats['dawg_builder_peak_size'],
+                                dawg_size + dictionary_builder_peak_size),
+        )
+        self.build_stats = stats
+
+    cdef bint _build_dictionary(self, bint tails, BaseType* num_of_unused_units=NULL,
+                                SizeType* peak_size=NULL) nogil:
+        # The DAWG is not needed after the dictionary is built.
+        cdef bint ok
+        if tails:
+            ok = _dictionary_builder.BuildWithTails(self.dawg, &self.dct, num_of_unused_units,
+                                                    peak_size)
+        else:
+            ok = _dictionary_builder.Build(self.dawg, &self.dct, num_of_unused_units, peak_size)
+        self.dawg.Clear()
+        return ok
 
-            if not dawg_builder.Insert(b_key, len(b_key), value):
-                raise Error("Can't insert key %r (with value %r)" % (b_key, value))
+    @staticmethod
+    def merge(a, b, conflict='first', op='union', bint tails=False):
+        """
+        Returns a new DAWG of the same class as ``a`` with keys of ``a``
+        and ``b`` merged by ``op``: 'union', 'intersection' (keys which
+        are in both DAWGs) or 'difference' (keys of ``a`` which are not
+        in ``b``).
 
-        if not dawg_builder.Finish(&self.dawg):
-            raise Error("dawg_builder.Finish error")
+        ``conflict`` chooses a value of a key which is in both DAWGs:
+        'first', 'second', 'min', 'max', 'sum' or a callable which gets
+        both values and returns a new one.
 
-        if not _dictionary_builder.Build(self.dawg, &self.dct):
+        Keys are enumerated in sorted order, so both DAWGs must be
+        ``CompletionDAWG`` or ``IntCompletionDAWG`` objects.
+        """
+        if (not isinstance(a, CompletionDAWG) or not isinstance(b, CompletionDAWG) or
+                isinstance(a, BytesDAWG) or isinstance(b, BytesDAWG)):
+            raise TypeError("Only CompletionDAWG and IntCompletionDAWG objects can be merged")
+        if op not in _MERGE_OPS:
+            raise ValueError("Unknown merge operation: %r" % (op,))
+        if not callable(conflict) and conflict not in _MERGE_CONFLICTS:
+            raise ValueError("Unknown conflict resolution: %r" % (conflict,))
+
+        # __new__ skips the build of an empty DAWG in __init__.
+        cdef DAWG res = type(a).__new__(type(a))
+        _merge_dawgs(a, b, _MERGE_OPS.index(op), conflict, &res.dawg)
+        if not res._build_dictionary(tails):
             raise Error("Can't build dictionary")
+        return res
 
     def __contains__(self, key):
         if isinstance(key, unicode):
@@ -85,10 +178,15 @@ cdef class DAWG:
         return self.b_has_key(key)
 
     cpdef bint has_key(self, unicode key) except -1:
-        return self.b_has_key(<bytes>key.encode('utf8'))
+        cdef Py_ssize_t length
+        cdef const char* c_key = _utf8(key, &length)
+        return self._has_key(c_key, length)
 
     cpdef bint b_has_key(self, bytes key) except -1:
-        return self.dct.Contains(key, len(key))
+        return self._has_key(key, len(key))
+
+    cdef bint _has_key(self, const char* key, SizeType length):
+        return self.dct.Contains(<CharType*>key, length)
 
     cpdef bytes tobytes(self) except +:
         """
@@ -107,10 +205,15 @@ cdef class DAWG:
         when loaded using ``.frombytes`` compared to DAWG loaded
         using ``.load``).
         """
+        if _is_container(data):
+            self._load_container_bytes(data)
+            return self
+
         cdef string s_data = data
         cdef stringstream* stream = new stringstream(s_data)
 
         try:
+            self.build_stats = None
             res = self.dct.Read(<istream *> stream)
 
             if not res:
@@ -129,11 +232,17 @@ cdef class DAWG:
         """
         self.frombytes(f.read())
 
-    def write(self, f):
+    def write(self, f, container=False, checksums=True, compress=False):
         """
         Write DAWG to a file-like object.
+
+        If ``container`` or ``compress`` is True DAWG is written
+        in a container format (see ``DAWG.save``).
         """
-        f.write(self.tobytes())
+        if container or compress:
+            f.write(self._container_bytes(checksums, compress))
+        else:
+            f.write(self.tobytes())
 
     def load(self, path):
         """
@@ -142,11 +251,16 @@ cdef class DAWG:
         if isinstance(path, unicode):
             path = path.encode(sys.getfilesystemencoding())
 
+        if _is_container_file(path):
+            self._load_container_file(path, False, True)
+            return self
+
         cdef ifstream stream
         stream.open(path, iostream.binary)
         if stream.fail():
             raise IOError("It's not possible to read file stream")
 
+        self.build_stats = None
         res = self.dct.Read(<istream*> &stream)
 
         stream.close()
@@ -157,12 +271,89 @@ cdef class DAWG:
 
         return self
 
-    def save(self, path):
+    def save(self, path, container=False, checksums=True, compress=False):
         """
         Save DAWG to a file.
+
+        If ``container`` is True DAWG is saved in a versioned container
+        format: a header stores DAWG class, unit size and page-aligned
+        offsets of sections (with CRC32C checksums if ``checksums``
+        is True), so the file can be opened with ``DAWG.mmap``.
+
+        If ``compress`` is True sections of a container are compressed;
+        such files are smaller, but they are decompressed on load.
         """
         with open(path, 'wb') as f:
-            self.write(f)
+            self.write(f, container, checksums, compress)
+
+    def mmap(self, path, verify=False):
+        """
+        Memory-map DAWG from a file saved with ``save(path, container=True)``.
+        Sections are used in place, without copying; the file must not be
+        changed while DAWG is in use.
+
+        Checksums are checked if ``verify`` is True; ``DAWG.verify``
+        may be used to check them later.
+        """
+        if isinstance(path, unicode):
+            path = path.encode(sys.getfilesystemencoding())
+
+        self._load_container_file(path, True, verify)
+        return self
+
+    def verify(self):
+        """
+        Check checksums of a DAWG loaded from a container.
+        Return False if the data is corrupted.
+        """
+        if self._container == NULL:
+            return True
+        return self._container.VerifyAll()
+
+    cdef bytes _container_bytes(self, bint checksums, bint compress):
+        cdef bytes class_tag = _container_class_tag(self).encode('ascii')
+        cdef ContainerWriter* writer = new ContainerWriter(class_tag, checksums, compress)
+        cdef stringstream stream
+
+        try:
+            self._write_sections(writer)
+            if not writer.Write(<ostream *> &stream):
+                raise IOError("Can't write DAWG container")
+        finally:
+            del writer
+
+        cdef bytes res = stream.str()
+        return res
+
+    cdef _load_container_file(self, bytes path, bint use_mmap, bint verify):
+        self._load_container(_open_container(path, use_mmap), verify)
+
+    cdef _load_container_bytes(self, bytes data):
+        self._load_container(_read_container(data), True)
+
+    cdef _load_container(self, Container* container, bint verify):
+        # Takes ownership of ``container``.
+        try:
+            _check_container(container, self, verify)
+            self.build_stats = None
+            self._map_sections(container)
+        except:
+            del container
+            raise
+
+        if self._container:
+            del self._container
+        self._container = container
+
+    cdef _write_sections(self, ContainerWriter *writer):
+        cdef stringstream stream
+        self.dct.Write(<ostream *> &stream)
+        _set_section(writer, CONTAINER_DICTIONARY, stream, sizeof(DictionaryUnit))
+
+    cdef _map_sections(self, Container *container):
+        if not container.Map(CONTAINER_DICTIONARY, &self.dct):
+            self.dct.Clear()
+            raise IOError("Invalid data format: can't map _dawg.Dictionary")
 
     # pickling support
     def __reduce__(self):
@@ -171,6 +362,41 @@ cdef class DAWG:
     def __setstate__(self, state):
         self.frombytes(state)
 
+    def memory_usage(self):
+        """
+        Returns memory used by this DAWG: a dict with numbers of bytes
+        allocated on the heap ('heap'), mapped from a file ('mapped'),
+        resident in physical memory ('resident': the heap and mapped
+        pages which are loaded now) and ``heap + mapped`` ('total').
+
+        'sections' breaks them down by buffers: 'dictionary', 'guide',
+        'payloads', 'completer', 'dawg' (the DAWG kept after a build),
+        'lookup_stats', 'container' (headers and metadata of a container
+        read into memory) and 'python' (Python objects).
+
+        'build_peak' is the peak number of bytes allocated by a build
+        (None if DAWG was loaded).
+        """
+        cdef dict sections = {}
+        self._add_memory_sections(sections)
+        _add_container_memory_section(sections, self._container)
+
+        build_peak = self.build_stats.get('build_peak_size') if self.build_stats else None
+        return _memory_usage(sections, build_peak)
+
+    cdef _add_memory_sections(self, dict sections):
+        sections['dictionary'] = _memory_section(self.dct.heap_size(), self._container,
+                                                 CONTAINER_DICTIONARY)
+        if self.dawg.total_size():
+            sections['dawg'] = _memory_section(self.dawg.total_size())
+        if self._lookup_stats:
+            sections['lookup_stats'] = _memory_section(sizeof(LookupStats))
+
+        python_size = sys.getsizeof(self)
+        if self.build_stats is not None:
+            python_size += sys.getsizeof(self.build_stats)
+        sections['python'] = _memory_section(python_size)
+
     # half-internal methods
     def _size(self):
         return self.dct.size()
@@ -184,73 +410,113 @@ cdef class DAWG:
     cdef bint _has_value(self, BaseType index):
         return  self.dct.has_value(index)
 
-    cdef list _similar_keys(self, unicode current_prefix, unicode key, BaseType cur_index, dict replace_chars):
-        cdef BaseType next_index, index = cur_index
-        cdef unicode prefix, u_replace_char, found_key
-        cdef bytes b_step, b_replace_char
-        cdef list res = []
-        cdef list extra_keys
-
-        cdef int start_pos = len(current_prefix)
-        cdef int end_pos = len(key)
-        cdef int word_pos = start_pos
-
-        while word_pos < end_pos:
-            b_step = <bytes>(key[word_pos].encode('utf8'))
-
-            if b_step in replace_chars:
-                next_index = index
-                b_replace_char, u_replace_char = <tuple>replace_chars[b_step]
-
-                if self.dct.Follow(b_replace_char, &next_index):
-                    prefix = current_prefix + key[start_pos:word_pos] + u_replace_char
-                    extra_keys = self._similar_keys(prefix, key, next_index, replace_chars)
-                    res.extend(extra_keys)
-
-            if not self.dct.Follow(b_step, &index):
-                break
-            word_pos += 1
-
-        else:
-            if self._has_value(index):
-                found_key = current_prefix + key[start_pos:]
-                res.insert(0, found_key)
-
+    def stats(self):
+        """
+        Returns counters of lookups of this DAWG: a dict which maps 'get',
+        'keys', 'prefixes' and 'similar_keys' to dicts of numbers of calls,
+        hits, misses, followed transitions, completed keys and a histogram
+        of latencies (the i-th item is the number of calls which took
+        [2**i, 2**(i+1)) nanoseconds).
+
+        Lookups are counted only if the extension is built with
+        DAWG_LOOKUP_STATS=1 (see ``dawg.LOOKUP_STATS``).
+        """
+        if not DAWGDIC_LOOKUP_STATS_ENABLED:
+            raise Error("The extension is built without lookup stats")
+
+        cdef LookupCounters counters
+        cdef dict res = {}
+        for name, kind in _LOOKUP_KINDS:
+            self._stats().Get(kind, &counters)
+            res[name] = {
+                'calls': counters.num_of_calls,
+                'hits': counters.num_of_hits,
+                'misses': counters.num_of_misses,
+                'transitions': counters.num_of_transitions,
+                'completions': counters.num_of_completions,
+                'latency_histogram': [counters.latencies[i] for i in range(NUM_OF_BUCKETS)],
+            }
         return res
 
-    cpdef list similar_keys(self, unicode key, dict replaces):
+    def reset_stats(self):
+        """
+        Resets counters of lookups.
+        """
+        if self._lookup_stats:
+            self._lookup_stats.Clear()
+
+    cdef LookupStats* _stats(self):
+        if not self._lookup_stats:
+            self._lookup_stats = new LookupStats()
+        return self._lookup_stats
+
+    cdef _record_lookup(self, LookupKind kind, key, bint is_hit, SizeType num_of_completions,
+                        unsigned long long start_time):
+        # Called only if DAWGDIC_LOOKUP_STATS_ENABLED; transitions are
+        # counted by following ``key`` again, after the lookup is timed.
+        cdef LookupStats* stats = self._stats()
+        cdef unsigned long long end_time = LookupStats.Now()
+        cdef bytes b_key = key.encode('utf8') if isinstance(key, unicode) else key
+        cdef BaseType index = self.dct.root()
+        cdef SizeType num_of_transitions = 0
+        self.dct.Follow(b_key, len(b_key), &index, &num_of_transitions)
+        stats.Record(kind, is_hit, num_of_transitions, num_of_completions,
+                     start_time + LookupStats.Now() - end_time)
+
+    cpdef list similar_keys(self, unicode key, replaces):
         """
         Return all variants of ``key`` in this DAWG according to
-        ``replaces``.
+        ``replaces``: the key itself (if it is in this DAWG) comes first,
+        then variants with replacements from left to right.
 
         ``replaces`` is an object obtained from
         ``DAWG.compile_replaces(mapping)`` where mapping is a dict
-        that maps single-char unicode sitrings to another single-char
-        unicode strings.
+        that maps unicode strings to another unicode strings.
 
         This may be useful e.g. for handling single-character umlauts.
         """
-        return self._similar_keys("", key, self.dct.root(), replaces)
+        cdef unsigned long long start_time = 0
+        if DAWGDIC_LOOKUP_STATS_ENABLED:
+            start_time = LookupStats.Now()
+
+        cdef list res = _similar_keys(self.dct, key, _compiled_replaces(replaces),
+                                      self._key_separator(), NULL)
+
+        if DAWGDIC_LOOKUP_STATS_ENABLED:
+            self._record_lookup(LOOKUP_SIMILAR_KEYS, key, bool(res), len(res), start_time)
+        return res
 
     cpdef list prefixes(self, unicode key):
         '''
         Return a list with keys of this DAWG that are prefixes of the ``key``.
         '''
-        return [p.decode('utf8') for p in self.b_prefixes(<bytes>key.encode('utf8'))]
+        cdef Py_ssize_t length
+        cdef const char* c_key = _utf8(key, &length)
+        return self._prefixes(key, c_key, length, True)
 
     cpdef list b_prefixes(self, bytes b_key):
+        return self._prefixes(b_key, b_key, len(b_key), False)
+
+    cdef list _prefixes(self, key, const char* c_key, SizeType length, bint decode):
+        # Prefixes are made from c_key (the data of ``key``) directly.
         cdef list res = []
         cdef BaseType index = self.dct.root()
-        cdef int pos = 1
-        cdef CharType ch
+        cdef SizeType pos
+        cdef unsigned long long start_time = 0
+        if DAWGDIC_LOOKUP_STATS_ENABLED:
+            start_time = LookupStats.Now()
 
-        for ch in b_key:
-            if not self.dct.Follow(ch, &index):
+        for pos in range(length):
+            if not self.dct.Follow(c_key[pos], &index):
                 break
             if self._has_value(index):
-                res.append(b_key[:pos])
-            pos += 1
+                if decode:
+                    res.append(PyUnicode_DecodeUTF8(c_key, pos + 1, NULL))
+                else:
+                    res.append(c_key[:pos + 1])
 
+        if DAWGDIC_LOOKUP_STATS_ENABLED:
+            self._record_lookup(LOOKUP_PREFIXES, key, bool(res), len(res), start_time)
         return res
 
     def iterprefixes(self, unicode key):
@@ -258,25 +524,76 @@ cdef class DAWG:
         Return a generator with keys of this DAWG that are prefixes of the ``key``.
         '''
         cdef BaseType index = self.dct.root()
-        cdef bytes b_key = <bytes>key.encode('utf8')
-        cdef int pos = 1
-        cdef CharType ch
+        cdef Py_ssize_t length
+        cdef const char* c_key = _utf8(key, &length)
+        cdef Py_ssize_t pos
 
-        for ch in b_key:
-            if not self.dct.Follow(ch, &index):
+        for pos in range(length):
+            if not self.dct.Follow(c_key[pos], &index):
                 return
             if self._has_value(index):
-                yield b_key[:pos].decode('utf8')
-            pos += 1
+                yield PyUnicode_DecodeUTF8(c_key, pos + 1, NULL)
+
+    def prefix_ends(self, key, bint values=False):
+        '''
+        Return a list with end positions of keys of this DAWG that are
+        prefixes of the ``key``: numbers of characters for unicode ``key``
+        and numbers of bytes for bytes ``key``. No substrings are created.
+
+        If ``values`` is True, a list of (end, value) tuples is returned.
+        '''
+        cdef unsigned long long start_time = 0
+        if DAWGDIC_LOOKUP_STATS_ENABLED:
+            start_time = LookupStats.Now()
+
+        cdef int separator = self._key_separator()
+        if values and separator != -1:
+            raise TypeError("Values of %s are not integers" % type(self).__name__)
+        cdef list res = _prefix_ends(self.dct, key, values, separator)
+
+        if DAWGDIC_LOOKUP_STATS_ENABLED:
+            self._record_lookup(LOOKUP_PREFIXES, key, bool(res), len(res), start_time)
+        return res
+
+    def prefix_ends_batch(self, keys, bint values=False):
+        '''
+        Return a list of ``prefix_ends(key, values)`` results for an
+        iterable of ``keys``; all keys are matched without the GIL.
+        '''
+        cdef int separator = self._key_separator()
+        if values and separator != -1:
+            raise TypeError("Values of %s are not integers" % type(self).__name__)
+        return _prefix_ends_batch(self.dct, keys, values, separator)
+
+    def segment(self, text, mode='longest'):
+        '''
+        Find keys of this DAWG in ``text`` and return an ``array('q')``
+        of their (start, end, value) spans, flattened. Positions are
+        numbers of characters for unicode ``text`` and numbers of bytes
+        for bytes ``text``; values are 0 for classes without integer values.
+
+        With ``mode='longest'`` the text is segmented greedily: the longest
+        key is taken from the start and the scan continues from its end
+        (or from the next character if no key matches). With ``mode='all'``
+        all keys from every position are returned.
+        '''
+        return _segment(self.dct, text, mode, self._key_separator())
+
+    cdef int _key_separator(self):
+        # Keys of a dictionary end with this byte (-1 if they don't).
+        return -1
 
     @classmethod
     def compile_replaces(cls, replaces):
-
+        """
+        Compile a dict which maps unicode strings (usually single
+        characters) to their replacements for ``similar_keys``.
+        """
         for k,v in replaces.items():
-            if len(k) != 1 or len(v) != 1:
-                raise ValueError("Keys and values must be single-char unicode strings.")
+            if len(k) == 0 or len(v) == 0:
+                raise ValueError("Keys and values must be non-empty unicode strings.")
 
-        return dict(
+        return CompiledReplaces(
             (
                 k.encode('utf8'),
                 (v.encode('utf8'), unicode(v))
@@ -285,41 +602,575 @@ cdef class DAWG:
         )
 
 
-cdef void init_completer(Completer& completer, Dictionary& dic, Guide& guide):
+cdef _sorted_keys(arg, bint input_is_sorted):
+    if arg is None:
+        arg = []
+    if not input_is_sorted:
+        arg = [
+            (<unicode>key).encode('utf8') if isinstance(key, unicode) else key
+            for key in arg
+        ]
+        arg.sort()
+    return arg
+
+
+cdef _build_dawg(iterable, _dawg.Dawg* dawg, SizeType initial_hash_table_size=0,
+                 dict stats=None):
+    cdef DawgBuilder* dawg_builder = new DawgBuilder(initial_hash_table_size)
+    cdef double start = default_timer()
+
+    try:
+        num_of_keys = _insert_keys(dawg_builder, iterable)
+
+        if not dawg_builder.Finish(dawg):
+            raise Error("dawg_builder.Finish error")
+
+        if stats is not None:
+            stats.update(
+                dawg_time=default_timer() - start,
+                dawg_builder_peak_size=dawg_builder.peak_total_size(),
+                num_of_keys=num_of_keys,
+                num_of_states=dawg.num_of_states(),
+                num_of_transitions=dawg.num_of_transitions(),
+                num_of_merged_transitions=dawg.num_of_merged_transitions(),
+                num_of_merged_states=dawg.num_of_merged_states(),
+                num_of_merging_states=dawg.num_of_merging_states(),
+                hash_table_size=dawg_builder.hash_table_size(),
+                num_of_hash_table_expansions=dawg_builder.num_of_expansions(),
+            )
+    finally:
+        del dawg_builder
+
+
+cdef Py_ssize_t _insert_keys(DawgBuilder* dawg_builder, iterable) except -1:
+    # Returns the number of inserted keys.
+    cdef bytes b_key
+    cdef int value
+    cdef Py_ssize_t num_of_keys = 0
+
+    for key in iterable:
+        if isinstance(key, tuple) or isinstance(key, list):
+            key, value = key
+            if value < 0:
+                raise ValueError("Negative values are not supported")
+        else:
+            value = 0
+
+        if isinstance(key, unicode):
+            b_key = <bytes>(<unicode>key).encode('utf8')
+        else:
+            b_key = key
+
+        if not dawg_builder.Insert(b_key, len(b_key), value):
+            raise Error("Can't insert key %r (with value %r)" % (b_key, value))
+        num_of_keys += 1
+
+    return num_of_keys
+
+
+cdef bint _is_container(bytes data):
+    return ContainerHeader.HasMagic(<char*>data, len(data))
+
+
+cdef bint _is_container_file(bytes path) except -1:
+    with open(path, 'rb') as f:
+        return _is_container(f.read(8))
+
+
+cdef Container* _open_container(bytes path, bint use_mmap) except NULL:
+    cdef Container* container = new Container()
+    if not container.Open(path, use_mmap):
+        del container
+        raise IOError("Invalid data format: can't open DAWG container")
+    return container
+
+
+cdef Container* _read_container(bytes data) except NULL:
+    cdef Container* container = new Container()
+    if not container.Load(data, len(data)):
+        del container
+        raise IOError("Invalid data format: can't read DAWG container")
+    return container
+
+
+cdef _check_container(Container* container, dawg, bint verify):
+    class_tag = (<bytes>container.class_tag()).decode('ascii', 'replace')
+    expected_class_tag = _container_class_tag(dawg)
+    if class_tag != expected_class_tag:
+        raise IOError("Invalid data format: %s is stored, not %s" % (
+            class_tag, expected_class_tag))
+    if verify and not container.VerifyAll():
+        raise IOError("Invalid data format: checksum mismatch")
+
+
+cdef _set_section(ContainerWriter *writer, int section_id, stringstream& stream, size_t element_size):
+    cdef string data = stream.str()
+    writer.SetSection(section_id, data.c_str(), data.size(), element_size)
+
+
+cdef _container_class_tag(dawg):
+    # User subclasses are stored as the nearest DAWG class.
+    for cls in type(dawg).__mro__:
+        if cls in _CONTAINER_CLASSES:
+            return cls.__name__
+    raise TypeError("%r is not a DAWG" % dawg)
+
+
+cdef dict _memory_section(SizeType heap_size, Container* container=NULL, int section_id=0):
+    # Buffers of an object and its section of a container.
+    cdef dict res = {'heap': heap_size, 'mapped': 0, 'resident': heap_size}
+    if container != NULL:
+        res['heap'] += container.heap_size(section_id)
+        res['mapped'] = container.mapped_size(section_id)
+        res['resident'] += container.heap_size(section_id) + container.resident_size(section_id)
+    return res
+
+
+cdef _add_container_memory_section(dict sections, Container* container):
+    # Headers and metadata of a container read into memory.
+    cdef SizeType heap_size
+    cdef SizeType section_id
+    if container == NULL:
+        return
+    heap_size = container.heap_size()
+    for section_id in range(CONTAINER_MAX_SECTIONS):
+        heap_size -= container.heap_size(section_id)
+    if heap_size:
+        sections['container'] = _memory_section(heap_size)
+
+
+cdef dict _memory_usage(dict sections, build_peak):
+    cdef dict res = {'heap': 0, 'mapped': 0, 'resident': 0}
+    for section in sections.values():
+        for name in res:
+            res[name] += section[name]
+    res.update(total=res['heap'] + res['mapped'], sections=sections, build_peak=build_peak)
+    return res
+
+
+ctypedef fused PrefixDictionary:
+    Dictionary
+    SuccinctDawg
+
+
+cdef void _find_prefix_ends(PrefixDictionary& dct, const char* key, SizeType length, bint count_chars,
+                            int separator, vector[SizeType]* ends,
+                            vector[ValueType]* values) nogil:
+    # Appends ends of keys which are prefixes of ``key``: numbers of bytes
+    # or, if count_chars is True, of UTF-8 characters (bytes which are not
+    # continuation bytes). If separator is not -1 a prefix is a key if it
+    # is followed by the separator.
+    cdef BaseType index = dct.root()
+    cdef BaseType separator_index
+    cdef SizeType pos, end = 0
+    for pos in range(length):
+        if not dct.Follow(key[pos], &index):
+            return
+        if not count_chars or (<UCharType>key[pos] & 0xC0) != 0x80:
+            end += 1
+
+        if separator != -1:
+            separator_index = index
+            if dct.Follow(<CharType>separator, &separator_index):
+                ends.push_back(end)
+                if values != NULL:
+                    values.push_back(0)
+        elif dct.has_value(index):
+            ends.push_back(end)
+            if values != NULL:
+                values.push_back(dct.value(index))
+
+
+cdef list _prefix_ends(PrefixDictionary& dct, key, bint values, int separator):
+    # A single key is matched with the GIL held: releasing it would take
+    # longer than the match.
+    cdef Py_ssize_t length
+    cdef const char* c_key = _key_utf8(key, &length)
+    cdef vector[SizeType] ends
+    cdef vector[ValueType] c_values
+    _find_prefix_ends(dct, c_key, length, isinstance(key, unicode), separator,
+                      &ends, &c_values if values else NULL)
+
+    cdef SizeType i
+    if values:
+        return [(ends[i], c_values[i]) for i in range(ends.size())]
+    return ends
+
+
+cdef list _prefix_ends_batch(PrefixDictionary& dct, keys, bint values, int separator):
+    cdef list key_list = list(keys)
+    cdef vector[const char*] c_keys
+    cdef vector[SizeType] lengths
+    cdef vector[bint] count_chars
+    cdef Py_ssize_t length
+    cdef SizeType i, j
+    for key in key_list:
+        c_keys.push_back(_key_utf8(key, &length))
+        lengths.push_back(length)
+        count_chars.push_back(isinstance(key, unicode))
+
+    # Ends (and values) of all keys; offsets[i] is where ends of the
+    # i-th key start.
+    cdef vector[SizeType] ends
+    cdef vector[ValueType] c_values
+    cdef vector[SizeType] offsets
+    with nogil:
+        for i in range(c_keys.size()):
+            offsets.push_back(ends.size())
+            _find_prefix_ends(dct, c_keys[i], lengths[i], count_chars[i], separator,
+                              &ends, &c_values if values else NULL)
+        offsets.push_back(ends.size())
+
+    cdef list res = []
+    for i in range(c_keys.size()):
+        if values:
+            res.append([(ends[j], c_values[j]) for j in range(offsets[i], offsets[i + 1])])
+        else:
+            res.append([ends[j] for j in range(offsets[i], offsets[i + 1])])
+    return res
+
+
+_SEGMENT_MODES = ('longest', 'all')
+cdef array.array _SPANS_TEMPLATE = array.array('q')
+
+
+cdef void _find_spans(PrefixDictionary& dct, const char* text, SizeType length, bint count_chars,
+                      bint longest, int separator, vector[long long]* spans) nogil:
+    # Appends (start, end, value) of keys found in ``text`` from every start
+    # (a character if count_chars is True, a byte otherwise). If longest is
+    # True only the longest key from a start is taken and the next start
+    # is its end.
+    cdef vector[SizeType] ends
+    cdef vector[ValueType] values
+    cdef SizeType start = 0, start_pos = 0, i, end_pos
+    while start < length:
+        ends.clear()
+        values.clear()
+        _find_prefix_ends(dct, text + start, length - start, count_chars, separator,
+                          &ends, &values)
+
+        for i in range(ends.size()):
+            if longest and i + 1 != ends.size():
+                continue
+            spans.push_back(start_pos)
+            spans.push_back(start_pos + ends[i])
+            spans.push_back(values[i])
+
+        end_pos = start_pos + (ends.back() if longest and not ends.empty() else 1)
+        while start < length and start_pos < end_pos:
+            start += 1
+            if not count_chars or start == length or (<UCharType>text[start] & 0xC0) != 0x80:
+                start_pos += 1
+
+
+cdef array.array _segment(PrefixDictionary& dct, text, mode, int separator):
+    if mode not in _SEGMENT_MODES:
+        raise ValueError("Unknown segmentation mode: %r" % (mode,))
+
+    cdef Py_ssize_t length
+    cdef const char* c_text = _key_utf8(text, &length)
+    cdef bint count_chars = isinstance(text, unicode)
+    cdef bint longest = mode == 'longest'
+    cdef vector[long long] spans
+    with nogil:
+        _find_spans(dct, c_text, length, count_chars, longest, separator, &spans)
+
+    cdef array.array res = array.clone(_SPANS_TEMPLATE, spans.size(), False)
+    if not spans.empty():
+        memcpy(res.data.as_voidptr, &spans[0], spans.size() * sizeof(long long))
+    return res
+
+
+cdef class CompiledReplaces(dict):
+    """
+    Replacements made by ``DAWG.compile_replaces``: a dict which maps
+    utf8-encoded strings to (utf8-encoded replacement, replacement)
+    tuples, with a native table of the same rules.
+    """
+    cdef ReplaceTable table
+
+    def __init__(self, replaces=()):
+        dict.__init__(self, replaces)
+        cdef bytes source, target
+        for source, value in self.items():
+            target = value[0]
+            if not self.table.Add(source, len(source), target, len(target)):
+                raise ValueError("Keys and values must be non-empty strings.")
+        self.table.Build()
+
+    def __reduce__(self):
+        return self.__class__, (dict(self),)
+
+
+cdef CompiledReplaces _compiled_replaces(replaces):
+    # Dicts in the format of compile_replaces are compiled on each call.
+    if isinstance(replaces, CompiledReplaces):
+        return <CompiledReplaces>replaces
+    return CompiledReplaces(replaces)
+
+
+cdef list _similar_keys(PrefixDictionary& dct, unicode key, CompiledReplaces replaces,
+                        int separator, vector[BaseType]* indices):
+    # Returns variants of ``key`` which are keys of a dictionary; if
+    # indices is not NULL, indices of their ends are appended to it.
+    cdef Py_ssize_t length
+    cdef const char* c_key = _utf8(key, &length)
+    cdef SimilarCompleter[PrefixDictionary] completer
+    cdef list res = []
+
+    completer.set_dic(dct)
+    completer.set_table(replaces.table)
+    if separator != -1:
+        completer.set_separator(<UCharType>separator)
+    completer.Start(c_key, length)
+
+    while completer.Next():
+        res.append(PyUnicode_DecodeUTF8(completer.key(), completer.length(), NULL))
+        if indices != NULL:
+            indices.push_back(completer.index())
+    return res
+
+
+cdef void init_completer(Completer& completer, Dictionary& dic, Guide& guide) nogil:
     completer.set_dic(dic)
     completer.set_guide(guide)
 
 
+_MERGE_OPS = ('union', 'intersection', 'difference')
+_MERGE_CONFLICTS = ('first', 'second', 'min', 'max', 'sum')
+
+cdef enum:
+    MERGE_UNION
+    MERGE_INTERSECTION
+    MERGE_DIFFERENCE
+
+
+cdef int _compare_keys(const char* a, SizeType a_length, const char* b, SizeType b_length) nogil:
+    cdef int res = memcmp(a, b, min(a_length, b_length))
+    if res != 0:
+        return res
+    return (a_length > b_length) - (a_length < b_length)
+
+
+cdef int _merge_values(int a, int b, conflict) except? -1:
+    if conflict == 'first':
+        return a
+    elif conflict == 'second':
+        return b
+    elif conflict == 'min':
+        return min(a, b)
+    elif conflict == 'max':
+        return max(a, b)
+    elif conflict == 'sum':
+        # Values are not negative, so a sum can only be too large.
+        if <long long>a + b > INT_MAX:
+            raise OverflowError("Sum of values %d and %d is too large" % (a, b))
+        return a + b
+    return conflict(a, b)
+
+
+cdef _merge_dawgs(CompletionDAWG a, CompletionDAWG b, int op, conflict, _dawg.Dawg* dawg):
+    # Keys of both DAWGs are enumerated in sorted order, as in a merge
+    # step of merge sort, and go straight into a builder.
+    cdef Completer completer_a, completer_b
+    cdef DawgBuilder dawg_builder
+    cdef Completer* completer
+    cdef bint has_a, has_b, ok
+    cdef int order, value
+
+    init_completer(completer_a, a.dct, a.guide)
+    init_completer(completer_b, b.dct, b.guide)
+    completer_a.Start(a.dct.root())
+    completer_b.Start(b.dct.root())
+    has_a = completer_a.Next()
+    has_b = completer_b.Next()
+
+    while has_a or has_b:
+        if not has_b:
+            order = -1
+        elif not has_a:
+            order = 1
+        else:
+            order = _compare_keys(completer_a.key(), completer_a.length(),
+                                  completer_b.key(), completer_b.length())
+
+        completer = NULL
+        if order < 0:
+            if op != MERGE_INTERSECTION:
+                completer = &completer_a
+                value = completer_a.value()
+        elif order > 0:
+            if op == MERGE_UNION:
+                completer = &completer_b
+                value = completer_b.value()
+        elif op != MERGE_DIFFERENCE:
+            completer = &completer_a
+            value = _merge_values(completer_a.value(), completer_b.value(), conflict)
+            if value < 0:
+                raise ValueError("Negative values are not supported")
+
+        if completer != NULL:
+            ok = dawg_builder.Insert(completer.key(), completer.length(), value)
+            if not ok:
+                raise Error("Can't insert key %r" % completer.key()[:completer.length()])
+
+        if order <= 0:
+            has_a = completer_a.Next()
+        if order >= 0:
+            has_b = completer_b.Next()
+
+    if not dawg_builder.Finish(dawg):
+        raise Error("dawg_builder.Finish error")
+
+
+cdef bint _build_subdawg(CompletionDAWG dawg, BaseType index, const char* prefix,
+                         SizeType prefix_length, bint strip_prefix, _dawg.Dawg* res) nogil:
+    # Keys below a node are completed in sorted order, so they go
+    # straight into a builder.
+    cdef Completer completer
+    cdef DawgBuilder dawg_builder
+
+    init_completer(completer, dawg.dct, dawg.guide)
+    if strip_prefix:
+        completer.Start(index)
+    else:
+        completer.Start(index, <char*>prefix, prefix_length)
+
+    while completer.Next():
+        if completer.length() == 0:
+            continue
+        if not dawg_builder.Insert(completer.key(), completer.length(), completer.value()):
+            return False
+
+    return dawg_builder.Finish(res)
+
+
+cdef void _find_all(_pattern_matcher.PatternMatcher& matcher, const char* text, SizeType length,
+                    bint count_chars, vector[long long]* spans) nogil:
+    # Appends (start, end, value) of all keys which end at each byte of
+    # ``text``. Numbers of characters before the last max_depth() bytes
+    # are kept in a ring buffer to get starts of keys in characters.
+    cdef SizeType mask = 1
+    cdef vector[SizeType] char_pos
+    cdef BaseType index = matcher.root(), output
+    cdef SizeType i, start, pos = 0
+
+    while mask <= matcher.max_depth():
+        mask <<= 1
+    if count_chars:
+        char_pos.resize(mask)
+    mask -= 1
+
+    for i in range(length):
+        if count_chars:
+            char_pos[i & mask] = pos
+            if (<UCharType>text[i] & 0xC0) != 0x80:
+                pos += 1
+        index = matcher.Next(index, <UCharType>text[i])
+
+        output = matcher.output(index)
+        while output != 0:
+            start = i + 1 - matcher.depth(output)
+            if count_chars:
+                spans.push_back(char_pos[start & mask])
+                spans.push_back(pos)
+            else:
+                spans.push_back(start)
+                spans.push_back(i + 1)
+            spans.push_back(matcher.value(output))
+            output = matcher.next_output(output)
+
+
+cdef class Matcher:
+    """
+    Aho-Corasick automaton of keys of a ``CompletionDAWG``, made by
+    ``CompletionDAWG.build_matcher``. It doesn't refer to the DAWG.
+    """
+    cdef _pattern_matcher.PatternMatcher matcher
+
+    def __dealloc__(self):
+        self.matcher.Clear()
+
+    def find_all(self, text):
+        '''
+        Find all keys in ``text`` in a single pass and return an
+        ``array('q')`` of their (start, end, value) spans, flattened.
+        Spans are ordered by ends, longer keys first; positions are
+        numbers of characters for unicode ``text`` and numbers of bytes
+        for bytes ``text``. The text is scanned without the GIL.
+        '''
+        cdef Py_ssize_t length
+        cdef const char* c_text = _key_utf8(text, &length)
+        cdef bint count_chars = isinstance(text, unicode)
+        cdef vector[long long] spans
+        with nogil:
+            _find_all(self.matcher, c_text, length, count_chars, &spans)
+
+        cdef array.array res = array.clone(_SPANS_TEMPLATE, spans.size(), False)
+        if not spans.empty():
+            memcpy(res.data.as_voidptr, &spans[0], spans.size() * sizeof(long long))
+        return res
+
+    def _size(self):
+        return self.matcher.size()
+
+    def _total_size(self):
+        return self.matcher.total_size()
+
+
+cdef enum:
+    FUZZY_KEYS
+    FUZZY_DISTANCES
+    FUZZY_ITEMS
+
+
 cdef class CompletionDAWG(DAWG):
     """
     DAWG with key completion support.
     """
     cdef Guide guide
 
-    def __init__(self, arg=None, input_is_sorted=False):
-        super(CompletionDAWG, self).__init__(arg, input_is_sorted)
-        if not _guide_builder.Build(self.dawg, self.dct, &self.guide):
-            raise Error("Error building completion information")
+    cdef bint _build_dictionary(self, bint tails, BaseType* num_of_unused_units=NULL,
+                                SizeType* peak_size=NULL) nogil:
+        # The guide is built in the same pass as the dictionary.
+        cdef bint ok
+        if tails:
+            ok = _dictionary_builder.BuildWithTails(self.dawg, &self.dct, &self.guide,
+                                                    num_of_unused_units, peak_size)
+        else:
+            ok = _dictionary_builder.Build(self.dawg, &self.dct, &self.guide,
+                                           num_of_unused_units, peak_size)
+        self.dawg.Clear()
+        return ok
 
     def __dealloc__(self):
         self.guide.Clear()
 
+    cdef _add_memory_sections(self, dict sections):
+        DAWG._add_memory_sections(self, sections)
+        sections['guide'] = _memory_section(self.guide.heap_size(), self._container,
+                                            CONTAINER_GUIDE)
+
     cpdef list keys(self, unicode prefix=""):
+        cdef unsigned long long start_time = 0
+        if DAWGDIC_LOOKUP_STATS_ENABLED:
+            start_time = LookupStats.Now()
+
         cdef bytes b_prefix = prefix.encode('utf8')
         cdef BaseType index = self.dct.root()
         cdef list res = []
-
-        if not self.dct.Follow(b_prefix, &index):
-            return res
-
         cdef Completer completer
-        init_completer(completer, self.dct, self.guide)
-        completer.Start(index, b_prefix)
 
-        while completer.Next():
-            key = (<char*>completer.key()).decode('utf8')
-            res.append(key)
+        if self.dct.Follow(b_prefix, &index):
+            init_completer(completer, self.dct, self.guide)
+            completer.Start(index, b_prefix)
+
+            while completer.Next():
+                key = (<char*>completer.key()).decode('utf8')
+                res.append(key)
 
+        if DAWGDIC_LOOKUP_STATS_ENABLED:
+            self._record_lookup(LOOKUP_KEYS, b_prefix, bool(res), len(res), start_time)
         return res
 
     def iterkeys(self, unicode prefix=""):
@@ -350,6 +1201,101 @@ cdef class CompletionDAWG(DAWG):
 
         return completer.Next()
 
+    def subdawg(self, unicode prefix, bint strip_prefix=False, bint tails=False):
+        """
+        Returns a new DAWG of the same class with keys which start with
+        ``prefix`` and their values. If ``strip_prefix`` is True then
+        ``prefix`` is removed from the keys; ``prefix`` itself would become
+        an empty key, so it is left out.
+        """
+        if isinstance(self, BytesDAWG):
+            raise TypeError("BytesDAWG and RecordDAWG objects can't be split")
+
+        cdef bytes b_prefix = prefix.encode('utf8')
+        cdef BaseType index = self.dct.root()
+        cdef SizeType prefix_length = len(b_prefix)
+        cdef const char* c_prefix = b_prefix
+        cdef CompletionDAWG res
+        cdef bint ok
+
+        if not self.dct.Follow(b_prefix, &index):
+            return type(self)()
+
+        res = type(self).__new__(type(self))
+
+        with nogil:
+            ok = _build_subdawg(self, index, c_prefix, prefix_length, strip_prefix, &res.dawg)
+            if ok:
+                ok = res._build_dictionary(tails)
+        if not ok:
+            raise Error("Can't build dictionary")
+        return res
+
+    def fuzzy_keys(self, unicode key, SizeType max_distance, bint distances=False):
+        """
+        Return a list of keys of this DAWG within Levenshtein distance
+        ``max_distance`` of ``key`` (insertions, deletions and substitutions
+        of characters) in the order of keys.
+
+        If ``distances`` is True, a list of (key, distance) tuples is returned.
+        """
+        return self._fuzzy(key, max_distance, FUZZY_DISTANCES if distances else FUZZY_KEYS)
+
+    cdef list _fuzzy(self, unicode key, SizeType max_distance, int kind):
+        # Keys are enumerated by a DFS over the guide; subtrees which are
+        # farther than max_distance from the key are skipped.
+        cdef unsigned long long start_time = 0
+        if DAWGDIC_LOOKUP_STATS_ENABLED:
+            start_time = LookupStats.Now()
+
+        cdef Py_ssize_t length
+        cdef const char* c_key = _utf8(key, &length)
+        cdef int separator = self._key_separator()
+        cdef FuzzyCompleter completer
+        cdef unicode found_key
+        cdef list res = []
+
+        completer.set_dic(self.dct)
+        completer.set_guide(self.guide)
+        if separator != -1:
+            completer.set_separator(<UCharType>separator)
+        completer.Start(c_key, length, max_distance)
+
+        while completer.Next():
+            found_key = PyUnicode_DecodeUTF8(completer.key(), completer.length(), NULL)
+            if kind == FUZZY_KEYS:
+                res.append(found_key)
+            elif kind == FUZZY_DISTANCES:
+                res.append((found_key, completer.distance()))
+            else:
+                res.append((found_key, self._value_at(completer.index())))
+
+        if DAWGDIC_LOOKUP_STATS_ENABLED:
+            self._record_lookup(LOOKUP_SIMILAR_KEYS, key, bool(res), len(res), start_time)
+        return res
+
+    cdef _value_at(self, BaseType index):
+        # A value of a key which ends at ``index``.
+        return self.dct.value(index)
+
+    def build_matcher(self):
+        """
+        Return a ``Matcher`` which finds all keys of this DAWG in a text
+        in a single pass. States of a DAWG are shared by different
+        prefixes, so keys are unfolded into a trie with failure links;
+        it is usually several times larger than the DAWG.
+        """
+        if self._key_separator() != -1:
+            raise TypeError("Can't build a matcher of %s" % type(self).__name__)
+
+        cdef Matcher res = Matcher()
+        cdef bint ok
+        with nogil:
+            ok = res.matcher.Build(self.dct, self.guide)
+        if not ok:
+            raise Error("Can't build matcher")
+        return res
+
     cpdef bytes tobytes(self) except +:
         """
         Return raw DAWG content as bytes.
@@ -357,6 +1303,7 @@ cdef class CompletionDAWG(DAWG):
         cdef stringstream stream
         self.dct.Write(<ostream *> &stream)
         self.guide.Write(<ostream *> &stream)
+        self._write_extra(<ostream *> &stream)
         cdef bytes res = stream.str()
         return res
 
@@ -367,11 +1314,16 @@ cdef class CompletionDAWG(DAWG):
         FIXME: it seems there is memory leak here (DAWG uses 3x memory when
         loaded using frombytes vs load).
         """
+        if _is_container(data):
+            self._load_container_bytes(data)
+            return self
+
         cdef char* c_data = data
         cdef stringstream stream
         stream.write(c_data, len(data))
         stream.seekg(0)
 
+        self.build_stats = None
         res = self.dct.Read(<istream*> &stream)
         if not res:
             self.dct.Clear()
@@ -383,6 +1335,13 @@ cdef class CompletionDAWG(DAWG):
             self.dct.Clear()
             raise IOError("Invalid data format: can't load _dawg.Guide")
 
+        try:
+            self._read_extra(<istream*> &stream)
+        except IOError:
+            self.guide.Clear()
+            self.dct.Clear()
+            raise
+
         return self
 
     def load(self, path):
@@ -392,12 +1351,17 @@ cdef class CompletionDAWG(DAWG):
         if isinstance(path, unicode):
             path = path.encode(sys.getfilesystemencoding())
 
+        if _is_container_file(path):
+            self._load_container_file(path, False, True)
+            return self
+
         cdef ifstream stream
         stream.open(path, iostream.binary)
         if stream.fail():
             raise IOError("It's not possible to read file stream")
 
         try:
+            self.build_stats = None
             res = self.dct.Read(<istream*> &stream)
             if not res:
                 self.dct.Clear()
@@ -409,11 +1373,46 @@ cdef class CompletionDAWG(DAWG):
                 self.dct.Clear()
                 raise IOError("Invalid data format: can't load _dawg.Guide")
 
+            try:
+                self._read_extra(<istream*> &stream)
+            except IOError:
+                self.guide.Clear()
+                self.dct.Clear()
+                raise
+
         finally:
             stream.close()
 
         return self
 
+    cdef _write_sections(self, ContainerWriter *writer):
+        DAWG._write_sections(self, writer)
+
+        cdef stringstream stream
+        self.guide.Write(<ostream *> &stream)
+        _set_section(writer, CONTAINER_GUIDE, stream, sizeof(GuideUnit))
+
+    cdef _map_sections(self, Container *container):
+        DAWG._map_sections(self, container)
+
+        if not container.Map(CONTAINER_GUIDE, &self.guide):
+            self.guide.Clear()
+            self.dct.Clear()
+            raise IOError("Invalid data format: can't map _dawg.Guide")
+
+    cdef _write_extra(self, ostream *stream):
+        """
+        Write data stored after the guide (if any) to ``stream``.
+        """
+        pass
+
+    cdef _read_extra(self, istream *stream):
+        """
+        Read data stored after the guide (if any) from ``stream``;
+        IOError should be raised if the data is invalid.
+        """
+        pass
+
     def _transitions(self):
         transitions = set()
         cdef BaseType index, prev_index, completer_index
@@ -455,6 +1454,9 @@ cdef class CompletionDAWG(DAWG):
 # chr(0).
 cdef bytes PAYLOAD_SEPARATOR = b'\x01'
 
+# Marks a table of interned payloads after the guide in a plain stream.
+cdef bytes PAYLOAD_TABLE_MARKER = b'DAWGPTBL'
+
 DEF MAX_VALUE_SIZE = 32768
 
 cdef class BytesDAWG(CompletionDAWG):
@@ -470,24 +1472,62 @@ cdef class BytesDAWG(CompletionDAWG):
     cdef CharType _c_payload_separator
     cdef Completer* _completer
 
-    def __init__(self, arg=None, input_is_sorted=False, bytes payload_separator=PAYLOAD_SEPARATOR):
+    cdef bint _intern_payloads
+    cdef PayloadTable _payload_table
+    cdef int _payload_id_size
+    cdef tuple _payloads
+    cdef dict _payload_ids
+
+    def __init__(self, arg=None, input_is_sorted=False, bytes payload_separator=PAYLOAD_SEPARATOR,
+                 bint intern_payloads=False, bint tails=False, SizeType initial_hash_table_size=0):
         """
         ``arg`` must be an iterable of tuples (unicode_key, bytes_payload).
+
+        If ``intern_payloads`` is True then each unique payload is stored
+        only once, in a separate table, and keys refer to it by ID. Saved
+        DAWGs record it, so it is not needed when loading the DAWG.
         """
         if arg is None:
             arg = []
 
         self._b_payload_separator = payload_separator
         self._c_payload_separator = <unsigned int>ord(payload_separator)
+        self._intern_payloads = intern_payloads
+
+        if intern_payloads:
+            arg = list(arg)
+            self._build_payload_table(sorted(set(d[1] for d in arg)))
 
         keys = (self._raw_key(d[0], d[1]) for d in arg)
-        super(BytesDAWG, self).__init__(keys, input_is_sorted)
+        super(BytesDAWG, self).__init__(keys, input_is_sorted, tails, initial_hash_table_size)
 
+        self._payload_ids = None
         self._update_completer()
 
     def __dealloc__(self):
         if self._completer:
             del self._completer
+        self._payload_table.Clear()
+
+    cdef _add_memory_sections(self, dict sections):
+        CompletionDAWG._add_memory_sections(self, sections)
+        if self._completer:
+            sections['completer'] = _memory_section(sizeof(Completer) + self._completer.total_size())
+        if self._intern_payloads:
+            sections['payloads'] = _memory_section(self._payload_table.heap_size(), self._container,
+                                                   CONTAINER_VALUES)
+
+        python_size = 0
+        if self._payloads is not None:
+            python_size += sys.getsizeof(self._payloads) + sum(sys.getsizeof(p) for p in self._payloads)
+        if self._payload_ids is not None:
+            python_size += sys.getsizeof(self._payload_ids)
+        sections['python']['heap'] += python_size
+        sections['python']['resident'] += python_size
+
+    def __reduce__(self):
+        args = (None, False, self._b_payload_separator, self._intern_payloads)
+        return self.__class__, args, self.tobytes()
 
     cpdef bytes _raw_key(self, unicode key, bytes payload):
         cdef bytes b_key = <bytes>key.encode('utf8')
@@ -495,7 +1535,11 @@ cdef class BytesDAWG(CompletionDAWG):
         if self._b_payload_separator in b_key:
             raise Error("Payload separator (%r) is found within utf8-encoded key ('%s')" % (self._b_payload_separator, key))
 
-        cdef bytes encoded_payload = b2a_base64(payload)
+        cdef bytes encoded_payload
+        if self._intern_payloads:
+            encoded_payload = self._encode_payload_id(self._payload_ids[payload])
+        else:
+            encoded_payload = b2a_base64(payload)
         return b_key + self._b_payload_separator + encoded_payload
 
     cdef _update_completer(self):
@@ -503,6 +1547,127 @@ cdef class BytesDAWG(CompletionDAWG):
             del self._completer
         self._completer = new Completer(self.dct, self.guide)
 
+    cdef _build_payload_table(self, list payloads):
+        cdef bytes payload
+
+        self._payload_table.Clear()
+        for payload in payloads:
+            self._payload_table.Append(payload, len(payload))
+
+        self._payload_ids = dict((payload, i) for i, payload in enumerate(payloads))
+        self._update_payloads()
+
+    cdef _update_payloads(self):
+        # Payload IDs are stored as fixed-size big-endian base-255 numbers
+        # with digits shifted by 1 (zero bytes are not allowed in keys);
+        # this preserves the order of payloads.
+        cdef SizeType num_of_payloads = self._payload_table.size()
+        cdef SizeType capacity = 255
+        cdef BaseType i
+        cdef list payloads = []
+
+        self._payload_id_size = 1
+        while capacity < num_of_payloads:
+            capacity *= 255
+            self._payload_id_size += 1
+
+        for i in range(num_of_payloads):
+            payloads.append(
+                self._payload_table.payload(i)[:self._payload_table.payload_length(i)]
+            )
+        self._payloads = tuple(payloads)
+
+    cdef bytes _encode_payload_id(self, BaseType payload_id):
+        cdef bytearray res = bytearray(self._payload_id_size)
+        cdef int i
+
+        for i in range(self._payload_id_size - 1, -1, -1):
+            res[i] = payload_id % 255 + 1
+            payload_id //= 255
+        return bytes(res)
+
+    cdef inline BaseType _decode_payload_id(self, const char* raw_id, int length):
+        cdef BaseType res = 0
+        cdef int i
+
+        for i in range(length):
+            res = res * 255 + (<UCharType>raw_id[i] - 1)
+        return res
+
+    cdef _write_extra(self, ostream *stream):
+        if self._intern_payloads:
+            stream.write(PAYLOAD_TABLE_MARKER, len(PAYLOAD_TABLE_MARKER))
+            self._payload_table.Write(stream)
+
+    cdef _read_extra(self, istream *stream):
+        # Interned payloads follow the guide after a marker; there is
+        # nothing after the guide otherwise.
+        cdef char marker[8]
+
+        self._payload_table.Clear()
+        if stream.peek() == EOF:
+            self._intern_payloads = False
+            self._update_payloads()
+            return
+
+        stream.read(marker, sizeof(marker))
+        if stream.fail() or marker[:sizeof(marker)] != PAYLOAD_TABLE_MARKER:
+            raise IOError("Invalid data format: unexpected data after _dawg.Guide")
+
+        if not self._payload_table.Read(stream):
+            self._payload_table.Clear()
+            raise IOError("Invalid data format: can't load _payload_table.PayloadTable")
+        self._intern_payloads = True
+        self._update_payloads()
+
+    cdef dict _container_metadata(self):
+        return {
+            'payload_separator': self._b_payload_separator.decode('latin1'),
+            'intern_payloads': bool(self._intern_payloads),
+        }
+
+    cdef _set_container_metadata(self, dict metadata):
+        payload_separator = metadata['payload_separator'].encode('latin1')
+        if len(payload_separator) != 1:
+            raise ValueError("Invalid payload separator: %r" % payload_separator)
+        self._b_payload_separator = payload_separator
+        self._c_payload_separator = <unsigned int>ord(payload_separator)
+        self._intern_payloads = metadata['intern_payloads']
+
+    cdef _write_sections(self, ContainerWriter *writer):
+        CompletionDAWG._write_sections(self, writer)
+
+        cdef bytes metadata = json.dumps(self._container_metadata(), sort_keys=True).encode('ascii')
+        writer.SetSection(CONTAINER_METADATA, metadata, len(metadata))
+
+        cdef stringstream stream
+        if self._intern_payloads:
+            self._payload_table.Write(<ostream *> &stream)
+            _set_section(writer, CONTAINER_VALUES, stream, 1)
+
+    cdef _map_sections(self, Container *container):
+        cdef const char* metadata = container.section(CONTAINER_METADATA)
+        if metadata == NULL:
+            raise IOError("Invalid data format: can't read metadata")
+        try:
+            self._set_container_metadata(json.loads(
+                metadata[:container.section_size(CONTAINER_METADATA)].decode('ascii')
+            ))
+        except (ValueError, KeyError, TypeError, AttributeError):
+            raise IOError("Invalid data format: can't parse metadata")
+
+        CompletionDAWG._map_sections(self, container)
+
+        self._payload_table.Clear()
+        if self._intern_payloads and not container.Map(CONTAINER_VALUES, &self._payload_table):
+            self._payload_table.Clear()
+            self.guide.Clear()
+            self.dct.Clear()
+            raise IOError("Invalid data format: can't map _payload_table.PayloadTable")
+
+        self._update_payloads()
+        self._update_completer()
+
     def load(self, path):
         res = super(BytesDAWG, self).load(path)
         self._update_completer()
@@ -513,9 +1678,12 @@ cdef class BytesDAWG(CompletionDAWG):
         self._update_completer()
         return res
 
-    cpdef bint b_has_key(self, bytes key) except -1:
+    cdef bint _has_key(self, const char* key, SizeType length):
         cdef BaseType index
-        return self._follow_key(key, &index)
+        return self._follow_key(key, length, &index)
+
+    cdef int _key_separator(self):
+        return self._c_payload_separator
 
     def __getitem__(self, key):
         res = self.get(key)
@@ -528,23 +1696,34 @@ cdef class BytesDAWG(CompletionDAWG):
         Return a list of payloads (as byte objects) for a given key
         or ``default`` if the key is not found.
         """
+        cdef unsigned long long start_time = 0
+        if DAWGDIC_LOOKUP_STATS_ENABLED:
+            start_time = LookupStats.Now()
+
         if isinstance(key, unicode):
             res = self.get_value(<unicode>key)
         else:
             res = self.b_get_value(key)
 
+        if DAWGDIC_LOOKUP_STATS_ENABLED:
+            self._record_lookup(LOOKUP_GET, key, bool(res), len(res), start_time)
         if not res:
             return default
         return res
 
-    cdef bint _follow_key(self, bytes key, BaseType* index):
+    cdef bint _follow_key(self, const char* key, SizeType length, BaseType* index):
         index[0] = self.dct.root()
-        if not self.dct.Follow(key, len(key), index):
+        if not self.dct.Follow(<CharType*>key, length, index):
             return False
         return self.dct.Follow(self._c_payload_separator, index)
 
     cpdef list get_value(self, unicode key):
-        return self.b_get_value(<bytes>key.encode('utf8'))
+        cdef Py_ssize_t length
+        cdef const char* c_key = _utf8(key, &length)
+        cdef BaseType index
+        if not self._follow_key(c_key, length, &index):
+            return []
+        return self._value_for_index(index)
 
     cdef list _value_for_index(self, BaseType index):
 
@@ -559,9 +1738,20 @@ cdef class BytesDAWG(CompletionDAWG):
         cdef b64_decode.decoder b64_decoder
         cdef char[MAX_VALUE_SIZE] b64_decoder_storage
         cdef vector[string] results
+        cdef list res
 
         self._completer.Start(index)
 
+        if self._intern_payloads:
+            # Interned payloads are shared bytes objects: there is
+            # nothing to decode or allocate.
+            res = []
+            while self._completer.Next():
+                res.append(self._payloads[
+                    self._decode_payload_id(self._completer.key(), self._completer.length())
+                ])
+            return res
+
         while self._completer.Next():
             b64_decoder.init()
             key_len = b64_decoder.decode(
@@ -569,13 +1759,13 @@ cdef class BytesDAWG(CompletionDAWG):
                 self._completer.length(),
                 b64_decoder_storage
             )
-            results.push_back(string(b64_decoder_storage, key_len))
+            results.push_back(string(<const char*>b64_decoder_storage, <size_t>key_len))
 
         return results
 
     cpdef list b_get_value(self, bytes key):
         cdef BaseType index
-        if not self._follow_key(key, &index):
+        if not self._follow_key(key, len(key), &index):
             return []
         return self._value_for_index(index)
 
@@ -610,9 +1800,12 @@ cdef class BytesDAWG(CompletionDAWG):
             raw_value = &(raw_key[i])
             raw_value_len = completer.length() - i
 
-            _b64_decoder.init()
-            _len = _b64_decoder.decode(raw_value, raw_value_len, _b64_decoder_storage)
-            value = _b64_decoder_storage[:_len]
+            if self._intern_payloads:
+                value = self._payloads[self._decode_payload_id(raw_value + 1, raw_value_len - 1)]
+            else:
+                _b64_decoder.init()
+                _len = _b64_decoder.decode(raw_value, raw_value_len, _b64_decoder_storage)
+                value = _b64_decoder_storage[:_len]
 
             u_key = raw_key[:i].decode('utf8')
             res.append(
@@ -651,36 +1844,44 @@ cdef class BytesDAWG(CompletionDAWG):
             raw_value = &(raw_key[i])
             raw_value_len = completer.length() - i
 
-            _b64_decoder.init()
-            _len = _b64_decoder.decode(raw_value, raw_value_len, _b64_decoder_storage)
-            value = _b64_decoder_storage[:_len]
+            if self._intern_payloads:
+                value = self._payloads[self._decode_payload_id(raw_value + 1, raw_value_len - 1)]
+            else:
+                _b64_decoder.init()
+                _len = _b64_decoder.decode(raw_value, raw_value_len, _b64_decoder_storage)
+                value = _b64_decoder_storage[:_len]
 
             u_key = raw_key[:i].decode('utf8')
             yield (u_key, value)
 
     cpdef list keys(self, unicode prefix=""):
+        cdef unsigned long long start_time = 0
+        if DAWGDIC_LOOKUP_STATS_ENABLED:
+            start_time = LookupStats.Now()
+
         cdef bytes b_prefix = prefix.encode('utf8')
         cdef int i
         cdef list res = []
         cdef char* raw_key
+        cdef Completer completer
 
         cdef BaseType index = self.dct.root()
-        if not self.dct.Follow(b_prefix, &index):
-            return res
+        if self.dct.Follow(b_prefix, &index):
+            init_completer(completer, self.dct, self.guide)
+            completer.Start(index, b_prefix)
 
-        cdef Completer completer
-        init_completer(completer, self.dct, self.guide)
-        completer.Start(index, b_prefix)
+            while completer.Next():
+                raw_key = <char*>completer.key()
 
-        while completer.Next():
-            raw_key = <char*>completer.key()
+                for i in range(0, completer.length()):
+                    if raw_key[i] == self._c_payload_separator:
+                        break
 
-            for i in range(0, completer.length()):
-                if raw_key[i] == self._c_payload_separator:
-                    break
+                u_key = raw_key[:i].decode('utf8')
+                res.append(u_key)
 
-            u_key = raw_key[:i].decode('utf8')
-            res.append(u_key)
+        if DAWGDIC_LOOKUP_STATS_ENABLED:
+            self._record_lookup(LOOKUP_KEYS, b_prefix, bool(res), len(res), start_time)
         return res
 
     def iterkeys(self, unicode prefix=""):
@@ -710,98 +1911,37 @@ cdef class BytesDAWG(CompletionDAWG):
         cdef BaseType _index = index
         return self.dct.Follow(self._c_payload_separator, &_index)
 
-    cdef list _similar_items(self, unicode current_prefix, unicode key, BaseType cur_index, dict replace_chars):
-        cdef BaseType next_index, index = cur_index
-        cdef unicode prefix, u_replace_char, found_key
-        cdef bytes b_step, b_replace_char
-        cdef list res = []
-        cdef list extra_items, value
-
-        cdef int start_pos = len(current_prefix)
-        cdef int end_pos = len(key)
-        cdef int word_pos = start_pos
-
-        while word_pos < end_pos:
-            b_step = <bytes>(key[word_pos].encode('utf8'))
-
-            if b_step in replace_chars:
-                next_index = index
-                b_replace_char, u_replace_char = <tuple>replace_chars[b_step]
-
-                if self.dct.Follow(b_replace_char, &next_index):
-                    prefix = current_prefix + key[start_pos:word_pos] + u_replace_char
-                    extra_items = self._similar_items(prefix, key, next_index, replace_chars)
-                    res.extend(extra_items)
-
-            if not self.dct.Follow(b_step, &index):
-                break
-            word_pos += 1
-
-        else:
-            if self.dct.Follow(self._c_payload_separator, &index):
-                found_key = current_prefix + key[start_pos:]
-                value = self._value_for_index(index)
-                res.insert(0, (found_key, value))
+    def fuzzy_items(self, unicode key, SizeType max_distance):
+        """
+        Return a list of (key, value) tuples for keys within Levenshtein
+        distance ``max_distance`` of ``key`` (see ``fuzzy_keys``).
+        """
+        return self._fuzzy(key, max_distance, FUZZY_ITEMS)
 
-        return res
+    cdef _value_at(self, BaseType index):
+        self.dct.Follow(self._c_payload_separator, &index)
+        return self._value_for_index(index)
 
-    cpdef list similar_items(self, unicode key, dict replaces):
+    cpdef list similar_items(self, unicode key, replaces):
         """
         Return a list of (key, value) tuples for all variants of ``key``
-        in this DAWG according to ``replaces``.
-
-        ``replaces`` is an object obtained from
-        ``DAWG.compile_replaces(mapping)`` where mapping is a dict
-        that maps single-char unicode sitrings to another single-char
-        unicode strings.
+        in this DAWG according to ``replaces`` (see ``DAWG.similar_keys``).
         """
-        return self._similar_items("", key, self.dct.root(), replaces)
+        cdef vector[BaseType] indices
+        cdef list keys = _similar_keys(self.dct, key, _compiled_replaces(replaces),
+                                       self._key_separator(), &indices)
+        cdef SizeType i
+        return [(keys[i], self._value_at(indices[i])) for i in range(indices.size())]
 
-    cdef list _similar_item_values(self, int start_pos, unicode key, BaseType cur_index, dict replace_chars):
-        cdef BaseType next_index, index = cur_index
-        cdef unicode prefix, u_replace_char, found_key
-        cdef bytes b_step, b_replace_char
-        cdef list res = []
-        cdef list extra_items, value
-
-        #cdef int start_pos = len(current_prefix)
-        cdef int end_pos = len(key)
-        cdef int word_pos = start_pos
-
-        while word_pos < end_pos:
-            b_step = <bytes>(key[word_pos].encode('utf8'))
-
-            if b_step in replace_chars:
-                next_index = index
-                b_replace_char, u_replace_char = <tuple>replace_chars[b_step]
-
-                if self.dct.Follow(b_replace_char, &next_index):
-                    extra_items = self._similar_item_values(word_pos+1, key, next_index, replace_chars)
-                    res.extend(extra_items)
-
-            if not self.dct.Follow(b_step, &index):
-                break
-            word_pos += 1
-
-        else:
-            if self.dct.Follow(self._c_payload_separator, &index):
-                value = self._value_for_index(index)
-                res.insert(0, value)
-
-        return res
-
-    cpdef list similar_item_values(self, unicode key, dict replaces):
+    cpdef list similar_item_values(self, unicode key, replaces):
         """
         Return a list of values for all variants of the ``key``
-        in this DAWG according to ``replaces``.
-
-        ``replaces`` is an object obtained from
-        ``DAWG.compile_replaces(mapping)`` where mapping is a dict
-        that maps single-char unicode sitrings to another single-char
-        unicode strings.
+        in this DAWG according to ``replaces`` (see ``DAWG.similar_keys``).
         """
-        return self._similar_item_values(0, key, self.dct.root(), replaces)
-
+        cdef vector[BaseType] indices
+        _similar_keys(self.dct, key, _compiled_replaces(replaces), self._key_separator(), &indices)
+        cdef SizeType i
+        return [self._value_at(indices[i]) for i in range(indices.size())]
 
 
 cdef class RecordDAWG(BytesDAWG):
@@ -821,7 +1961,8 @@ cdef class RecordDAWG(BytesDAWG):
     """
     cdef _struct
 
-    def __init__(self, fmt, arg=None, input_is_sorted=False, bytes payload_separator=PAYLOAD_SEPARATOR):
+    def __init__(self, fmt, arg=None, input_is_sorted=False, bytes payload_separator=PAYLOAD_SEPARATOR,
+                 bint intern_payloads=False, bint tails=False, SizeType initial_hash_table_size=0):
         """
         ``arg`` must be an iterable of tuples (unicode_key, data_tuple).
         data tuples will be converted to bytes with
@@ -837,7 +1978,21 @@ cdef class RecordDAWG(BytesDAWG):
             arg = []
 
         keys = ((d[0], self._struct.pack(*d[1])) for d in arg)
-        super(RecordDAWG, self).__init__(keys, input_is_sorted, payload_separator)
+        super(RecordDAWG, self).__init__(keys, input_is_sorted, payload_separator, intern_payloads, tails,
+                                         initial_hash_table_size)
+
+    def __reduce__(self):
+        args = (self._struct.format, None, False, self._b_payload_separator, self._intern_payloads)
+        return self.__class__, args, self.tobytes()
+
+    cdef dict _container_metadata(self):
+        cdef dict metadata = BytesDAWG._container_metadata(self)
+        metadata['fmt'] = self._struct.format
+        return metadata
+
+    cdef _set_container_metadata(self, dict metadata):
+        BytesDAWG._set_container_metadata(self, metadata)
+        self._struct = struct.Struct(str(metadata['fmt']))
 
     cdef list _value_for_index(self, BaseType index):
         cdef list value = BytesDAWG._value_for_index(self, index)
@@ -868,13 +2023,14 @@ cdef class IntDAWG(DAWG):
     Dict-like class based on DAWG.
     It can store integer values for unicode keys.
     """
-    def __init__(self, arg=None, input_is_sorted=False):
+    def __init__(self, arg=None, input_is_sorted=False, bint tails=False,
+                 SizeType initial_hash_table_size=0):
         """
         ``arg`` must be an iterable of tuples (unicode_key, int_value)
         or a dict {unicode_key: int_value}.
         """
         iterable = _iterable_from_argument(arg)
-        super(IntDAWG, self).__init__(iterable, input_is_sorted)
+        super(IntDAWG, self).__init__(iterable, input_is_sorted, tails, initial_hash_table_size)
 
     def __getitem__(self, key):
         cdef int res = self.get(key, LOOKUP_ERROR)
@@ -887,22 +2043,28 @@ cdef class IntDAWG(DAWG):
         Return value for the given key or ``default`` if the key is not found.
         """
         cdef int res
+        cdef unsigned long long start_time = 0
+        if DAWGDIC_LOOKUP_STATS_ENABLED:
+            start_time = LookupStats.Now()
 
         if isinstance(key, unicode):
             res = self.get_value(<unicode>key)
         else:
             res = self.b_get_value(key)
 
+        if DAWGDIC_LOOKUP_STATS_ENABLED:
+            self._record_lookup(LOOKUP_GET, key, res != LOOKUP_ERROR, res != LOOKUP_ERROR, start_time)
         if res == LOOKUP_ERROR:
             return default
         return res
 
     cpdef int get_value(self, unicode key):
-        cdef bytes b_key = <bytes>key.encode('utf8')
-        return self.dct.Find(b_key)
+        cdef Py_ssize_t length
+        cdef const char* c_key = _utf8(key, &length)
+        return self.dct.Find(<CharType*>c_key, length)
 
     cpdef int b_get_value(self, bytes key):
-        return self.dct.Find(key)
+        return self.dct.Find(key, len(key))
 
 
 # FIXME: code duplication.
@@ -912,13 +2074,14 @@ cdef class IntCompletionDAWG(CompletionDAWG):
     It can store integer values for unicode keys and support key completion.
     """
 
-    def __init__(self, arg=None, input_is_sorted=False):
+    def __init__(self, arg=None, input_is_sorted=False, bint tails=False,
+                 SizeType initial_hash_table_size=0):
         """
         ``arg`` must be an iterable of tuples (unicode_key, int_value)
         or a dict {unicode_key: int_value}.
         """
         iterable = _iterable_from_argument(arg)
-        super(IntCompletionDAWG, self).__init__(iterable, input_is_sorted)
+        super(IntCompletionDAWG, self).__init__(iterable, input_is_sorted, tails, initial_hash_table_size)
 
     def __getitem__(self, key):
         cdef int res = self.get(key, LOOKUP_ERROR)
@@ -931,22 +2094,35 @@ cdef class IntCompletionDAWG(CompletionDAWG):
         Return value for the given key or ``default`` if the key is not found.
         """
         cdef int res
+        cdef unsigned long long start_time = 0
+        if DAWGDIC_LOOKUP_STATS_ENABLED:
+            start_time = LookupStats.Now()
 
         if isinstance(key, unicode):
             res = self.get_value(<unicode>key)
         else:
             res = self.b_get_value(key)
 
+        if DAWGDIC_LOOKUP_STATS_ENABLED:
+            self._record_lookup(LOOKUP_GET, key, res != LOOKUP_ERROR, res != LOOKUP_ERROR, start_time)
         if res == LOOKUP_ERROR:
             return default
         return res
 
+    def fuzzy_items(self, unicode key, SizeType max_distance):
+        """
+        Return a list of (key, value) tuples for keys within Levenshtein
+        distance ``max_distance`` of ``key`` (see ``fuzzy_keys``).
+        """
+        return self._fuzzy(key, max_distance, FUZZY_ITEMS)
+
     cpdef int get_value(self, unicode key):
-        cdef bytes b_key = <bytes>key.encode('utf8')
-        return self.dct.Find(b_key)
+        cdef Py_ssize_t length
+        cdef const char* c_key = _utf8(key, &length)
+        return self.dct.Find(<CharType*>c_key, length)
 
     cpdef int b_get_value(self, bytes key):
-        return self.dct.Find(key)
+        return self.dct.Find(key, len(key))
 
     cpdef list items(self, unicode prefix=""):
         cdef bytes b_prefix = prefix.encode('utf8')
@@ -984,3 +2160,803 @@ cdef class IntCompletionDAWG(CompletionDAWG):
             key = (<char*>completer.key()).decode('utf8')
             value = completer.value()
             yield key, value
+
+
+cdef class DawgBuilderSession:
+    """
+    Builder which keeps keys between batches and makes DAWGs of keys
+    added so far.
+
+    Each batch passed to ``add_sorted`` must be sorted by utf8-encoded
+    keys, and its keys must not be less than keys of previous batches.
+    """
+    cdef DawgBuilder* _dawg_builder
+
+    def __cinit__(self, SizeType initial_hash_table_size=0):
+        self._dawg_builder = new DawgBuilder(initial_hash_table_size)
+
+    def __dealloc__(self):
+        del self._dawg_builder
+
+    def add_sorted(self, batch):
+        """
+        Adds keys (or ``(key, int_value)`` tuples) from a sorted iterable.
+
+        ``dawg.Error`` is raised on a key which is out of order; keys
+        before it stay added and the session can still be used.
+        """
+        _insert_keys(self._dawg_builder, batch)
+
+    def snapshot(self, cls=DAWG, bint tails=False):
+        """
+        Returns a new ``cls`` object with all keys added so far.
+
+        ``cls`` must be ``DAWG``, ``CompletionDAWG``, ``IntDAWG``,
+        ``IntCompletionDAWG`` or their subclass. The session is not
+        changed, so more batches can be added after a snapshot.
+        """
+        if not issubclass(cls, DAWG) or issubclass(cls, BytesDAWG):
+            raise TypeError("Can't make a snapshot as %r" % cls)
+
+        cdef DAWG res = cls.__new__(cls)
+        cdef bint ok
+        with nogil:
+            ok = self._dawg_builder.Snapshot(&res.dawg)
+        if not ok or not res._build_dictionary(tails):
+            raise Error("Can't build dictionary")
+        return res
+
+
+cdef object _DELETED = object()
+
+
+cdef bint _apply_overlay(CompletionDAWG base, vector[string]& keys, vector[int]& values,
+                         _dawg.Dawg* dawg) nogil:
+    # Keys of the base and the overlay are merged in sorted order; overlay
+    # entries replace base keys and negative values delete them.
+    cdef Completer completer
+    cdef DawgBuilder dawg_builder
+    cdef SizeType i = 0
+    cdef bint has_key
+    cdef int order
+
+    init_completer(completer, base.dct, base.guide)
+    completer.Start(base.dct.root())
+    has_key = completer.Next()
+
+    while has_key or i < keys.size():
+        if i == keys.size():
+            order = -1
+        elif not has_key:
+            order = 1
+        else:
+            order = _compare_keys(completer.key(), completer.length(),
+                                  keys[i].data(), keys[i].size())
+
+        if order < 0:
+            if not dawg_builder.Insert(completer.key(), completer.length(), completer.value()):
+                return False
+            has_key = completer.Next()
+            continue
+
+        if values[i] >= 0 and not dawg_builder.Insert(keys[i].data(), keys[i].size(), values[i]):
+            return False
+        if order == 0:
+            has_key = completer.Next()
+        i += 1
+
+    return dawg_builder.Finish(dawg)
+
+
+cdef class LayeredDAWG:
+    """
+    Immutable base DAWG with a small mutable overlay of added and deleted
+    keys.
+
+    The base must be a ``CompletionDAWG`` or ``IntCompletionDAWG`` (e.g.
+    loaded with ``mmap``); lookups check the overlay first, and ``compact``
+    merges the overlay into a new base.
+    """
+    cdef CompletionDAWG _base
+    cdef dict _overlay
+    cdef list _overlay_keys
+    cdef object _compact_lock
+
+    def __init__(self, base=None):
+        if base is None:
+            base = IntCompletionDAWG()
+        if not isinstance(base, CompletionDAWG) or isinstance(base, BytesDAWG):
+            raise TypeError("Base must be a CompletionDAWG or IntCompletionDAWG")
+        self._base = base
+        self._overlay = {}
+        self._overlay_keys = None
+        self._compact_lock = threading.Lock()
+
+    property base:
+        def __get__(self):
+            return self._base
+
+    property overlay_size:
+        """
+        Number of added and deleted keys which are not compacted yet.
+        """
+        def __get__(self):
+            return len(self._overlay)
+
+    def memory_usage(self):
+        """
+        Returns memory used by the base DAWG and the overlay ('overlay'
+        section); see ``DAWG.memory_usage``.
+        """
+        res = self._base.memory_usage()
+        overlay_size = sys.getsizeof(self._overlay) + sum(
+            sys.getsizeof(key) + (sys.getsizeof(value) if value is not _DELETED else 0)
+            for key, value in self._overlay.items())
+        if self._overlay_keys is not None:
+            overlay_size += sys.getsizeof(self._overlay_keys)
+        res['sections']['overlay'] = _memory_section(overlay_size)
+        return _memory_usage(res['sections'], res['build_peak'])
+
+    def __contains__(self, key):
+        if self._overlay:
+            value = self._overlay.get(_encode_key(key))
+            if value is not None:
+                return value is not _DELETED
+        cdef Py_ssize_t length
+        cdef const char* c_key = _key_utf8(key, &length)
+        return self._base.dct.Contains(<CharType*>c_key, length)
+
+    def __getitem__(self, key):
+        cdef int res
+        if self._overlay:
+            value = self._overlay.get(_encode_key(key))
+            if value is not None:
+                if value is _DELETED:
+                    raise KeyError(key)
+                return value
+        cdef Py_ssize_t length
+        cdef const char* c_key = _key_utf8(key, &length)
+        if not self._base.dct.Find(<CharType*>c_key, length, &res):
+            raise KeyError(key)
+        return res
+
+    def get(self, key, default=None):
+        """
+        Return value for the given key or ``default`` if the key is not found.
+        """
+        try:
+            return self[key]
+        except KeyError:
+            return default
+
+    def __setitem__(self, key, int value):
+        cdef bytes b_key = _encode_key(key)
+        if value < 0:
+            raise ValueError("Negative values are not supported")
+        if not b_key or b'\x00' in b_key:
+            raise Error("Can't insert key %r" % b_key)
+        self._set(b_key, value)
+
+    def add(self, key, int value=0):
+        """
+        Adds a key (or replaces its value).
+        """
+        self[key] = value
+
+    def __delitem__(self, key):
+        if key not in self:
+            raise KeyError(key)
+        self._set(_encode_key(key), _DELETED)
+
+    def discard(self, key):
+        """
+        Deletes a key if it exists.
+        """
+        if key in self:
+            self._set(_encode_key(key), _DELETED)
+
+    cdef _set(self, bytes b_key, value):
+        if b_key not in self._overlay:
+            self._overlay_keys = None
+        self._overlay[b_key] = value
+
+    def keys(self, unicode prefix=""):
+        return list(self.iterkeys(prefix))
+
+    def items(self, unicode prefix=""):
+        return list(self.iteritems(prefix))
+
+    def iterkeys(self, unicode prefix=""):
+        for key, value in self.iteritems(prefix):
+            yield key
+
+    def iteritems(self, unicode prefix=""):
+        """
+        Yields (key, value) pairs of keys which start with ``prefix``
+        in sorted order.
+        """
+        cdef bytes b_prefix = prefix.encode('utf8')
+        cdef list overlay_keys = self._sorted_overlay_keys()
+        cdef dict overlay = self._overlay
+        cdef Py_ssize_t i = _bisect_left(overlay_keys, b_prefix)
+        cdef CompletionDAWG base = self._base
+        cdef BaseType index = base.dct.root()
+        cdef Completer completer
+        cdef bint has_key = False
+        cdef bytes b_key
+        cdef int order
+
+        if base.dct.Follow(b_prefix, &index):
+            init_completer(completer, base.dct, base.guide)
+            completer.Start(index, b_prefix)
+            has_key = completer.Next()
+
+        while True:
+            if i < len(overlay_keys) and not (<bytes>overlay_keys[i]).startswith(b_prefix):
+                i = len(overlay_keys)
+            if i == len(overlay_keys):
+                if not has_key:
+                    break
+                order = -1
+            elif not has_key:
+                order = 1
+            else:
+                b_key = overlay_keys[i]
+                order = _compare_keys(completer.key(), completer.length(), b_key, len(b_key))
+
+            if order < 0:
+                yield (<char*>completer.key())[:completer.length()].decode('utf8'), completer.value()
+                has_key = completer.Next()
+                continue
+
+            b_key = overlay_keys[i]
+            value = overlay.get(b_key, _DELETED)
+            if value is not _DELETED:
+                yield b_key.decode('utf8'), value
+            if order == 0:
+                has_key = completer.Next()
+            i += 1
+
+    cdef list _sorted_overlay_keys(self):
+        if self._overlay_keys is None:
+            self._overlay_keys = sorted(self._overlay)
+        return self._overlay_keys
+
+    def compact(self, bint tails=False, bint background=False):
+        """
+        Builds a new base DAWG from the base and the overlay.
+
+        Lookups and updates may go on while the new base is built; the
+        base is replaced when it's ready, and overlay entries which
+        didn't change meanwhile are dropped. If ``background`` is True
+        the build runs in a new thread which is returned.
+        """
+        if not self._compact_lock.acquire(False):
+            raise Error("Compaction is already running")
+
+        base = self._base
+        overlay = dict(self._overlay)
+        if background:
+            thread = threading.Thread(target=self._compact, args=(base, overlay, tails))
+            thread.daemon = True
+            thread.start()
+            return thread
+        self._compact(base, overlay, tails)
+
+    def _compact(self, CompletionDAWG base, dict overlay, bint tails):
+        cdef vector[string] keys
+        cdef vector[int] values
+        cdef DAWG res
+        cdef dict new_overlay
+        cdef bint ok
+
+        try:
+            for b_key in sorted(overlay):
+                value = overlay[b_key]
+                keys.push_back(b_key)
+                values.push_back(-1 if value is _DELETED else value)
+
+            res = type(base).__new__(type(base))
+            with nogil:
+                ok = _apply_overlay(base, keys, values, &res.dawg)
+                if ok:
+                    ok = res._build_dictionary(tails)
+            if not ok:
+                raise Error("Can't build dictionary")
+
+            # Entries which are in the new base are dropped from a copy of
+            # the overlay: iterators keep the old base with the old overlay.
+            new_overlay = dict(self._overlay)
+            for b_key, value in overlay.items():
+                if new_overlay.get(b_key) is value:
+                    del new_overlay[b_key]
+            self._base = res
+            self._overlay = new_overlay
+            self._overlay_keys = None
+        finally:
+            self._compact_lock.release()
+
+
+cdef bytes _encode_key(key):
+    if isinstance(key, unicode):
+        return <bytes>(<unicode>key).encode('utf8')
+    return key
+
+
+cdef inline const char* _utf8(unicode key, Py_ssize_t* length) except NULL:
+    # UTF-8 data of a string without a new bytes object: data of ASCII
+    # strings is used in place, other strings cache their UTF-8 data.
+    return PyUnicode_AsUTF8AndSize(key, length)
+
+
+cdef const char* _key_utf8(key, Py_ssize_t* length) except NULL:
+    if isinstance(key, unicode):
+        return _utf8(<unicode>key, length)
+    cdef bytes b_key = key
+    length[0] = len(b_key)
+    return b_key
+
+
+cdef Py_ssize_t _bisect_left(list keys, bytes key):
+    cdef Py_ssize_t low = 0, high = len(keys), middle
+    while low < high:
+        middle = (low + high) // 2
+        if <bytes>keys[middle] < key:
+            low = middle + 1
+        else:
+            high = middle
+    return low
+
+
+cdef class SuccinctDAWG:
+    """
+    DAWG stored in a succinct (LOUDS-based) read-only form.
+
+    It supports key lookups, prefix searches, ``similar_keys`` and
+    ``segment`` of ``DAWG`` in less memory; lookups are slower because
+    every transition needs rank/select queries.
+    """
+    cdef SuccinctDawg dawg
+    cdef Container* _container
+
+    def __init__(self, arg=None, input_is_sorted=False, SizeType initial_hash_table_size=0):
+        cdef _dawg.Dawg dawg
+        _build_dawg(_sorted_keys(arg, input_is_sorted), &dawg, initial_hash_table_size)
+
+        if not _succinct_dawg_builder.Build(dawg, &self.dawg):
+            raise Error("Can't build succinct DAWG")
+
+    def __dealloc__(self):
+        self.dawg.Clear()
+        if self._container:
+            del self._container
+
+    def __contains__(self, key):
+        if isinstance(key, unicode):
+            return self.has_key(<unicode>key)
+        return self.b_has_key(key)
+
+    cpdef bint has_key(self, unicode key) except -1:
+        cdef Py_ssize_t length
+        cdef const char* c_key = _utf8(key, &length)
+        return self.dawg.Contains(<CharType*>c_key, length)
+
+    cpdef bint b_has_key(self, bytes key) except -1:
+        return self.dawg.Contains(key, len(key))
+
+    cpdef bytes tobytes(self) except +:
+        """
+        Return raw DAWG content as bytes.
+        """
+        cdef stringstream stream
+        self.dawg.Write(<ostream *> &stream)
+        cdef bytes res = stream.str()
+        return res
+
+    cpdef frombytes(self, bytes data):
+        """
+        Load DAWG from bytes ``data``.
+        """
+        if _is_container(data):
+            self._load_container(_read_container(data), True)
+            return self
+
+        cdef string s_data = data
+        cdef stringstream* stream = new stringstream(s_data)
+
+        try:
+            if not self.dawg.Read(<istream *> stream):
+                raise IOError("Invalid data format")
+            return self
+        finally:
+            del stream
+
+    def read(self, f):
+        """
+        Load DAWG from a file-like object.
+        """
+        self.frombytes(f.read())
+
+    def write(self, f, container=False, checksums=True, compress=False):
+        """
+        Write DAWG to a file-like object (see ``DAWG.write``).
+        """
+        if container or compress:
+            f.write(self._container_bytes(checksums, compress))
+        else:
+            f.write(self.tobytes())
+
+    def load(self, path):
+        """
+        Load DAWG from a file.
+        """
+        if isinstance(path, unicode):
+            path = path.encode(sys.getfilesystemencoding())
+
+        if _is_container_file(path):
+            self._load_container(_open_container(path, False), True)
+            return self
+
+        cdef ifstream stream
+        stream.open(path, iostream.binary)
+        if stream.fail():
+            raise IOError("It's not possible to read file stream")
+
+        res = self.dawg.Read(<istream*> &stream)
+
+        stream.close()
+
+        if not res:
+            raise IOError("Invalid data format")
+
+        return self
+
+    def save(self, path, container=False, checksums=True, compress=False):
+        """
+        Save DAWG to a file (see ``DAWG.save``).
+        """
+        with open(path, 'wb') as f:
+            self.write(f, container, checksums, compress)
+
+    def mmap(self, path, verify=False):
+        """
+        Memory-map DAWG from a file saved with ``save(path, container=True)``
+        (see ``DAWG.mmap``). Mapped data is checked for consistency as
+        on load, so all pages are read once.
+        """
+        if isinstance(path, unicode):
+            path = path.encode(sys.getfilesystemencoding())
+
+        self._load_container(_open_container(path, True), verify)
+        return self
+
+    def verify(self):
+        """
+        Check checksums of a DAWG loaded from a container.
+        Return False if the data is corrupted.
+        """
+        if self._container == NULL:
+            return True
+        return self._container.VerifyAll()
+
+    cdef bytes _container_bytes(self, bint checksums, bint compress):
+        cdef bytes class_tag = _container_class_tag(self).encode('ascii')
+        cdef ContainerWriter* writer = new ContainerWriter(class_tag, checksums, compress)
+        cdef stringstream stream
+        cdef stringstream dawg_stream
+
+        try:
+            self.dawg.Write(<ostream *> &dawg_stream)
+            _set_section(writer, CONTAINER_SUCCINCT_DAWG, dawg_stream, sizeof(BaseType))
+            if not writer.Write(<ostream *> &stream):
+                raise IOError("Can't write DAWG container")
+        finally:
+            del writer
+
+        cdef bytes res = stream.str()
+        return res
+
+    cdef _load_container(self, Container* container, bint verify):
+        # Takes ownership of ``container``.
+        try:
+            _check_container(container, self, verify)
+            if not container.Map(CONTAINER_SUCCINCT_DAWG, &self.dawg):
+                self.dawg.Clear()
+                raise IOError("Invalid data format: can't map _succinct_dawg.SuccinctDawg")
+        except:
+            del container
+            raise
+
+        if self._container:
+            del self._container
+        self._container = container
+
+    # pickling support
+    def __reduce__(self):
+        return self.__class__, tuple(), self.tobytes()
+
+    def __setstate__(self, state):
+        self.frombytes(state)
+
+    def memory_usage(self):
+        """
+        Returns memory used by this DAWG; see ``DAWG.memory_usage``.
+        """
+        cdef dict sections = {
+            'dawg': _memory_section(self.dawg.heap_size(), self._container,
+                                    CONTAINER_SUCCINCT_DAWG),
+            'python': _memory_section(sys.getsizeof(self)),
+        }
+        _add_container_memory_section(sections, self._container)
+        return _memory_usage(sections, None)
+
+    # half-internal methods
+    def _size(self):
+        return self.dawg.num_of_transitions()
+
+    def _total_size(self):
+        return self.dawg.total_size()
+
+    def _file_size(self):
+        return self.dawg.file_size()
+
+    cpdef list similar_keys(self, unicode key, replaces):
+        """
+        Return all variants of ``key`` in this DAWG according to
+        ``replaces`` (see ``DAWG.similar_keys``).
+        """
+        return _similar_keys(self.dawg, key, _compiled_replaces(replaces), -1, NULL)
+
+    cpdef list prefixes(self, unicode key):
+        '''
+        Return a list with keys of this DAWG that are prefixes of the ``key``.
+        '''
+        cdef Py_ssize_t length
+        cdef const char* c_key = _utf8(key, &length)
+        return self._prefixes(c_key, length, True)
+
+    cpdef list b_prefixes(self, bytes b_key):
+        return self._prefixes(b_key, len(b_key), False)
+
+    cdef list _prefixes(self, const char* c_key, SizeType length, bint decode):
+        cdef list res = []
+        cdef BaseType state = self.dawg.root()
+        cdef SizeType pos
+
+        for pos in range(length):
+            if not self.dawg.Follow(c_key[pos], &state):
+                break
+            if self.dawg.has_value(state):
+                if decode:
+                    res.append(PyUnicode_DecodeUTF8(c_key, pos + 1, NULL))
+                else:
+                    res.append(c_key[:pos + 1])
+
+        return res
+
+    def iterprefixes(self, unicode key):
+        '''
+        Return a generator with keys of this DAWG that are prefixes of the ``key``.
+        '''
+        cdef BaseType state = self.dawg.root()
+        cdef Py_ssize_t length
+        cdef const char* c_key = _utf8(key, &length)
+        cdef Py_ssize_t pos
+
+        for pos in range(length):
+            if not self.dawg.Follow(c_key[pos], &state):
+                return
+            if self.dawg.has_value(state):
+                yield PyUnicode_DecodeUTF8(c_key, pos + 1, NULL)
+
+    def prefix_ends(self, key, bint values=False):
+        '''
+        Return a list with end positions of keys of this DAWG that are
+        prefixes of the ``key`` (see ``DAWG.prefix_ends``).
+        '''
+        return _prefix_ends(self.dawg, key, values, -1)
+
+    def prefix_ends_batch(self, keys, bint values=False):
+        '''
+        Return a list of ``prefix_ends(key, values)`` results for an
+        iterable of ``keys``; all keys are matched without the GIL.
+        '''
+        return _prefix_ends_batch(self.dawg, keys, values, -1)
+
+    def segment(self, text, mode='longest'):
+        '''
+        Find keys of this DAWG in ``text`` and return an ``array('q')``
+        of their (start, end, value) spans (see ``DAWG.segment``).
+        '''
+        return _segment(self.dawg, text, mode, -1)
+
+    @classmethod
+    def compile_replaces(cls, replaces):
+        return DAWG.compile_replaces(replaces)
+
+
+cdef class SuccinctCompletionDAWG(SuccinctDAWG):
+    """
+    Succinct DAWG with key completion support.
+    """
+
+    cpdef list keys(self, unicode prefix=""):
+        cdef bytes b_prefix = prefix.encode('utf8')
+        cdef BaseType state = self.dawg.root()
+        cdef list res = []
+
+        if not self.dawg.Follow(b_prefix, &state):
+            return res
+
+        cdef SuccinctCompleter completer
+        completer.set_dawg(self.dawg)
+        completer.Start(state, b_prefix)
+
+        while completer.Next():
+            key = completer.key()[:completer.length()].decode('utf8')
+            res.append(key)
+
+        return res
+
+    def iterkeys(self, unicode prefix=""):
+        cdef bytes b_prefix = prefix.encode('utf8')
+        cdef BaseType state = self.dawg.root()
+
+        if not self.dawg.Follow(b_prefix, &state):
+            return
+
+        cdef SuccinctCompleter completer
+        completer.set_dawg(self.dawg)
+        completer.Start(state, b_prefix)
+
+        while completer.Next():
+            key = completer.key()[:completer.length()].decode('utf8')
+            yield key
+
+    def has_keys_with_prefix(self, unicode prefix):
+        cdef bytes b_prefix = prefix.encode('utf8')
+        cdef BaseType state = self.dawg.root()
+
+        if not self.dawg.Follow(b_prefix, &state):
+            return False
+
+        cdef SuccinctCompleter completer
+        completer.set_dawg(self.dawg)
+        completer.Start(state, b_prefix)
+
+        return completer.Next()
+
+
+cdef class SuccinctIntDAWG(SuccinctDAWG):
+    """
+    Succinct DAWG which maps unicode keys to integer values.
+    """
+    def __init__(self, arg=None, input_is_sorted=False, SizeType initial_hash_table_size=0):
+        """
+        ``arg`` must be an iterable of tuples (unicode_key, int_value)
+        or a dict {unicode_key: int_value}.
+        """
+        iterable = _iterable_from_argument(arg)
+        super(SuccinctIntDAWG, self).__init__(iterable, input_is_sorted, initial_hash_table_size)
+
+    def __getitem__(self, key):
+        cdef int res = self.get(key, LOOKUP_ERROR)
+        if res == LOOKUP_ERROR:
+            raise KeyError(key)
+        return res
+
+    cpdef get(self, key, default=None):
+        """
+        Return value for the given key or ``default`` if the key is not found.
+        """
+        cdef int res
+        if isinstance(key, unicode):
+            res = self.get_value(<unicode>key)
+        else:
+            res = self.b_get_value(key)
+
+        if res == LOOKUP_ERROR:
+            return default
+        return res
+
+    cpdef int get_value(self, unicode key):
+        cdef Py_ssize_t length
+        cdef const char* c_key = _utf8(key, &length)
+        return _succinct_find(self.dawg, c_key, length)
+
+    cpdef int b_get_value(self, bytes key):
+        return _succinct_find(self.dawg, key, len(key))
+
+
+# FIXME: code duplication.
+cdef class SuccinctIntCompletionDAWG(SuccinctCompletionDAWG):
+    """
+    Succinct DAWG which maps unicode keys to integer values and supports
+    key completion.
+    """
+    def __init__(self, arg=None, input_is_sorted=False, SizeType initial_hash_table_size=0):
+        """
+        ``arg`` must be an iterable of tuples (unicode_key, int_value)
+        or a dict {unicode_key: int_value}.
+        """
+        iterable = _iterable_from_argument(arg)
+        super(SuccinctIntCompletionDAWG, self).__init__(iterable, input_is_sorted,
+                                                        initial_hash_table_size)
+
+    def __getitem__(self, key):
+        cdef int res = self.get(key, LOOKUP_ERROR)
+        if res == LOOKUP_ERROR:
+            raise KeyError(key)
+        return res
+
+    cpdef get(self, key, default=None):
+        """
+        Return value for the given key or ``default`` if the key is not found.
+        """
+        cdef int res
+        if isinstance(key, unicode):
+            res = self.get_value(<unicode>key)
+        else:
+            res = self.b_get_value(key)
+
+        if res == LOOKUP_ERROR:
+            return default
+        return res
+
+    cpdef int get_value(self, unicode key):
+        cdef Py_ssize_t length
+        cdef const char* c_key = _utf8(key, &length)
+        return _succinct_find(self.dawg, c_key, length)
+
+    cpdef int b_get_value(self, bytes key):
+        return _succinct_find(self.dawg, key, len(key))
+
+    cpdef list items(self, unicode prefix=""):
+        cdef bytes b_prefix = prefix.encode('utf8')
+        cdef BaseType state = self.dawg.root()
+        cdef list res = []
+        cdef int value
+
+        if not self.dawg.Follow(b_prefix, &state):
+            return res
+
+        cdef SuccinctCompleter completer
+        completer.set_dawg(self.dawg)
+        completer.Start(state, b_prefix)
+
+        while completer.Next():
+            key = completer.key()[:completer.length()].decode('utf8')
+            value = completer.value()
+            res.append((key, value))
+
+        return res
+
+    def iteritems(self, unicode prefix=""):
+        cdef bytes b_prefix = prefix.encode('utf8')
+        cdef BaseType state = self.dawg.root()
+        cdef int value
+
+        if not self.dawg.Follow(b_prefix, &state):
+            return
+
+        cdef SuccinctCompleter completer
+        completer.set_dawg(self.dawg)
+        completer.Start(state, b_prefix)
+
+        while completer.Next():
+            key = completer.key()[:completer.length()].decode('utf8')
+            value = completer.value()
+            yield key, value
+
+
+cdef int _succinct_find(SuccinctDawg& dawg, const char* key, SizeType length):
+    cdef ValueType value
+    if not dawg.Find(<CharType*>key, length, &value):
+        return LOOKUP_ERROR
+    return value
+
+
+_CONTAINER_CLASSES = (
+    DAWG, CompletionDAWG, BytesDAWG, RecordDAWG, IntDAWG, IntCompletionDAWG,
+    SuccinctDAWG, SuccinctCompletionDAWG, SuccinctIntDAWG, SuccinctIntCompletionDAWG
+)
@@ -5,11 +5,16 @@ cdef extern from "<istream>" namespace "std" nogil:
     cdef cppclass istream:
         istream() except +
         istream& read (char* s, int n) except +
+        int peek() except +
+        bool fail() except +
 
     cdef cppclass ostream:
         ostream() except +
         ostream& write (char* s, int n) except +
 
+cdef extern from "<cstdio>" nogil:
+    int EOF
+
 cdef extern from "<fstream>" namespace "std" nogil:
     cdef cppclass ifstream:
         ifstream() except +
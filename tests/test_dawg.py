@@ -1,6 +1,8 @@
 # -*- coding: utf-8 -*-
 from __future__ import absolute_import, unicode_literals
+import array
 import pickle
+import struct
 import tempfile
 from io import BytesIO
 
@@ -65,6 +67,29 @@ class TestDAWG(object):
             data = [b'foo\x00bar', b'bar']
             dawg.DAWG(data)
 
+    def test_initial_hash_table_size(self):
+        words = ['%s%d' % (prefix, i) for prefix in ('foo', 'bar', 'baz')
+                 for i in range(1000)]
+        d = dawg.DAWG(words)
+
+        for size in (0, 1, 1000, 1 << 20):
+            d2 = dawg.DAWG(words, initial_hash_table_size=size)
+            assert d2.tobytes() == d.tobytes()
+
+    def test_build_stats(self):
+        words = ['%x' % (i * 2654435761 % 2 ** 32) for i in range(20000)]
+        stats = dawg.CompletionDAWG(words).build_stats
+        assert stats['num_of_keys'] == 20000
+        assert stats['num_of_hash_table_expansions'] > 0
+        assert stats['num_of_units'] > stats['num_of_unused_units']
+        assert 0 < stats['fill_ratio'] <= 1
+        assert stats['dawg_builder_peak_size'] > 0
+        assert all(stats[key] >= 0 for key in ('sort_time', 'dawg_time', 'dictionary_time'))
+
+        stats = dawg.IntDAWG(zip(words, range(20000)), initial_hash_table_size=1 << 20).build_stats
+        assert stats['hash_table_size'] == 1 << 20
+        assert stats['num_of_hash_table_expansions'] == 0
+
     def test_contains_with_null_bytes(self):
         d = dawg.DAWG(['foo'])
         assert b'foo' in d
@@ -194,6 +219,13 @@ class TestCompletionDAWG(object):
         assert list(d.iterprefixes("x")) == d.prefixes("x")
         assert list(d.iterprefixes("bar")) == d.prefixes("bar")
 
+    def test_prefix_ends(self):
+        d = self.dawg()
+        assert d.prefix_ends("foobarz") == [1, 3, 6]
+        assert d.prefix_ends(b"foobarz") == [1, 3, 6]
+        assert d.prefix_ends("x") == []
+        assert d.prefix_ends_batch(["foobarz", "x", b"bar"]) == [[1, 3, 6], [], [3]]
+
     def test_completion(self):
         d = self.dawg()
 
@@ -268,3 +300,719 @@ class TestIntCompletionDAWGComplete(TestCompletionDAWG):
     def test_items_prefix(self):
         d = self.dawg()
         assert d.items('fo') == [('foo', 3), ('foobar', 6)]
+
+
+class TestContainer(object):
+    keys = ['f', 'bar', 'foo', 'foobar']
+
+    def test_saveload(self, tmpdir):
+        path = str(tmpdir.join('words.dawg'))
+        dawg.CompletionDAWG(self.keys).save(path, container=True)
+
+        d = dawg.CompletionDAWG().load(path)
+        assert d.keys() == sorted(self.keys)
+        assert d.keys('foo') == ['foo', 'foobar']
+
+    def test_mmap(self, tmpdir):
+        path = str(tmpdir.join('words.dawg'))
+        dawg.IntCompletionDAWG({'foo': 1, 'bar': 5}).save(path, container=True)
+
+        d = dawg.IntCompletionDAWG().mmap(path)
+        assert d.items() == [('bar', 5), ('foo', 1)]
+        assert d.verify()
+
+    def test_frombytes(self):
+        buf = BytesIO()
+        dawg.DAWG(self.keys).write(buf, container=True)
+
+        d = dawg.DAWG().frombytes(buf.getvalue())
+        for key in self.keys:
+            assert key in d
+        assert 'fo' not in d
+
+    def test_empty_dawg(self, tmpdir):
+        path = str(tmpdir.join('empty.dawg'))
+        dawg.CompletionDAWG([]).save(path, container=True, checksums=False)
+
+        d = dawg.CompletionDAWG().mmap(path, verify=True)
+        assert d.keys() == []
+
+    def test_compressed(self, tmpdir):
+        path = str(tmpdir.join('words.dawg'))
+        keys = ['key%d' % i for i in range(10000)]
+        dawg.CompletionDAWG(keys).save(path, compress=True)
+
+        d = dawg.CompletionDAWG().load(path)
+        assert d.keys() == sorted(keys)
+        assert d.keys('key999') == ['key999', 'key9990', 'key9991', 'key9992',
+                                    'key9993', 'key9994', 'key9995', 'key9996',
+                                    'key9997', 'key9998', 'key9999']
+
+        d = dawg.CompletionDAWG().mmap(path, verify=True)
+        assert d.keys() == sorted(keys)
+
+    def test_corrupt_compressed(self, tmpdir):
+        path = str(tmpdir.join('words.dawg'))
+        keys = ['%08x' % (i * 2654435761 % 2 ** 32) for i in range(20000)]
+        while True:
+            dawg.DAWG(keys).save(path, compress=True, checksums=False)
+            with open(path, 'rb') as f:
+                data = bytearray(f.read())
+            offset, size = struct.unpack_from(str('<QQ'), data, 64)
+            if (size - 24) % 4 == 0:
+                break
+            keys.pop()
+
+        # Empty blocks which claim 256KB of output each.
+        num_of_blocks = (size - 24) // 4
+        struct.pack_into(str('<IIIIQ'), data, offset, 1, 4, 1 << 18, num_of_blocks, num_of_blocks << 18)
+        data[offset + 24:offset + size] = bytes(size - 24)
+        with open(path, 'wb') as f:
+            f.write(data)
+
+        with pytest.raises(IOError):
+            dawg.DAWG().mmap(path)
+
+    def test_class_mismatch(self, tmpdir):
+        path = str(tmpdir.join('words.dawg'))
+        dawg.DAWG(self.keys).save(path, container=True)
+
+        with pytest.raises(IOError) as e:
+            dawg.CompletionDAWG().load(path)
+        assert "DAWG is stored, not CompletionDAWG" in str(e.value)
+
+    def test_corrupted_data(self, tmpdir):
+        buf = BytesIO()
+        dawg.CompletionDAWG(self.keys).write(buf, container=True)
+        data = bytearray(buf.getvalue())
+        data[4096 + 8] ^= 0xFF  # the first section starts at page 1
+
+        path = str(tmpdir.join('words.dawg'))
+        with open(path, 'wb') as f:
+            f.write(bytes(data))
+
+        with pytest.raises(IOError):
+            dawg.CompletionDAWG().load(path)
+
+        d = dawg.CompletionDAWG().mmap(path)
+        assert not d.verify()
+
+
+class TestSuccinctCompletionDAWG(TestCompletionDAWG):
+
+    def dawg(self):
+        return dawg.SuccinctCompletionDAWG(self.keys)
+
+    def empty_dawg(self):
+        return dawg.SuccinctCompletionDAWG()
+
+    def test_no_segfaults_on_empty_dawg(self):
+        d = dawg.SuccinctCompletionDAWG([])
+        assert d.keys() == []
+        assert 'foo' not in d
+
+    def test_same_as_completion_dawg(self):
+        keys = ['%s%d' % (prefix, i) for prefix in ('key', 'kex', 'ab', 'абв')
+                for i in range(0, 3000, 7)]
+        d = dawg.SuccinctCompletionDAWG(keys)
+        completion_dawg = dawg.CompletionDAWG(keys)
+
+        assert d.keys() == completion_dawg.keys()
+        for prefix in ('', 'k', 'key1', 'абв29', 'x'):
+            assert d.keys(prefix) == completion_dawg.keys(prefix)
+        for key in ('key7', 'key8', 'ab2996', 'абв', 'абв14'):
+            assert (key in d) == (key in completion_dawg)
+        assert d._total_size() < completion_dawg._total_size()
+
+    def test_similar_keys(self):
+        d = dawg.SuccinctDAWG(['хлеб', 'ёлка', 'елка', 'ель'])
+        replaces = dawg.SuccinctDAWG.compile_replaces({'е': 'ё'})
+        assert d.similar_keys('елка', replaces) == ['елка', 'ёлка']
+        assert d.similar_keys('ель', replaces) == ['ель']
+
+    def test_pickling(self):
+        d = pickle.loads(pickle.dumps(self.dawg()))
+        assert d.keys() == sorted(self.keys)
+
+    def test_save_load(self, tmpdir):
+        path = str(tmpdir.join('words.dawg'))
+        self.dawg().save(path)
+
+        d = self.empty_dawg().load(path)
+        assert d.keys() == sorted(self.keys)
+        assert 'fo' not in d
+
+    @pytest.mark.parametrize("compress", [False, True])
+    def test_container(self, tmpdir, compress):
+        path = str(tmpdir.join('words.dawg'))
+        keys = ['%s%d' % (prefix, i) for prefix in ('key', 'абв') for i in range(3000)]
+        dawg.SuccinctCompletionDAWG(keys).save(path, container=True, compress=compress)
+
+        d = self.empty_dawg().load(path)
+        assert d.keys('key12') == dawg.CompletionDAWG(keys).keys('key12')
+
+        d = self.empty_dawg().mmap(path, verify=True)
+        assert d.keys() == sorted(keys)
+        assert d.verify()
+
+        buf = BytesIO()
+        d.write(buf, container=True)
+        d = self.empty_dawg().frombytes(buf.getvalue())
+        assert d.keys() == sorted(keys)
+        assert pickle.loads(pickle.dumps(d)).keys() == sorted(keys)
+
+    def test_mmap_is_not_copied(self, tmpdir):
+        path = str(tmpdir.join('words.dawg'))
+        keys = ['key%d' % i for i in range(10000)]
+        dawg.SuccinctDAWG(keys).save(path, container=True)
+
+        usage = dawg.SuccinctDAWG().mmap(path).memory_usage()
+        assert usage['sections']['dawg']['mapped'] > 0
+        assert usage['sections']['dawg']['heap'] < usage['sections']['dawg']['mapped']
+
+    def test_container_errors(self, tmpdir):
+        path = str(tmpdir.join('words.dawg'))
+        self.dawg().save(path, container=True)
+
+        with pytest.raises(IOError) as e:
+            dawg.SuccinctDAWG().load(path)
+        assert "SuccinctCompletionDAWG is stored, not SuccinctDAWG" in str(e.value)
+        with pytest.raises(IOError):
+            dawg.CompletionDAWG().load(path)
+
+        with open(path, 'rb') as f:
+            data = bytearray(f.read())
+        offset, size = struct.unpack_from(str('<QQ'), data, 64 + 24 * 5)
+        data[offset + size - 4:offset + size] = b'\xff\xff\xff\xff'
+        with open(path, 'wb') as f:
+            f.write(bytes(data))
+
+        with pytest.raises(IOError):
+            self.empty_dawg().mmap(path)
+
+
+class TestSuccinctIntDAWG(TestIntDAWG):
+    IntDAWG = dawg.SuccinctIntDAWG
+
+
+class TestSuccinctIntCompletionDAWG(TestIntDAWG):
+    IntDAWG = dawg.SuccinctIntCompletionDAWG
+
+    def test_items(self):
+        payload, d = self.dawg()
+        assert d.items() == sorted(payload.items())
+        assert list(d.iteritems('foo')) == [('foo', 1), ('foobar', 3)]
+        assert d.keys('b') == ['bar']
+
+    def test_container(self, tmpdir):
+        path = str(tmpdir.join('words.dawg'))
+        payload, d = self.dawg()
+        d.save(path, container=True)
+
+        d = self.IntDAWG().mmap(path, verify=True)
+        assert d.items() == sorted(payload.items())
+        assert d.get('foo') == 1
+        assert d.get(b'foobar') == 3
+        assert d.get('fo', 7) == 7
+
+
+class TestTailCompletionDAWG(TestCompletionDAWG):
+    urls = ['http://example.com/%s/page%d-%x' % (section, i, i * 2654435761 % 2 ** 32)
+            for section in ('news', 'sport', 'weather')
+            for i in range(0, 2000, 3)]
+
+    def dawg(self):
+        return dawg.CompletionDAWG(self.keys, tails=True)
+
+    def empty_dawg(self):
+        return dawg.CompletionDAWG(tails=True)
+
+    def test_same_as_completion_dawg(self):
+        d = dawg.CompletionDAWG(self.urls, tails=True)
+        plain_dawg = dawg.CompletionDAWG(self.urls)
+
+        assert d.keys() == plain_dawg.keys()
+        for prefix in ('', 'http://example.com/s', 'http://example.com/news/page19',
+                       'http://example.com/news/page1998-', 'http://example.com/news/page3-da', 'x'):
+            assert d.keys(prefix) == plain_dawg.keys(prefix)
+            assert d.has_keys_with_prefix(prefix) == plain_dawg.has_keys_with_prefix(prefix)
+        for key in ('http://example.com/news/page3-daa66d13', 'http://example.com/news/page3-daa66d1',
+                    'http://example.com/news/page3-daa66d13x', 'http://example.com/news/page3-daa66d14'):
+            assert (key in d) == (key in plain_dawg)
+            assert d.prefixes(key) == plain_dawg.prefixes(key)
+        assert d._file_size() < plain_dawg._file_size()
+
+    def test_int_values(self):
+        data = dict((url, i) for i, url in enumerate(self.urls))
+        d = dawg.IntCompletionDAWG(data, tails=True)
+        for key, value in data.items():
+            assert d[key] == value
+        assert dict(d.items('http://example.com/sport/page1')) == dict(
+            (k, v) for k, v in data.items() if k.startswith('http://example.com/sport/page1'))
+
+    def test_similar_keys(self):
+        d = dawg.DAWG(['хлебница', 'ёлочка', 'елочка', 'ельник'], tails=True)
+        replaces = dawg.DAWG.compile_replaces({'е': 'ё'})
+        assert d.similar_keys('елочка', replaces) == ['елочка', 'ёлочка']
+        assert d.similar_keys('ельник', replaces) == ['ельник']
+
+    def test_save_load(self, tmpdir):
+        path = str(tmpdir.join('urls.dawg'))
+        dawg.CompletionDAWG(self.urls, tails=True).save(path)
+        d = dawg.CompletionDAWG().load(path)
+        assert d.keys() == sorted(self.urls)
+
+        d = pickle.loads(pickle.dumps(d))
+        assert d.keys() == sorted(self.urls)
+
+    def test_container(self, tmpdir):
+        path = str(tmpdir.join('urls.dawg'))
+        dawg.IntCompletionDAWG(dict.fromkeys(self.urls, 7), tails=True).save(path, container=True)
+
+        d = dawg.IntCompletionDAWG().mmap(path, verify=True)
+        assert d.keys() == sorted(self.urls)
+        assert d['http://example.com/weather/page3-daa66d13'] == 7
+
+        dawg.CompletionDAWG(self.urls, tails=True).save(path, compress=True)
+        d = dawg.CompletionDAWG().mmap(path)
+        assert d.keys('http://example.com/news/page99') == [
+            key for key in sorted(self.urls) if key.startswith('http://example.com/news/page99')]
+
+
+class TestDawgBuilderSession(object):
+    words = sorted('%s%d' % (prefix, i) for prefix in ('bar', 'baz', 'foo')
+                   for i in range(500))
+
+    def test_snapshots(self):
+        session = dawg.DawgBuilderSession()
+        assert session.snapshot(dawg.CompletionDAWG).keys() == []
+
+        for start in range(0, len(self.words), 200):
+            session.add_sorted(self.words[start:start + 200])
+            d = session.snapshot(dawg.CompletionDAWG)
+            expected = dawg.CompletionDAWG(self.words[:start + 200])
+
+            assert d.keys() == self.words[:start + 200]
+            assert d.tobytes() == expected.tobytes()
+
+    def test_values(self):
+        session = dawg.DawgBuilderSession(initial_hash_table_size=4096)
+        items = [(word, i) for i, word in enumerate(self.words)]
+        session.add_sorted(items[:1000])
+        d = session.snapshot(dawg.IntCompletionDAWG, tails=True)
+        session.add_sorted(items[1000:])
+
+        assert dict(d.items()) == dict(items[:1000])
+        assert dict(session.snapshot(dawg.IntCompletionDAWG).items()) == dict(items)
+        assert session.snapshot(dawg.IntDAWG)['foo499'] == dict(items)['foo499']
+
+    def test_unsorted_batch(self):
+        session = dawg.DawgBuilderSession()
+        session.add_sorted(['bar', 'foo'])
+
+        with pytest.raises(dawg.Error):
+            session.add_sorted(['foobar', 'baz', 'zzz'])
+
+        session.add_sorted(['zzz'])
+        assert session.snapshot(dawg.CompletionDAWG).keys() == ['bar', 'foo', 'foobar', 'zzz']
+
+    def test_build_stats(self):
+        session = dawg.DawgBuilderSession()
+        session.add_sorted(self.words)
+        d = session.snapshot(dawg.IntDAWG)
+        assert d.build_stats is None
+        assert d.memory_usage()['build_peak'] is None
+
+    def test_snapshot_classes(self):
+        session = dawg.DawgBuilderSession()
+        with pytest.raises(TypeError):
+            session.snapshot(dawg.BytesDAWG)
+        with pytest.raises(TypeError):
+            session.snapshot(dict)
+
+
+class TestMerge(object):
+    a = {'bar': 1, 'baz': 2, 'foo': 3, 'foobar': 4}
+    b = {'baz': 20, 'foo': 30, 'fo': 5, 'zoo': 6}
+
+    def test_union(self):
+        words = ['%s%d' % (prefix, i) for prefix in ('bar', 'foo') for i in range(300)]
+        a, b = words[::2], words[::3]
+        d = dawg.DAWG.merge(dawg.CompletionDAWG(a), dawg.CompletionDAWG(b))
+
+        assert isinstance(d, dawg.CompletionDAWG)
+        assert d.tobytes() == dawg.CompletionDAWG(set(a) | set(b)).tobytes()
+
+    @pytest.mark.parametrize(("op", "keys"), [
+        ('union', ['bar', 'baz', 'fo', 'foo', 'foobar', 'zoo']),
+        ('intersection', ['baz', 'foo']),
+        ('difference', ['bar', 'foobar']),
+    ])
+    def test_ops(self, op, keys):
+        d = dawg.DAWG.merge(dawg.IntCompletionDAWG(self.a), dawg.IntCompletionDAWG(self.b),
+                            op=op, tails=True)
+        assert isinstance(d, dawg.IntCompletionDAWG)
+        assert d.keys() == keys
+
+    @pytest.mark.parametrize(("conflict", "values"), [
+        ('first', (2, 3)),
+        ('second', (20, 30)),
+        ('min', (2, 3)),
+        ('max', (20, 30)),
+        ('sum', (22, 33)),
+        (lambda x, y: y - x, (18, 27)),
+    ])
+    def test_conflicts(self, conflict, values):
+        d = dawg.DAWG.merge(dawg.IntCompletionDAWG(self.a), dawg.IntCompletionDAWG(self.b),
+                            conflict=conflict)
+        assert (d['baz'], d['foo']) == values
+        assert d['bar'] == 1
+        assert d['zoo'] == 6
+
+    def test_sum_overflow(self):
+        a = dawg.IntCompletionDAWG({'foo': 2 ** 31 - 2})
+        d = dawg.DAWG.merge(a, dawg.IntCompletionDAWG({'foo': 1}), conflict='sum')
+        assert d['foo'] == 2 ** 31 - 1
+
+        with pytest.raises(OverflowError):
+            dawg.DAWG.merge(a, dawg.IntCompletionDAWG({'foo': 2}), conflict='sum')
+
+    def test_build_stats(self):
+        d = dawg.DAWG.merge(dawg.IntCompletionDAWG(self.a), dawg.IntCompletionDAWG(self.b))
+        assert d.build_stats is None
+        assert d.memory_usage()['build_peak'] is None
+
+    def test_errors(self):
+        a = dawg.IntCompletionDAWG(self.a)
+        with pytest.raises(TypeError):
+            dawg.DAWG.merge(a, dawg.DAWG(self.b))
+        with pytest.raises(TypeError):
+            dawg.DAWG.merge(a, dawg.BytesDAWG([('foo', b'bar')]))
+        with pytest.raises(ValueError):
+            dawg.DAWG.merge(a, a, op='xor')
+        with pytest.raises(ValueError):
+            dawg.DAWG.merge(a, a, conflict='last')
+        with pytest.raises(ValueError):
+            dawg.DAWG.merge(a, a, conflict=lambda x, y: -1)
+
+
+class TestLookupStats(object):
+
+    @pytest.mark.skipif(dawg.LOOKUP_STATS, reason="lookup stats are enabled")
+    def test_disabled(self):
+        d = dawg.IntCompletionDAWG({'foo': 1})
+        with pytest.raises(dawg.Error):
+            d.stats()
+        d.reset_stats()
+
+    @pytest.mark.skipif(not dawg.LOOKUP_STATS, reason="lookup stats are disabled")
+    def test_counters(self):
+        d = dawg.IntCompletionDAWG({'foo': 1, 'foobar': 2, 'bar': 3})
+        d.get('foo')
+        d.get(b'fox')
+        d.keys('foo')
+        d.prefixes('foobarbaz')
+
+        stats = d.stats()
+        assert stats['get']['calls'] == 2
+        assert (stats['get']['hits'], stats['get']['misses']) == (1, 1)
+        assert stats['get']['transitions'] == 5
+        assert stats['keys']['completions'] == 2
+        assert stats['prefixes']['completions'] == 2
+        assert sum(stats['get']['latency_histogram']) == 2
+        assert stats['similar_keys']['calls'] == 0
+
+        d.reset_stats()
+        assert d.stats()['get']['calls'] == 0
+
+
+class TestUtf8Lookups(object):
+    keys = ['fo', 'foo', 'föö', 'ф', 'фу', '\U0001f600']
+
+    def test_lookups(self):
+        d = dawg.IntCompletionDAWG((key, i) for i, key in enumerate(self.keys))
+        b = dawg.BytesDAWG((key, b'x') for key in self.keys)
+        s = dawg.SuccinctDAWG(self.keys)
+        for i, key in enumerate(self.keys):
+            assert key in d and key in b and key in s
+            assert d.get(key) == i
+            assert b.get(key) == [b'x']
+
+        assert d.prefixes('фуу') == s.prefixes('фуу') == ['ф', 'фу']
+        assert d.prefix_ends('фуу') == s.prefix_ends('фуу') == [1, 2]
+        assert d.prefix_ends('фуу'.encode('utf8'), values=True) == [(2, 3), (4, 4)]
+        assert b.prefix_ends('фуу') == [1, 2]
+        assert d.prefix_ends_batch(['\U0001f600!', 'foo'], values=True) == [[(1, 5)], [(2, 0), (3, 1)]]
+        with pytest.raises(TypeError):
+            b.prefix_ends('фуу', values=True)
+        assert d.b_prefixes('фуу'.encode('utf8')) == ['ф'.encode('utf8'), 'фу'.encode('utf8')]
+        assert d.get('foo\x00bar') is None
+        assert d.get(b'foo\x00bar') is None
+
+    def test_surrogates(self):
+        d = dawg.IntDAWG({'foo': 1})
+        with pytest.raises(UnicodeEncodeError):
+            '\ud800' in d
+        with pytest.raises(UnicodeEncodeError):
+            d.get('\ud800')
+
+
+def spans(array):
+    # Splits an array of (start, end, value) triples into tuples.
+    return list(zip(*[iter(array)] * 3))
+
+
+class TestSegment(object):
+    data = {'foo': 1, 'foobar': 2, 'bar': 3, 'ф': 4, 'фу': 5, 'o': 6}
+
+    def test_longest(self):
+        d = dawg.IntCompletionDAWG(self.data)
+        assert spans(d.segment('xfoobarфуфoo')) == [
+            (1, 7, 2), (7, 9, 5), (9, 10, 4), (10, 11, 6), (11, 12, 6)]
+        assert spans(d.segment('xfoobarфу'.encode('utf8'))) == [(1, 7, 2), (7, 11, 5)]
+        assert d.segment('') == d.segment('xyz') == array.array('q')
+
+    def test_all(self):
+        d = dawg.IntDAWG(self.data)
+        assert spans(d.segment('foobarф', mode='all')) == [
+            (0, 3, 1), (0, 6, 2), (1, 2, 6), (2, 3, 6), (3, 6, 3), (6, 7, 4)]
+
+    def test_classes(self):
+        assert spans(dawg.SuccinctDAWG(['foo', 'o']).segment('foo o')) == [(0, 3, 0), (4, 5, 0)]
+        assert spans(dawg.BytesDAWG([('foo', b'x')]).segment('afoo')) == [(1, 4, 0)]
+        with pytest.raises(ValueError):
+            dawg.DAWG(['foo']).segment('foo', mode='shortest')
+
+
+class TestMatcher(object):
+    keys = ['he', 'she', 'his', 'hers', 'ф', 'фу']
+
+    def test_find_all(self):
+        matcher = dawg.IntCompletionDAWG((key, i) for i, key in enumerate(self.keys)).build_matcher()
+        assert spans(matcher.find_all('ushers фу')) == [
+            (1, 4, 1), (2, 4, 0), (2, 6, 3), (7, 8, 4), (7, 9, 5)]
+        assert spans(matcher.find_all('ushers фу'.encode('utf8'))) == [
+            (1, 4, 1), (2, 4, 0), (2, 6, 3), (7, 9, 4), (7, 11, 5)]
+        assert matcher.find_all('') == matcher.find_all('xyz\0') == array.array('q')
+
+    def test_same_as_segment(self):
+        d = dawg.CompletionDAWG(self.keys, tails=True)
+        text = 'he shishers фуф'
+        key = lambda span: (span[1], span[0])
+        assert spans(d.build_matcher().find_all(text)) == sorted(
+            spans(d.segment(text, mode='all')), key=key)
+
+    def test_bytes_dawg(self):
+        with pytest.raises(TypeError):
+            dawg.BytesDAWG([('foo', b'x')]).build_matcher()
+
+
+class TestFuzzy(object):
+    keys = ['ёлка', 'елка', 'ель', 'еле', 'кот', 'кит', 'котик']
+
+    def test_fuzzy_keys(self):
+        d = dawg.CompletionDAWG(self.keys)
+        assert d.fuzzy_keys('елка', 0) == ['елка']
+        assert d.fuzzy_keys('елка', 1) == ['елка', 'ёлка']
+        assert d.fuzzy_keys('ел', 1, distances=True) == [('еле', 1), ('ель', 1)]
+        assert d.fuzzy_keys('кт', 1) == ['кит', 'кот']
+        assert d.fuzzy_keys('кот', 2) == ['кит', 'кот', 'котик']
+        assert d.fuzzy_keys('', 3) == ['еле', 'ель', 'кит', 'кот']
+        assert d.fuzzy_keys('собака', 2) == []
+
+    def test_tails(self):
+        d = dawg.CompletionDAWG(self.keys, tails=True)
+        assert d.fuzzy_keys('котк', 1) == ['кот', 'котик']
+
+    def test_fuzzy_items(self):
+        d = dawg.IntCompletionDAWG((key, len(key)) for key in self.keys)
+        assert d.fuzzy_items('кит', 1) == [('кит', 3), ('кот', 3)]
+
+        d = dawg.BytesDAWG([('кот', b'x'), ('кот', b'y'), ('кит', b'z')])
+        assert d.fuzzy_keys('кт', 1) == ['кит', 'кот']
+        assert d.fuzzy_items('кот', 0) == [('кот', [b'x', b'y'])]
+
+
+class TestSimilar(object):
+    keys = ['strasse', 'straße', 'muenchen', 'münchen', 'mönchen']
+
+    def test_multichar_replaces(self):
+        d = dawg.DAWG(self.keys)
+        replaces = dawg.DAWG.compile_replaces({'ss': 'ß', 'ß': 'ss', 'ue': 'ü'})
+        assert d.similar_keys('strasse', replaces) == ['strasse', 'straße']
+        assert d.similar_keys('straße', replaces) == ['straße', 'strasse']
+        assert d.similar_keys('muenchen', replaces) == ['muenchen', 'münchen']
+        assert d.similar_keys('münchen', replaces) == ['münchen']
+
+    def test_compiled_replaces(self):
+        replaces = dawg.DAWG.compile_replaces({'ü': 'ö'})
+        assert isinstance(replaces, dict)
+        assert pickle.loads(pickle.dumps(replaces)) == replaces
+
+        d = dawg.BytesDAWG([('münchen', b'x'), ('mönchen', b'y')])
+        assert d.similar_items('münchen', replaces) == [
+            ('münchen', [b'x']), ('mönchen', [b'y'])]
+        assert d.similar_item_values('mynchen', replaces) == []
+
+        with pytest.raises(ValueError):
+            dawg.DAWG.compile_replaces({'': 'x'})
+
+
+class TestMemoryUsage(object):
+    keys = ['foo', 'bar', 'foobar', 'baz']
+
+    def check_totals(self, usage):
+        for name in ('heap', 'mapped', 'resident'):
+            assert usage[name] == sum(section[name] for section in usage['sections'].values())
+        assert usage['total'] == usage['heap'] + usage['mapped']
+
+    def test_built(self):
+        d = dawg.BytesDAWG([(key, b'value') for key in self.keys], intern_payloads=True)
+        usage = d.memory_usage()
+        self.check_totals(usage)
+        assert usage['mapped'] == 0
+        assert usage['resident'] == usage['heap']
+        assert usage['sections']['dictionary']['heap'] >= d._total_size()
+        assert set(['guide', 'completer', 'payloads', 'python']) <= set(usage['sections'])
+        assert 'dawg' not in usage['sections']
+        assert usage['build_peak'] == d.build_stats['build_peak_size'] > 0
+
+    def test_small_build_peak(self):
+        # Reserved but untouched parts of builder pools are not counted.
+        usage = dawg.IntCompletionDAWG({'foo': 1, 'bar': 2}).memory_usage()
+        assert 0 < usage['build_peak'] < 64 * 1024
+
+    def test_mmap(self, tmpdir):
+        path = str(tmpdir.join('test.dawg'))
+        dawg.CompletionDAWG(self.keys).save(path, container=True)
+
+        usage = dawg.CompletionDAWG().mmap(path).memory_usage()
+        self.check_totals(usage)
+        assert usage['build_peak'] is None
+        assert usage['sections']['dictionary']['heap'] == 0
+        assert usage['sections']['dictionary']['mapped'] > 0
+        assert usage['sections']['guide']['mapped'] > 0
+
+        usage = dawg.CompletionDAWG().load(path).memory_usage()
+        self.check_totals(usage)
+        assert usage['mapped'] == 0
+        assert usage['sections']['dictionary']['heap'] > 0
+
+    def test_layered(self):
+        d = dawg.LayeredDAWG(dawg.IntCompletionDAWG({'foo': 1}))
+        d['bar'] = 2
+        usage = d.memory_usage()
+        self.check_totals(usage)
+        assert usage['sections']['overlay']['heap'] > 0
+
+
+class TestSubdawg(object):
+    data = {'en:foo': 1, 'en:bar': 2, 'en:': 3, 'de:foo': 4, 'en': 5}
+
+    def test_subdawg(self):
+        d = dawg.IntCompletionDAWG(self.data)
+        sub = d.subdawg('en:', tails=True)
+        assert isinstance(sub, dawg.IntCompletionDAWG)
+        assert sub.items() == d.items('en:')
+        assert sub.tobytes() == dawg.IntCompletionDAWG(d.items('en:')).tobytes()
+
+    def test_strip_prefix(self):
+        sub = dawg.IntCompletionDAWG(self.data).subdawg('en:', strip_prefix=True)
+        assert sub.items() == [('bar', 2), ('foo', 1)]
+
+    def test_build_stats(self):
+        sub = dawg.IntCompletionDAWG(self.data).subdawg('en:')
+        assert sub.build_stats is None
+        assert sub.memory_usage()['build_peak'] is None
+
+    def test_missing_prefix(self):
+        sub = dawg.CompletionDAWG(self.data).subdawg('fr:')
+        assert isinstance(sub, dawg.CompletionDAWG)
+        assert sub.keys() == []
+
+    def test_bytes_dawg(self):
+        with pytest.raises(TypeError):
+            dawg.BytesDAWG([('foo', b'bar')]).subdawg('f')
+
+
+class TestLayeredDAWG(object):
+    data = {'bar': 1, 'baz': 2, 'foo': 3, 'foobar': 4}
+
+    def layered(self):
+        return dawg.LayeredDAWG(dawg.IntCompletionDAWG(self.data))
+
+    def test_overlay(self):
+        d = self.layered()
+        d['foo'] = 30
+        d['fooz'] = 5
+        d.add('a')
+        del d['bar']
+        d.discard('missing')
+
+        assert 'bar' not in d
+        assert 'fooz' in d
+        assert d['foo'] == 30
+        assert d.get('bar', 7) == 7
+        assert d.overlay_size == 4
+        with pytest.raises(KeyError):
+            d['bar']
+        with pytest.raises(KeyError):
+            del d['bar']
+        with pytest.raises(ValueError):
+            d['foo'] = -1
+        with pytest.raises(dawg.Error):
+            d['foo\x00'] = 1
+
+    def test_items(self):
+        d = self.layered()
+        d['foo'] = 30
+        d['fooa'] = 5
+        d['zoo'] = 6
+        del d['foobar']
+
+        assert d.items() == [
+            ('bar', 1), ('baz', 2), ('foo', 30), ('fooa', 5), ('zoo', 6)]
+        assert d.keys('foo') == ['foo', 'fooa']
+        assert d.keys('ba') == ['bar', 'baz']
+        assert d.keys('z') == ['zoo']
+        assert d.keys('x') == []
+
+    @pytest.mark.parametrize("background", [False, True])
+    def test_compact(self, background):
+        d = self.layered()
+        d['foo'] = 30
+        d['zoo'] = 6
+        del d['bar']
+        expected = d.items()
+
+        thread = d.compact(background=background)
+        if background:
+            thread.join()
+
+        assert d.overlay_size == 0
+        assert d.items() == expected
+        assert d.base.items() == expected
+        assert isinstance(d.base, dawg.IntCompletionDAWG)
+        assert d.base.build_stats is None
+        assert d.memory_usage()['build_peak'] is None
+
+    def test_compact_while_iterating(self):
+        d = self.layered()
+        d['baa'] = 5
+        d['zoo'] = 6
+        del d['foo']
+        expected = d.items()
+
+        it = d.iteritems()
+        items = [next(it), next(it)]
+        d.compact()
+        d['foo'] = 7
+        items.extend(it)
+
+        assert items == expected
+        assert d.overlay_size == 1
+
+    def test_errors(self):
+        with pytest.raises(TypeError):
+            dawg.LayeredDAWG(dawg.DAWG(['foo']))
+        assert dawg.LayeredDAWG().keys() == []
@@ -1,6 +1,10 @@
 # -*- coding: utf-8 -*-
 from __future__ import absolute_import, unicode_literals
 
+import pickle
+import threading
+from io import BytesIO
+
 import pytest
 import dawg
 
@@ -83,6 +87,105 @@ class TestBytesDAWG(object):
         with pytest.raises(dawg.Error):
             self.dawg(payload_separator=b'f')
 
+    def test_large_payloads_in_thread_with_small_stack(self):
+        data = [('foo', b'x' * 20000), ('bar', bytes(bytearray(range(256))) * 78)]
+        result = []
+
+        threading.stack_size(256 * 1024)
+        try:
+            thread = threading.Thread(target=lambda: result.append(dawg.BytesDAWG(data)))
+            thread.start()
+            thread.join()
+        finally:
+            threading.stack_size(0)
+
+        d = result[0]
+        for key, value in data:
+            assert d[key] == [value]
+
+
+class TestInternedBytesDAWG(TestBytesDAWG):
+
+    def dawg(self, **kwargs):
+        return dawg.BytesDAWG(self.DATA, intern_payloads=True, **kwargs)
+
+    def test_payloads_are_shared(self):
+        d = dawg.BytesDAWG([('foo', b'data'), ('bar', b'data')], intern_payloads=True)
+        assert d['foo'][0] is d['bar'][0]
+        assert d['foo'][0] is d.items()[0][1]
+
+    def test_many_payloads(self):
+        data = [('key%d' % i, ('value%d' % (i % 300)).encode('ascii')) for i in range(1000)]
+        d = dawg.BytesDAWG(data, intern_payloads=True)
+        for key, value in data:
+            assert d[key] == [value]
+        assert d.items() == sorted(data)
+
+    def test_empty_payload(self):
+        d = dawg.BytesDAWG([('foo', b''), ('bar', b'x')], intern_payloads=True)
+        assert d['foo'] == [b'']
+        assert d['bar'] == [b'x']
+
+    def test_saveload(self):
+        buf = BytesIO()
+        self.dawg().write(buf)
+        buf.seek(0)
+
+        d = dawg.BytesDAWG(intern_payloads=True)
+        d.read(buf)
+        assert d.items() == sorted(self.DATA)
+        assert d['foo'] == [b'data1', b'data3']
+
+    def test_load_without_flag(self, tmpdir):
+        path = str(tmpdir.join('bytes.dawg'))
+        self.dawg().save(path)
+
+        d = dawg.BytesDAWG().load(path)
+        assert d.items() == sorted(self.DATA)
+
+        dawg.BytesDAWG(self.DATA).save(path)
+        d = dawg.BytesDAWG(intern_payloads=True).load(path)
+        assert d.items() == sorted(self.DATA)
+
+        with pytest.raises(IOError):
+            dawg.BytesDAWG().frombytes(dawg.BytesDAWG(self.DATA).tobytes() + b'garbage')
+
+    def test_pickling(self):
+        d = pickle.loads(pickle.dumps(self.dawg()))
+        assert d.items() == sorted(self.DATA)
+
+    def test_container(self, tmpdir):
+        path = str(tmpdir.join('bytes.dawg'))
+        self.dawg().save(path, container=True)
+
+        d = dawg.BytesDAWG().mmap(path, verify=True)
+        assert d.items() == sorted(self.DATA)
+        assert d['foo'] == [b'data1', b'data3']
+
+    def test_compressed_container(self):
+        buf = BytesIO()
+        self.dawg().write(buf, compress=True)
+
+        d = dawg.BytesDAWG().frombytes(buf.getvalue())
+        assert d.items() == sorted(self.DATA)
+
+
+class TestTailBytesDAWG(TestBytesDAWG):
+
+    def dawg(self, **kwargs):
+        return dawg.BytesDAWG(self.DATA, tails=True, **kwargs)
+
+    def test_long_payloads(self):
+        data = [('key%d' % i, ('payload-%d' % (i * 7919)).encode('ascii')) for i in range(1000)]
+        d = dawg.BytesDAWG(data, tails=True)
+        for key, value in data:
+            assert d[key] == [value]
+        assert d.items() == sorted(data)
+        assert d.items('key99') == sorted((k, v) for k, v in data if k.startswith('key99'))
+        assert d._file_size() < dawg.BytesDAWG(data)._file_size()
+
+        d = pickle.loads(pickle.dumps(d))
+        assert d.items() == sorted(data)
 
 
 class TestRecordDAWG(object):
@@ -130,3 +233,26 @@ class TestRecordDAWG(object):
         assert d.prefixes("foobarz") == ["foo", "foobar"]
         assert d.prefixes("x") == []
         assert d.prefixes("bar") == ["bar"]
+
+    def test_interned_payloads(self):
+        d = dawg.RecordDAWG(">3H", self.STRUCTURED_DATA, intern_payloads=True)
+        assert d['foo'] == [(3, 2, 1), (3, 2, 256)]
+        assert d.items() == sorted(self.STRUCTURED_DATA)
+
+        d2 = pickle.loads(pickle.dumps(d))
+        assert d2.items() == d.items()
+
+    def test_container(self, tmpdir):
+        path = str(tmpdir.join('record.dawg'))
+        dawg.RecordDAWG(">3H", self.STRUCTURED_DATA, payload_separator=b'\xff').save(path, container=True)
+
+        d = dawg.RecordDAWG("B").load(path)
+        assert d['foo'] == [(3, 2, 1), (3, 2, 256)]
+        assert sorted(d.items()) == sorted(self.STRUCTURED_DATA)
+        assert d.prefixes("foobarz") == ["foo", "foobar"]
+
+    def test_tails(self):
+        d = dawg.RecordDAWG(">3H", self.STRUCTURED_DATA, tails=True)
+        assert d['foo'] == [(3, 2, 1), (3, 2, 256)]
+        assert d.items() == sorted(self.STRUCTURED_DATA)
+        assert d.prefixes("foobarz") == ["foo", "foobar"]